@@ -0,0 +1,1027 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "display_list.h"
+#include "fill.h"
+#include "frame_stream.h"
+#include "glyph_bundle.h"
+#include "image_export.h"
+#include "instrument.h"
+#include "kernels.h"
+#include "line.h"
+#include "line_raster.h"
+#include "perf_counters.h"
+#include "render_job.h"
+#include "bezier.h"
+#include "bezier_raster.h"
+#include "circle.h"
+#include "circle_raster.h"
+#include "pixel_sink.h"
+#include "row_executor.h"
+#include "scene.h"
+#include "span_shape.h"
+#include "spatial_grid.h"
+#include "stamp_cache.h"
+#include "stroke.h"
+#include "stroke_animation.h"
+#include "svg.h"
+#include "tiled_canvas.h"
+#include "constants.h"
+
+// Headless benchmark harness.
+// Each case is run repeatedly on a blank frame and the mean time is reported.
+
+constexpr int NUM_REPS = 50;
+
+static double time_us(const std::function<void()>& func, const int reps)
+{
+    const auto time_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; i++) {
+        func();
+    }
+    const auto time_end = std::chrono::steady_clock::now();
+    const std::chrono::duration<double, std::micro> us_elapsed = time_end - time_start;
+    return us_elapsed.count() / reps;
+}
+
+static void bench_lines(std::vector<std::uint32_t>& pixels)
+{
+    static const std::array<std::function<void(std::vector<std::uint32_t>&, const std::uint32_t, const int, const int, const int, const int)>, 4> drawing_funcs = {
+        &draw_line_dda,
+        &draw_line_bresenham,
+        &draw_line_zingl,
+        &draw_line_run_slice
+    };
+    static const std::array<std::string, 4> func_names = {
+        "DDA",
+        "Bresenham",
+        "Zingl",
+        "Run-slice"
+    };
+    static const std::array<Point, 7> line_pas = {{
+        {100, SCREEN_HEIGHT - 1},
+        {100, SCREEN_HEIGHT - 1},
+        {  0, Y_MID_SCREEN},
+        {  0, Y_MID_SCREEN},
+        {  0, Y_MID_SCREEN},
+        {100, 0},
+        {100, 0}
+    }};
+    static const std::array<Point, 7> line_pbs = {{
+        {100, 0},
+        {150, 0},
+        {SCREEN_WIDTH - 1, Y_MID_SCREEN - 100},
+        {SCREEN_WIDTH - 1, Y_MID_SCREEN},
+        {SCREEN_WIDTH - 1, Y_MID_SCREEN + 100},
+        {150, SCREEN_HEIGHT - 1},
+        {100, SCREEN_HEIGHT - 1}
+    }};
+
+    std::cout << "LINE DRAWING FUNCTIONS (us per line)\n\n";
+    std::cout << std::left << std::setw(36) << "line";
+    for (const std::string& name : func_names) {
+        std::cout << std::right << std::setw(12) << name;
+    }
+    std::cout << "\n";
+    for (std::size_t j = 0; j < line_pas.size(); j++) {
+        const Point pa = line_pas.at(j);
+        const Point pb = line_pbs.at(j);
+        const std::string label = "(" + std::to_string(pa.x) + ", " + std::to_string(pa.y) + ") to ("
+            + std::to_string(pb.x) + ", " + std::to_string(pb.y) + ")";
+        std::cout << std::left << std::setw(36) << label;
+        for (std::size_t i = 0; i < drawing_funcs.size(); i++) {
+            const auto& func = drawing_funcs.at(i);
+            const double us = time_us([&]() { func(pixels, red, pa.x, pa.y, pb.x, pb.y); }, NUM_REPS);
+            std::cout << std::right << std::setw(12) << std::fixed << std::setprecision(2) << us;
+        }
+        std::cout << "\n";
+    }
+    const StrokeAnimation animation("19976.svg");
+    const double us = time_us([&]() { animation.draw_medians(pixels, red); }, NUM_REPS);
+    std::cout << std::left << std::setw(36) << "subpixel medians of 19976.svg" << std::right << std::setw(12) << us << "\n";
+    std::cout << "\n";
+}
+
+// Thick line faked with `width` parallel one-pixel lines,
+// offset along the minor axis.
+static void draw_parallel_lines(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const int ax, const int ay,
+    const int bx, const int by,
+    const int width)
+{
+    const bool is_steep = std::abs(by - ay) > std::abs(bx - ax);
+    for (int k = -(width / 2); k < width - (width / 2); k++) {
+        if (is_steep) {
+            draw_line_bresenham(pixels, color, ax + k, ay, bx + k, by);
+        } else {
+            draw_line_bresenham(pixels, color, ax, ay + k, bx, by + k);
+        }
+    }
+}
+
+static void bench_strokes(std::vector<std::uint32_t>& pixels)
+{
+    static const std::array<int, 4> widths = {2, 8, 32, 128};
+    static const std::array<Point, 3> stroke_pas = {{
+        {200, Y_MID_SCREEN},
+        {200, 200},
+        {X_MID_SCREEN, 200}
+    }};
+    static const std::array<Point, 3> stroke_pbs = {{
+        {SCREEN_WIDTH - 200, Y_MID_SCREEN + 100},
+        {SCREEN_WIDTH - 500, SCREEN_HEIGHT - 200},
+        {X_MID_SCREEN + 150, SCREEN_HEIGHT - 200}
+    }};
+
+    std::cout << "STROKED LINES VS PARALLEL LINES (us per stroke)\n\n";
+    std::cout << std::left << std::setw(36) << "line" << std::right
+        << std::setw(8) << "width"
+        << std::setw(12) << "parallel"
+        << std::setw(12) << "butt"
+        << std::setw(12) << "round"
+        << std::setw(10) << "speedup" << "\n";
+    StrokeStyle butt_style;
+    StrokeStyle round_style;
+    round_style.cap = LineCap::round;
+    for (std::size_t j = 0; j < stroke_pas.size(); j++) {
+        const Point pa = stroke_pas.at(j);
+        const Point pb = stroke_pbs.at(j);
+        const std::string label = "(" + std::to_string(pa.x) + ", " + std::to_string(pa.y) + ") to ("
+            + std::to_string(pb.x) + ", " + std::to_string(pb.y) + ")";
+        for (const int width : widths) {
+            butt_style.width = width;
+            round_style.width = width;
+            const double us_parallel = time_us([&]() {
+                draw_parallel_lines(pixels, red, pa.x, pa.y, pb.x, pb.y, width);
+            }, NUM_REPS);
+            const double us_butt = time_us([&]() {
+                draw_stroke_line(pixels, red, pa.x, pa.y, pb.x, pb.y, butt_style);
+            }, NUM_REPS);
+            const double us_round = time_us([&]() {
+                draw_stroke_line(pixels, red, pa.x, pa.y, pb.x, pb.y, round_style);
+            }, NUM_REPS);
+            std::cout << std::left << std::setw(36) << label << std::right
+                << std::setw(8) << width << std::fixed << std::setprecision(2)
+                << std::setw(12) << us_parallel
+                << std::setw(12) << us_butt
+                << std::setw(12) << us_round
+                << std::setw(9) << us_parallel / us_butt << "x\n";
+        }
+    }
+
+    std::vector<Point> polyline;
+    for (int x = 100; x < SCREEN_WIDTH - 100; x += 40) {
+        polyline.push_back({x, Y_MID_SCREEN + ((x / 40) % 2 == 0 ? -150 : 150)});
+    }
+    std::cout << "\npolyline, " << polyline.size() << " points (us per stroke)\n";
+    for (const LineJoin join : {LineJoin::miter, LineJoin::round, LineJoin::bevel}) {
+        static const std::array<std::string, 3> join_names = {"miter", "round", "bevel"};
+        StrokeStyle style;
+        style.width = 16;
+        style.join = join;
+        const double us = time_us([&]() { draw_stroke_polyline(pixels, red, polyline, style); }, NUM_REPS);
+        std::cout << std::left << std::setw(8) << join_names.at(static_cast<std::size_t>(join))
+            << std::right << std::setw(12) << std::fixed << std::setprecision(2) << us << "\n";
+    }
+    std::cout << "\n";
+}
+
+static void bench_display_list(std::vector<std::uint32_t>& pixels)
+{
+    static const std::string svg_path = "19976.svg";
+    constexpr int num_lines = 200;
+
+    const auto draw_immediate = [&]() {
+        for (int k = 0; k < num_lines; k++) {
+            draw_line_bresenham(pixels, red, 0, k * 5, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1 - (k * 5));
+        }
+        draw_svg(pixels, black, svg_path);
+    };
+
+    DisplayList list;
+    const double us_record = time_us([&]() {
+        list.clear();
+        for (int k = 0; k < num_lines; k++) {
+            list.record_line(LineAlgorithm::bresenham, red, 0, k * 5, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1 - (k * 5));
+        }
+        list.record_svg(black, svg_path);
+    }, NUM_REPS);
+
+    std::cout << "DISPLAY LIST (us per frame, " << list.size() << " commands)\n\n";
+    std::cout << std::left << std::setw(24) << "immediate" << std::right << std::fixed << std::setprecision(2)
+        << std::setw(12) << time_us(draw_immediate, NUM_REPS) << "\n";
+    std::cout << std::left << std::setw(24) << "record" << std::right
+        << std::setw(12) << us_record << "\n";
+    std::cout << std::left << std::setw(24) << "replay" << std::right
+        << std::setw(12) << time_us([&]() { list.replay(pixels); }, NUM_REPS) << "\n";
+    list.sort(DisplayListOrder::by_tile);
+    std::cout << std::left << std::setw(24) << "replay (tile order)" << std::right
+        << std::setw(12) << time_us([&]() { list.replay(pixels); }, NUM_REPS) << "\n";
+    list.sort(DisplayListOrder::by_type);
+    std::cout << std::left << std::setw(24) << "replay (type order)" << std::right
+        << std::setw(12) << time_us([&]() { list.replay(pixels); }, NUM_REPS) << "\n\n";
+}
+
+// Runs a job to completion, returning the number of slices and the
+// longest one in us
+static int run_render_job(RenderJob& job, const RenderBudget& budget, double& us_max)
+{
+    int num_slices = 0;
+    us_max = 0;
+    job.restart();
+    bool done = false;
+    while (!done) {
+        us_max = std::max(us_max, time_us([&]() { done = job.advance(budget); }, 1));
+        num_slices++;
+    }
+    return num_slices;
+}
+
+static void bench_render_job(std::vector<std::uint32_t>& pixels)
+{
+    DisplayList list;
+    for (int k = 0; k < 100000; k++) {
+        const int x = 100 + ((k * 37) % (SCREEN_WIDTH - 200));
+        const int y = 100 + ((k * 61) % (SCREEN_HEIGHT - 200));
+        if (k % 2 == 0) {
+            list.record_circle(red, x, y, 10 + (k % 80));
+        } else {
+            list.record_line(LineAlgorithm::bresenham, green, x, y, 100 + ((k * 31) % (SCREEN_WIDTH - 200)), y);
+        }
+    }
+    list.record_svg(black, "19976.svg");
+    DisplayList svg_list;
+    svg_list.record_svg(black, "19976.svg");
+
+    const double us_replay = time_us([&]() { list.replay(pixels); }, 3);
+    std::cout << "RENDER JOB (" << list.size() << " commands, replay " << std::fixed << std::setprecision(2)
+        << us_replay / 1000 << " ms)\n\n";
+    std::cout << std::left << std::setw(24) << "budget" << std::right << std::setw(12) << "slices"
+        << std::setw(12) << "max (ms)" << std::setw(12) << "total (ms)" << "\n";
+    const auto print_row = [](const std::string& name, RenderJob& job, const RenderBudget& budget) {
+        double us_max = 0;
+        int num_slices = 0;
+        const double us_total = time_us([&]() { num_slices = run_render_job(job, budget, us_max); }, 1);
+        std::cout << std::left << std::setw(24) << name << std::right << std::setw(12) << num_slices
+            << std::setw(12) << us_max / 1000 << std::setw(12) << us_total / 1000 << "\n";
+    };
+    RenderJob job(list, pixels);
+    print_row("2 ms", job, {std::chrono::milliseconds(2), 0});
+    print_row("10 ms", job, {std::chrono::milliseconds(10), 0});
+    print_row("1M pixels", job, {std::chrono::microseconds(0), 1000000});
+    // A single glyph is split within its paths
+    RenderJob svg_job(svg_list, pixels);
+    print_row("svg, 50 us", svg_job, {std::chrono::microseconds(50), 0});
+    print_row("svg, 10k pixels", svg_job, {std::chrono::microseconds(0), 10000});
+    std::cout << "\n";
+}
+
+template <typename Sink>
+static void draw_sink_scene(Sink& sink)
+{
+    for (int k = 0; k < 20; k++) {
+        rasterize_line_zingl(sink, 0, k * 50, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1 - (k * 50));
+    }
+    rasterize_circle_midpoint(sink, X_MID_SCREEN, Y_MID_SCREEN, SCREEN_HEIGHT / 3);
+    rasterize_bezier_quad(sink, 100, 100, 600, 900, 1200, 200);
+    rasterize_bezier_cubic(sink, 100, 900, 400, 100, 900, 1000, 1500, 100);
+}
+
+static void bench_sinks(std::vector<std::uint32_t>& pixels)
+{
+    std::vector<std::uint8_t> mask(NUM_PIXELS);
+
+    std::cout << "PIXEL SINKS (us per scene of lines, a circle and Beziers)\n\n";
+    const auto report = [](const std::string& name, const double us) {
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << us << "\n";
+    };
+    report("checked", time_us([&]() { CheckedSink sink(pixels, red); draw_sink_scene(sink); }, NUM_REPS));
+    report("unchecked", time_us([&]() { UncheckedSink sink(pixels, red); draw_sink_scene(sink); }, NUM_REPS));
+    report("blend", time_us([&]() { BlendSink sink(pixels, 0x80FF0000); draw_sink_scene(sink); }, NUM_REPS));
+    report("mask", time_us([&]() { MaskSink sink(mask); draw_sink_scene(sink); }, NUM_REPS));
+    report("span collector", time_us([&]() { SpanCollector sink; draw_sink_scene(sink); }, NUM_REPS));
+    report("counting", time_us([&]() {
+        UncheckedSink unchecked(pixels, red);
+        CountingSink<UncheckedSink> sink(unchecked);
+        draw_sink_scene(sink);
+    }, NUM_REPS));
+    std::cout << "\n";
+}
+
+static void bench_anti_aliasing(std::vector<std::uint32_t>& pixels)
+{
+    std::cout << "ANTI-ALIASED PRIMITIVES (us per primitive)\n\n";
+    std::cout << std::left << std::setw(36) << "primitive" << std::right
+        << std::setw(12) << "aliased" << std::setw(12) << "AA" << std::setw(12) << "ratio" << "\n";
+    const auto print_row = [&](const std::string& name, const std::function<void()>& aliased, const std::function<void()>& aa) {
+        const double aliased_us = time_us(aliased, NUM_REPS);
+        const double aa_us = time_us(aa, NUM_REPS);
+        std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << aliased_us << std::setw(12) << aa_us << std::setw(12) << aa_us / aliased_us << "\n";
+    };
+    print_row("line (0, 540) to (1919, 440)",
+        [&]() { draw_line_zingl(pixels, red, 0, Y_MID_SCREEN, SCREEN_WIDTH - 1, Y_MID_SCREEN - 100); },
+        [&]() { draw_line_zingl_aa(pixels, red, 0, Y_MID_SCREEN, SCREEN_WIDTH - 1, Y_MID_SCREEN - 100); });
+    print_row("circle, radius 400",
+        [&]() { draw_circle_midpoint(pixels, red, X_MID_SCREEN, Y_MID_SCREEN, 400); },
+        [&]() { draw_circle_midpoint_aa(pixels, red, X_MID_SCREEN, Y_MID_SCREEN, 400); });
+    print_row("quadratic Bezier",
+        [&]() { draw_bezier_quad(pixels, red, 100, 100, 600, 900, 1200, 200); },
+        [&]() { draw_bezier_quad_aa(pixels, red, 100, 100, 600, 900, 1200, 200); });
+    print_row("cubic Bezier",
+        [&]() { draw_bezier_cubic(pixels, red, 100, 900, 400, 100, 900, 1000, 1500, 100); },
+        [&]() { draw_bezier_cubic_aa(pixels, red, 100, 900, 400, 100, 900, 1000, 1500, 100); });
+    std::cout << "\n";
+}
+
+static void bench_stroke_animation(std::vector<std::uint32_t>& pixels)
+{
+    static const std::string svg_path = "19976.svg";
+    constexpr int fps = 60;
+
+    StrokeAnimation animation(svg_path);
+    const int num_frames = static_cast<int>(animation.get_end_time() * fps) + 1;
+    const auto frame_time = [](const int frame) { return frame / static_cast<double>(fps); };
+
+    std::cout << "STROKE ANIMATION (us per frame, " << num_frames << " frames at " << fps << " fps)\n\n";
+    const double us_incremental = time_us([&]() {
+        animation.rewind();
+        for (int frame = 0; frame < num_frames; frame++) {
+            animation.render_frame(pixels, black, frame_time(frame));
+        }
+    }, NUM_REPS) / num_frames;
+    // Every frame parsed and drawn from scratch
+    const double us_full = time_us([&]() {
+        for (int frame = 0; frame < num_frames; frame++) {
+            StrokeAnimation from_scratch(svg_path);
+            from_scratch.render_frame(pixels, black, frame_time(frame));
+        }
+    }, 1) / num_frames;
+    std::cout << std::left << std::setw(24) << "incremental" << std::right << std::fixed << std::setprecision(2)
+        << std::setw(12) << us_incremental << "\n";
+    std::cout << std::left << std::setw(24) << "from scratch" << std::right
+        << std::setw(12) << us_full << "\n";
+    std::cout << std::left << std::setw(24) << "draw_svg" << std::right
+        << std::setw(12) << time_us([&]() { draw_svg(pixels, black, svg_path); }, NUM_REPS) << "\n\n";
+}
+
+static void bench_scene(std::vector<std::uint32_t>& pixels)
+{
+    constexpr int num_objects = 5000;
+    constexpr int moves_per_frame = 5;
+
+    // Small objects spread over the screen, with a fixed seed
+    std::uint32_t seed = 12345;
+    const auto next_random = [&seed](const int n) {
+        seed = (seed * 1103515245) + 12345;
+        return static_cast<int>((seed >> 8) % n);
+    };
+    Scene scene;
+    std::vector<SceneObjectId> ids;
+    for (int k = 0; k < num_objects; k++) {
+        const int x = 60 + next_random(SCREEN_WIDTH - 120);
+        const int y = 60 + next_random(SCREEN_HEIGHT - 120);
+        switch (k % 3) {
+            case 0:
+                ids.push_back(scene.add_line(LineAlgorithm::bresenham, red, x, y, x + next_random(100) - 50, y + next_random(100) - 50));
+                break;
+            case 1:
+                ids.push_back(scene.add_circle(green, x, y, next_random(40)));
+                break;
+            default:
+                ids.push_back(scene.add_bezier_quad(blue, x, y, x + next_random(80) - 40, y - 40, x + next_random(80) - 40, y));
+                break;
+        }
+    }
+    scene.render(pixels);
+
+    std::cout << "SCENE (us per frame, " << num_objects << " objects, " << moves_per_frame << " moved per frame)\n\n";
+    std::cout << std::left << std::setw(24) << "full redraw" << std::right << std::fixed << std::setprecision(2)
+        << std::setw(12) << time_us([&]() { scene.invalidate_all(); scene.render(pixels); }, NUM_REPS) << "\n";
+    std::cout << std::left << std::setw(24) << "incremental" << std::right
+        << std::setw(12) << time_us([&]() {
+            for (int m = 0; m < moves_per_frame; m++) {
+                scene.move(ids[next_random(num_objects)], next_random(21) - 10, next_random(21) - 10);
+            }
+            scene.render(pixels);
+        }, NUM_REPS) << "\n";
+    // Many edits per frame must fall back to a full redraw, not pile up rects
+    std::cout << std::left << std::setw(24) << "2000 moved per frame" << std::right
+        << std::setw(12) << time_us([&]() {
+            for (int m = 0; m < 2000; m++) {
+                scene.move(ids[next_random(num_objects)], next_random(21) - 10, next_random(21) - 10);
+            }
+            scene.render(pixels);
+        }, NUM_REPS) << "\n\n";
+}
+
+static void bench_spatial_grid()
+{
+    constexpr int num_items = 100000;
+    constexpr int num_queries = 1000;
+
+    std::uint32_t seed = 54321;
+    const auto next_random = [&seed](const int n) {
+        seed = (seed * 1103515245) + 12345;
+        return static_cast<int>((seed >> 8) % n);
+    };
+    std::vector<DrawBounds> bounds;
+    bounds.reserve(num_items);
+    for (int k = 0; k < num_items; k++) {
+        const int x = next_random(SCREEN_WIDTH);
+        const int y = next_random(SCREEN_HEIGHT);
+        bounds.push_back({x, y, x + next_random(100), y + next_random(100)});
+    }
+    std::vector<DrawBounds> rects;
+    for (int k = 0; k < num_queries; k++) {
+        const int x = next_random(SCREEN_WIDTH - 256);
+        const int y = next_random(SCREEN_HEIGHT - 256);
+        rects.push_back({x, y, x + 255, y + 255});
+    }
+
+    SpatialGrid grid;
+    std::vector<std::uint32_t> ids;
+    std::cout << "SPATIAL GRID (" << num_items << " items, us per operation)\n\n";
+    const auto report = [](const std::string& name, const double us) {
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << us << "\n";
+    };
+    report("bulk build", time_us([&]() { grid.build(bounds); }, 5));
+    report("insert one by one", time_us([&]() {
+        grid.clear();
+        for (std::size_t id = 0; id < bounds.size(); id++) {
+            grid.insert(static_cast<std::uint32_t>(id), bounds[id]);
+        }
+    }, 5));
+    report("256x256 query", time_us([&]() {
+        for (const DrawBounds& rect : rects) {
+            ids.clear();
+            grid.query(rect, ids);
+        }
+    }, NUM_REPS) / num_queries);
+    report("256x256 linear scan", time_us([&]() {
+        for (const DrawBounds& rect : rects) {
+            ids.clear();
+            for (std::size_t id = 0; id < bounds.size(); id++) {
+                const DrawBounds& b = bounds[id];
+                if (b.x_min <= rect.x_max && rect.x_min <= b.x_max && b.y_min <= rect.y_max && rect.y_min <= b.y_max) {
+                    ids.push_back(static_cast<std::uint32_t>(id));
+                }
+            }
+        }
+    }, 5) / num_queries);
+    report("point query", time_us([&]() {
+        for (const DrawBounds& rect : rects) {
+            ids.clear();
+            grid.query_point(rect.x_min, rect.y_min, ids);
+        }
+    }, NUM_REPS) / num_queries);
+
+    // Exact picks in a scene of lines and curves
+    Scene scene;
+    for (int k = 0; k < 5000; k++) {
+        const int x = next_random(SCREEN_WIDTH - 100);
+        const int y = next_random(SCREEN_HEIGHT - 100);
+        if (k % 2 == 0) {
+            scene.add_line(LineAlgorithm::zingl, red, x, y, x + next_random(100), y + next_random(100));
+        } else {
+            scene.add_bezier_quad(blue, x, y, x + next_random(100), y, x + next_random(100), y + next_random(100));
+        }
+    }
+    int num_hits = 0;
+    report("scene pick", time_us([&]() {
+        num_hits = 0;
+        for (const DrawBounds& rect : rects) {
+            SceneObjectId id;
+            num_hits += scene.pick(rect.x_min, rect.y_min, id);
+        }
+    }, NUM_REPS) / num_queries);
+    std::cout << "(" << num_hits << " of " << num_queries << " picks hit)\n\n";
+}
+
+static void draw_poster(TiledCanvas& canvas)
+{
+    // Glyphs, lines and circles scattered over the whole canvas,
+    // with a fixed seed
+    std::uint32_t seed = 24680;
+    const auto next_random = [&seed](const int n) {
+        seed = (seed * 1103515245) + 12345;
+        return static_cast<int>((seed >> 8) % n);
+    };
+    const int width = canvas.get_width();
+    const int height = canvas.get_height();
+    for (int k = 0; k < 16; k++) {
+        draw_svg(canvas, black, "19976.svg", next_random(width - 1024), next_random(height - 1024));
+    }
+    for (int k = 0; k < 1000; k++) {
+        const int x = next_random(width - 200);
+        const int y = next_random(height - 200);
+        draw_line(canvas, red, LineAlgorithm::zingl, x, y, x + next_random(200), y + next_random(200));
+    }
+    for (int k = 0; k < 200; k++) {
+        draw_circle_midpoint(canvas, blue, 100 + next_random(width - 200), 100 + next_random(height - 200), next_random(100));
+    }
+}
+
+static void bench_tiled_canvas()
+{
+    constexpr int size = 32768;
+    constexpr double dense_mb = static_cast<double>(size) * size * sizeof(std::uint32_t) / (1024 * 1024);
+
+    std::cout << "TILED CANVAS (" << size << "x" << size << ", " << dense_mb << " MB if dense)\n\n";
+    std::cout << std::left << std::setw(24) << "" << std::right << std::setw(12) << "ms"
+        << std::setw(12) << "tiles" << std::setw(12) << "MB" << "\n";
+    const auto report = [](const std::string& name, const double us, const TiledCanvas& canvas) {
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << us / 1000 << std::setw(12) << canvas.get_num_allocated_tiles()
+            << std::setw(12) << static_cast<double>(canvas.get_allocated_bytes()) / (1024 * 1024) << "\n";
+    };
+    {
+        TiledCanvas canvas(size, size);
+        report("in memory", time_us([&]() { draw_poster(canvas); }, 1), canvas);
+    }
+    const std::string file_path = (std::filesystem::temp_directory_path() / "draw2d-bench-canvas.bin").string();
+    {
+        TiledCanvas canvas(size, size, file_path);
+        report("file-backed", time_us([&]() { draw_poster(canvas); }, 1), canvas);
+        report("  + flush", time_us([&]() { canvas.flush(); }, 1), canvas);
+    }
+    std::remove(file_path.c_str());
+    std::cout << "\n";
+}
+
+static void bench_export(std::vector<std::uint32_t>& pixels)
+{
+    std::fill(pixels.begin(), pixels.end(), blank);
+    draw_svg(pixels, black, "19976.svg");
+    for (int y = 0; y < SCREEN_HEIGHT; y += 40) {
+        draw_line(pixels, red, LineAlgorithm::bresenham, 0, y, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1 - y);
+    }
+    constexpr double frame_mb = static_cast<double>(NUM_PIXELS) * sizeof(std::uint32_t) / (1024 * 1024);
+    const std::string file_path = (std::filesystem::temp_directory_path() / "draw2d-bench-export").string();
+
+    std::cout << "IMAGE EXPORT (MB/s of ARGB frame encoded, hardware threads: " << std::thread::hardware_concurrency() << ")\n\n";
+    std::cout << std::left << std::setw(24) << "" << std::right << std::setw(12) << "MB/s" << std::setw(12) << "KB" << "\n";
+    const auto report = [&](const std::string& name, const double us) {
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << frame_mb / (us / 1e6)
+            << std::setw(12) << static_cast<double>(std::filesystem::file_size(file_path)) / 1024 << "\n";
+    };
+    report("qoi", time_us([&]() { write_qoi(file_path, pixels); }, 10));
+    report("png, 1 thread", time_us([&]() {
+        PngWriter writer(file_path, SCREEN_WIDTH, SCREEN_HEIGHT, 1);
+        writer.write_rows(pixels.data(), SCREEN_HEIGHT, SCREEN_WIDTH);
+        writer.finish();
+    }, 10));
+    report("png, all threads", time_us([&]() { write_png(file_path, pixels); }, 10));
+    std::remove(file_path.c_str());
+    std::cout << "\n";
+}
+
+static void bench_frame_stream()
+{
+    constexpr int fps = 60;
+    StrokeAnimation animation("19976.svg");
+    const int num_frames = static_cast<int>(animation.get_end_time() * fps) + 1;
+    const std::string file_path = (std::filesystem::temp_directory_path() / "draw2d-bench.d2fs").string();
+    constexpr double frame_mb = static_cast<double>(NUM_PIXELS) * sizeof(std::uint32_t) / (1024 * 1024);
+
+    std::cout << "FRAME STREAM (" << num_frames << " animation frames, keyframe every " << fps << ")\n\n";
+    // Frames are written as they are drawn; only the writes are timed
+    std::vector<std::uint32_t> frame(NUM_PIXELS, blank);
+    FrameStreamWriter writer(file_path, SCREEN_WIDTH, SCREEN_HEIGHT, fps);
+    double us_write = 0;
+    for (int i = 0; i < num_frames; i++) {
+        animation.render_frame(frame, black, i / static_cast<double>(fps));
+        us_write += time_us([&]() { writer.write_frame(frame); }, 1);
+    }
+    us_write += time_us([&]() { writer.finish(); }, 1);
+    us_write /= num_frames;
+    const std::size_t num_bytes = writer.get_bytes_written();
+    const std::size_t num_tiles = writer.get_num_tiles_written();
+    FrameStreamReader reader(file_path);
+    const double us_read = time_us([&]() {
+        for (int i = 0; i < num_frames; i++) {
+            reader.read_frame(i);
+        }
+    }, 1) / num_frames;
+    int seed = 1;
+    const double us_seek = time_us([&]() {
+        seed = (seed * 7919) % num_frames;
+        reader.read_frame(seed);
+    }, 50);
+    std::cout << std::left << std::setw(24) << "raw frames (MB)" << std::right << std::fixed << std::setprecision(2)
+        << std::setw(12) << frame_mb * num_frames << "\n";
+    std::cout << std::left << std::setw(24) << "stream (MB)" << std::right << std::setw(12)
+        << static_cast<double>(num_bytes) / (1024 * 1024) << "\n";
+    std::cout << std::left << std::setw(24) << "tiles per frame" << std::right << std::setw(12)
+        << static_cast<double>(num_tiles) / num_frames << "\n";
+    std::cout << std::left << std::setw(24) << "write (us per frame)" << std::right << std::setw(12) << us_write << "\n";
+    std::cout << std::left << std::setw(24) << "read (us per frame)" << std::right << std::setw(12) << us_read << "\n";
+    std::cout << std::left << std::setw(24) << "seek (us)" << std::right << std::setw(12) << us_seek << "\n";
+    std::remove(file_path.c_str());
+    std::cout << "\n";
+}
+
+static void bench_path_lod(std::vector<std::uint32_t>& pixels)
+{
+    std::vector<std::vector<PathSegment>> glyph;
+    for (const std::string& path : get_paths_from_svg("19976.svg")) {
+        glyph.push_back(parse_path(path));
+    }
+    // A page of glyphs at each size, at varying subpixel offsets
+    constexpr int num_glyphs = 400;
+    const auto draw_page = [&](TransformedPathFill& path_fill, const int size, const float tolerance, std::size_t& num_segments) {
+        num_segments = 0;
+        for (int k = 0; k < num_glyphs; k++) {
+            const PathTransform transform = {
+                size / 1024.0f,
+                ((k % 30) * (size + 8)) + ((k % 7) * 0.13f),
+                ((k / 30) * (size + 8)) + ((k % 5) * 0.21f)
+            };
+            for (const std::vector<PathSegment>& path : glyph) {
+                num_segments += path_fill.fill(pixels, black, path, transform, tolerance);
+            }
+        }
+    };
+
+    // "cold" starts each page with a new fill, so each path is simplified
+    // and filled once per subpixel phase of the page
+    std::cout << "PATH LOD (us per glyph, tolerance " << DEFAULT_PATH_TOLERANCE << " px)\n\n";
+    std::cout << std::left << std::setw(12) << "size" << std::right << std::setw(12) << "exact"
+        << std::setw(12) << "cold" << std::setw(12) << "lod" << std::setw(12) << "speedup"
+        << std::setw(12) << "segments" << std::setw(12) << "lod segs" << "\n";
+    for (const int size : {16, 24, 32, 48, 96}) {
+        std::size_t num_exact = 0;
+        std::size_t num_lod = 0;
+        TransformedPathFill path_fill;
+        const double us_exact = time_us([&]() { draw_page(path_fill, size, 0, num_exact); }, NUM_REPS) / num_glyphs;
+        const double us_cold = time_us([&]() {
+            TransformedPathFill new_fill;
+            draw_page(new_fill, size, DEFAULT_PATH_TOLERANCE, num_lod);
+        }, NUM_REPS) / num_glyphs;
+        const double us_lod = time_us([&]() { draw_page(path_fill, size, DEFAULT_PATH_TOLERANCE, num_lod); }, NUM_REPS) / num_glyphs;
+        std::cout << std::left << std::setw(12) << (std::to_string(size) + " px") << std::right << std::fixed
+            << std::setprecision(2) << std::setw(12) << us_exact << std::setw(12) << us_cold << std::setw(12) << us_lod
+            << std::setw(12) << us_exact / us_lod << std::setw(12) << num_exact / num_glyphs
+            << std::setw(12) << num_lod / num_glyphs << "\n";
+    }
+    std::cout << "\n";
+}
+
+static void bench_span_shapes(std::vector<std::uint32_t>& pixels)
+{
+    constexpr int radius = 400;
+    std::cout << "SPAN SHAPES (us, circle of radius " << radius << " and 19976.svg)\n\n";
+    const auto print_row = [](const std::string& name, const double us) {
+        std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << us << "\n";
+    };
+    print_row("draw + flood fill", time_us([&]() {
+        draw_circle_midpoint(pixels, red, X_MID_SCREEN, Y_MID_SCREEN, radius);
+        flood_fill_stack(pixels, red, X_MID_SCREEN, Y_MID_SCREEN);
+        draw_circle_midpoint(pixels, blank, X_MID_SCREEN, Y_MID_SCREEN, radius);
+        flood_fill_stack(pixels, blank, X_MID_SCREEN, Y_MID_SCREEN);
+    }, 5) / 2);
+    SpanShape disc;
+    print_row("circle shape", time_us([&]() { disc = get_circle_shape(X_MID_SCREEN, Y_MID_SCREEN, radius); }, NUM_REPS));
+    print_row("draw circle shape", time_us([&]() { draw_shape(pixels, red, disc); }, NUM_REPS));
+
+    SpanShape glyph;
+    print_row("svg shape", time_us([&]() { glyph = get_svg_shape("19976.svg"); }, 5));
+    print_row("draw svg", time_us([&]() { draw_svg(pixels, black, "19976.svg"); }, 5));
+    print_row("draw svg shape", time_us([&]() { draw_shape(pixels, black, glyph); }, NUM_REPS));
+    SpanShape combined;
+    print_row("union", time_us([&]() { combined = disc.get_union(glyph); }, NUM_REPS));
+    print_row("intersection", time_us([&]() { combined = disc.get_intersection(glyph); }, NUM_REPS));
+    print_row("difference", time_us([&]() { combined = disc.get_difference(glyph); }, NUM_REPS));
+    print_row("translate", time_us([&]() { combined.translate(1, 1); }, NUM_REPS));
+
+    // Memory of the shapes against a 1-bit mask of their bounds
+    for (const auto& [name, shape] : {std::make_pair("circle", &disc), std::make_pair("svg", &glyph)}) {
+        const DrawBounds bounds = shape->get_bounds();
+        const std::size_t mask_bytes = static_cast<std::size_t>(bounds.x_max - bounds.x_min + 64) / 64 * 8 * (bounds.y_max - bounds.y_min + 1);
+        std::cout << std::left << std::setw(36) << (std::string(name) + " (bytes, mask bytes)") << std::right
+            << std::setw(12) << shape->get_spans().size() * sizeof(Span) << std::setw(12) << mask_bytes << "\n";
+    }
+    std::cout << "\n";
+}
+
+static void bench_glyph_bundle(std::vector<std::uint32_t>& pixels)
+{
+    // A directory of copies of one glyph stands in for a glyph set
+    constexpr int num_glyphs = 1000;
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "draw2d-bench-glyphs";
+    const std::string bundle_path = (dir / "bundle.bin").string();
+    std::filesystem::create_directories(dir);
+    for (int i = 0; i < num_glyphs; i++) {
+        std::filesystem::copy_file("19976.svg", dir / (std::to_string(100000 + i) + ".svg"),
+            std::filesystem::copy_options::overwrite_existing);
+    }
+    compile_glyph_bundle(dir.string(), bundle_path);
+
+    std::cout << "GLYPH BUNDLE (" << num_glyphs << " glyphs)\n\n";
+    const double us_parse = time_us([&]() {
+        for (int i = 0; i < num_glyphs; i++) {
+            for (const std::string& path : get_paths_from_svg((dir / (std::to_string(100000 + i) + ".svg")).string())) {
+                parse_path(path);
+            }
+        }
+    }, 1);
+    const double us_open = time_us([&]() {
+        const GlyphBundle bundle(bundle_path);
+        bundle.find_glyph(100000 + num_glyphs - 1);
+    }, 10);
+    std::cout << std::left << std::setw(36) << "load: parse SVG files (ms)" << std::right << std::setw(12) << std::fixed
+        << std::setprecision(2) << us_parse / 1000 << "\n";
+    std::cout << std::left << std::setw(36) << "load: map bundle (ms)" << std::right << std::setw(12) << us_open / 1000 << "\n";
+
+    const GlyphBundle bundle(bundle_path);
+    std::cout << std::left << std::setw(36) << "draw: draw_svg (us)" << std::right << std::setw(12)
+        << time_us([&]() { draw_svg(pixels, black, "19976.svg"); }, 10) << "\n";
+    std::cout << std::left << std::setw(36) << "draw: GlyphBundle::draw_glyph (us)" << std::right << std::setw(12)
+        << time_us([&]() { bundle.draw_glyph(pixels, black, 100000); }, NUM_REPS) << "\n";
+    std::filesystem::remove_all(dir);
+    std::cout << "\n";
+}
+
+static void bench_stamp_cache(std::vector<std::uint32_t>& pixels)
+{
+    // Scatter plot: markers of a few sizes at pseudo-random positions,
+    // kept off the edges since draw_circle_midpoint does not clip
+    constexpr int num_markers = 10000;
+    std::vector<std::array<int, 3>> markers(num_markers);
+    std::uint32_t seed = 12345;
+    for (std::array<int, 3>& marker : markers) {
+        seed = seed * 1664525 + 1013904223;
+        marker[0] = 40 + static_cast<int>(seed >> 8) % (SCREEN_WIDTH - 80);
+        seed = seed * 1664525 + 1013904223;
+        marker[1] = 40 + static_cast<int>(seed >> 8) % (SCREEN_HEIGHT - 80);
+        marker[2] = 3 + static_cast<int>(seed >> 28) % 4;
+    }
+
+    std::cout << "STAMP CACHE (" << num_markers << " markers)\n\n";
+    std::cout << std::left << std::setw(24) << "" << std::right << std::setw(12) << "us"
+        << std::setw(12) << "hit rate" << std::setw(12) << "evictions" << "\n";
+    const auto report = [](const std::string& name, const double us, const StampCache* cache) {
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2) << std::setw(12) << us;
+        if (cache != nullptr) {
+            std::cout << std::setw(12) << cache->get_hit_rate() << std::setw(12) << cache->get_stats().evictions;
+        }
+        std::cout << "\n";
+    };
+    report("circles, direct", time_us([&]() {
+        for (const std::array<int, 3>& marker : markers) {
+            draw_circle_midpoint(pixels, black, marker[0], marker[1], marker[2]);
+        }
+    }, 10), nullptr);
+    StampCache cache;
+    report("circles, cached", time_us([&]() {
+        for (const std::array<int, 3>& marker : markers) {
+            cache.draw_circle(pixels, black, marker[0], marker[1], marker[2]);
+        }
+    }, 10), &cache);
+    report("cubics, direct", time_us([&]() {
+        for (const std::array<int, 3>& marker : markers) {
+            const int x = marker[0];
+            const int y = marker[1];
+            draw_bezier_cubic(pixels, black, x, y, x + 10, y - 12, x + 20, y + 12, x + 30, y);
+        }
+    }, 10), nullptr);
+    cache.clear();
+    cache.reset_stats();
+    report("cubics, cached", time_us([&]() {
+        for (const std::array<int, 3>& marker : markers) {
+            const int x = marker[0];
+            const int y = marker[1];
+            cache.draw_bezier_cubic(pixels, black, x, y, x + 10, y - 12, x + 20, y + 12, x + 30, y);
+        }
+    }, 10), &cache);
+    // Too small for all four radii at once, so most draws miss
+    StampCache small_cache(40);
+    report("circles, 40-span cache", time_us([&]() {
+        for (const std::array<int, 3>& marker : markers) {
+            small_cache.draw_circle(pixels, black, marker[0], marker[1], marker[2]);
+        }
+    }, 10), &small_cache);
+    std::cout << "\n";
+}
+
+static void bench_row_executor(std::vector<std::uint32_t>& pixels)
+{
+    RowExecutor& executor = get_row_executor();
+    const int num_threads = executor.get_num_threads();
+    const Kernels& kernels = get_kernels();
+
+    // A circle outline to scan and fill
+    std::vector<std::uint32_t> outline(NUM_PIXELS, blank);
+    draw_circle_midpoint(outline, black, X_MID_SCREEN, Y_MID_SCREEN, SCREEN_HEIGHT / 2 - 10);
+    const auto run_cases = [&]() {
+        std::vector<double> us;
+        us.push_back(time_us([&]() {
+            executor.for_each_band(0, SCREEN_HEIGHT, TEXTURE_PITCH, [&](const int y0, const int y1) {
+                kernels.fill_u32(pixels.data() + (y0 * SCREEN_WIDTH), (y1 - y0) * SCREEN_WIDTH, blank);
+            });
+        }, NUM_REPS));
+        us.push_back(time_us([&]() { get_bounding_rect(outline, black); }, NUM_REPS));
+        us.push_back(time_us([&]() { pixels = outline; scanline_fill(pixels, black); }, NUM_REPS));
+        us.push_back(time_us([&]() { draw_svg(pixels, black, "19976.svg"); }, 10));
+        return us;
+    };
+
+    std::cout << "ROW EXECUTOR (us per frame)\n\n";
+    std::cout << std::left << std::setw(24) << "threads" << std::right << std::setw(12) << "clear"
+        << std::setw(12) << "bbox" << std::setw(12) << "scanline" << std::setw(12) << "svg" << "\n";
+    for (const int n : {1, num_threads}) {
+        executor.set_num_threads(n);
+        std::cout << std::left << std::setw(24) << n << std::right << std::fixed << std::setprecision(2);
+        for (const double us : run_cases()) {
+            std::cout << std::setw(12) << us;
+        }
+        std::cout << "\n";
+        if (num_threads == 1) {
+            break;
+        }
+    }
+    executor.set_num_threads(num_threads);
+    std::cout << "\n";
+}
+
+// Counts how a routine spends its cycles. prepare() sets up the frame
+// outside the measurement, func() is measured, and the pixels it changes
+// on the first run are what the per-pixel figures divide by (for scans,
+// the pixels scanned are passed instead).
+static void bench_perf_counters(std::vector<std::uint32_t>& pixels)
+{
+    constexpr int reps = 10;
+    std::cout << "HARDWARE COUNTERS (per pixel, " << reps << " runs, serial)\n\n";
+    PerfCounters counters;
+    if (!counters.is_available()) {
+        std::cout << "unavailable: " << counters.get_error() << "\n\n";
+        return;
+    }
+    // Pool threads are not counted, so everything runs on this thread
+    RowExecutor& executor = get_row_executor();
+    const int num_threads = executor.get_num_threads();
+    executor.set_num_threads(1);
+
+    std::cout << std::left << std::setw(24) << "" << std::right << std::setw(10) << "pixels" << std::setw(10) << "cycles"
+        << std::setw(8) << "IPC" << std::setw(12) << "L1d miss" << std::setw(12) << "LLC miss"
+        << std::setw(12) << "br miss" << std::setw(12) << "dTLB miss" << "\n";
+    const auto measure = [&](const std::string& name, const std::function<void()>& prepare,
+        const std::function<void()>& func, std::size_t num_pixels) {
+        PerfSample total{};
+        total.valid.fill(true);
+        for (int i = 0; i < reps; i++) {
+            prepare();
+            const std::vector<std::uint32_t> before = i == 0 && num_pixels == 0 ? pixels : std::vector<std::uint32_t>();
+            counters.start();
+            func();
+            const PerfSample sample = counters.stop();
+            for (std::size_t k = 0; k < NUM_PERF_EVENTS; k++) {
+                total.values[k] += sample.values[k];
+                total.valid[k] = total.valid[k] && sample.valid[k];
+            }
+            if (!before.empty()) {
+                for (std::size_t k = 0; k < NUM_PIXELS; k++) {
+                    num_pixels += before[k] != pixels[k];
+                }
+            }
+        }
+        const double per_pixel = 1.0 / (static_cast<double>(std::max<std::size_t>(num_pixels, 1)) * reps);
+        const auto print = [&](const PerfEvent event, const int width, const int precision) {
+            if (total.has(event)) {
+                std::cout << std::setw(width) << std::setprecision(precision) << total.get(event) * per_pixel;
+            } else {
+                std::cout << std::setw(width) << "-";
+            }
+        };
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setw(10) << num_pixels;
+        print(PerfEvent::cycles, 10, 1);
+        if (total.has(PerfEvent::cycles) && total.has(PerfEvent::instructions) && total.get(PerfEvent::cycles) > 0) {
+            std::cout << std::setw(8) << std::setprecision(2)
+                << static_cast<double>(total.get(PerfEvent::instructions)) / total.get(PerfEvent::cycles);
+        } else {
+            std::cout << std::setw(8) << "-";
+        }
+        print(PerfEvent::l1d_misses, 12, 4);
+        print(PerfEvent::llc_misses, 12, 4);
+        print(PerfEvent::branch_misses, 12, 4);
+        print(PerfEvent::dtlb_misses, 12, 4);
+        std::cout << "\n";
+    };
+    const auto clear = [&]() { std::fill(pixels.begin(), pixels.end(), blank); };
+    const auto draw_disc_outline = [&]() {
+        clear();
+        draw_circle_midpoint(pixels, black, X_MID_SCREEN, Y_MID_SCREEN, SCREEN_HEIGHT / 4);
+    };
+
+    static const std::array<std::pair<std::string, void (*)(std::vector<std::uint32_t>&, const std::uint32_t, const int, const int, const int, const int)>, 4> lines = {{
+        {"line_dda", &draw_line_dda},
+        {"line_bresenham", &draw_line_bresenham},
+        {"line_zingl", &draw_line_zingl},
+        {"line_run_slice", &draw_line_run_slice}
+    }};
+    for (const auto& line : lines) {
+        measure(line.first, clear, [&]() {
+            for (int x = 0; x < SCREEN_WIDTH; x += 240) {
+                line.second(pixels, red, x, 0, SCREEN_WIDTH - 1 - x, SCREEN_HEIGHT - 1);
+            }
+            for (int y = 0; y < SCREEN_HEIGHT; y += 135) {
+                line.second(pixels, red, 0, y, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1 - y);
+            }
+        }, 0);
+    }
+    measure("circle_midpoint", clear, [&]() { draw_circle_midpoint(pixels, red, X_MID_SCREEN, Y_MID_SCREEN, SCREEN_HEIGHT / 3); }, 0);
+    measure("bezier_quad", clear, [&]() { draw_bezier_quad(pixels, red, 100, 100, 600, 900, 1200, 200); }, 0);
+    measure("bezier_cubic", clear, [&]() { draw_bezier_cubic(pixels, red, 100, 900, 400, 100, 900, 1000, 1500, 100); }, 0);
+    StrokeStyle style;
+    style.width = 48;
+    const std::vector<Point> polyline = {{200, 800}, {500, 300}, {800, 800}, {1100, 300}, {1400, 800}, {1700, 300}};
+    measure("stroke_polyline", clear, [&]() { draw_stroke_polyline(pixels, red, polyline, style); }, 0);
+    measure("svg 19976", clear, [&]() { draw_svg(pixels, red, "19976.svg"); }, 0);
+    measure("get_bounding_rect", draw_disc_outline, [&]() { get_bounding_rect(pixels, black); }, NUM_PIXELS);
+    measure("scanline_fill", draw_disc_outline, [&]() { scanline_fill(pixels, black); }, 0);
+    measure("flood_fill_stack", draw_disc_outline, [&]() { flood_fill_stack(pixels, black, X_MID_SCREEN, Y_MID_SCREEN); }, 0);
+
+    executor.set_num_threads(num_threads);
+    std::cout << "\n";
+}
+
+static void bench_kernels(std::vector<std::uint32_t>& pixels)
+{
+    // A 1920x1080 bit mask with every other 8-pixel group set
+    std::vector<std::uint64_t> bits(NUM_PIXELS / 64, 0x00FF00FF00FF00FFULL);
+    pixels[NUM_PIXELS - 1] = red;
+    // Two frames that differ only in their last pixel
+    const std::vector<std::uint32_t> frame_a(NUM_PIXELS, blank);
+    std::vector<std::uint32_t> frame_b = frame_a;
+    frame_b[NUM_PIXELS - 1] = red;
+
+    std::cout << "KERNELS (us per full frame, selected: " << get_isa_level_name(get_isa_level()) << ")\n\n";
+    std::cout << std::left << std::setw(8) << "isa" << std::right << std::setw(12) << "fill"
+        << std::setw(12) << "blend" << std::setw(12) << "expand" << std::setw(12) << "find"
+        << std::setw(12) << "find_last" << std::setw(12) << "mismatch" << "\n";
+    for (int level = 0; level <= static_cast<int>(get_supported_isa_level()); level++) {
+        const Kernels& kernels = get_kernels(static_cast<IsaLevel>(level));
+        std::cout << std::left << std::setw(8) << get_isa_level_name(static_cast<IsaLevel>(level))
+            << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << time_us([&]() { kernels.fill_u32(pixels.data(), NUM_PIXELS - 1, blank); }, NUM_REPS)
+            << std::setw(12) << time_us([&]() { kernels.blend_u32(pixels.data(), NUM_PIXELS - 1, 0x80FF0000); }, NUM_REPS)
+            << std::setw(12) << time_us([&]() { kernels.expand_bits_u32(pixels.data(), bits.data(), bits.size() - 1, blue); }, NUM_REPS)
+            << std::setw(12) << time_us([&]() { kernels.find_u32(pixels.data(), NUM_PIXELS, red); }, NUM_REPS)
+            << std::setw(12) << time_us([&]() { kernels.find_last_u32(pixels.data(), NUM_PIXELS, green); }, NUM_REPS)
+            << std::setw(12) << time_us([&]() { kernels.mismatch_u32(frame_a.data(), frame_b.data(), NUM_PIXELS); }, NUM_REPS)
+            << "\n";
+    }
+    std::cout << "\n";
+}
+
+int main(int argc, char* argv[])
+{
+    // --stats <file>: write the instrumentation counters as JSON on exit
+    std::string stats_path;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--stats" && i + 1 < argc) {
+            stats_path = argv[++i];
+        }
+    }
+
+    std::vector<std::uint32_t> pixels(NUM_PIXELS, blank);
+    bench_lines(pixels);
+    bench_sinks(pixels);
+    bench_anti_aliasing(pixels);
+    bench_strokes(pixels);
+    bench_display_list(pixels);
+    bench_render_job(pixels);
+    bench_stroke_animation(pixels);
+    bench_scene(pixels);
+    bench_spatial_grid();
+    bench_tiled_canvas();
+    bench_export(pixels);
+    bench_frame_stream();
+    bench_path_lod(pixels);
+    bench_span_shapes(pixels);
+    bench_glyph_bundle(pixels);
+    bench_stamp_cache(pixels);
+    bench_row_executor(pixels);
+    bench_kernels(pixels);
+    bench_perf_counters(pixels);
+    if (!stats_path.empty()) {
+        write_instrument_json(stats_path);
+    }
+    return 0;
+}
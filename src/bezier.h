@@ -5,6 +5,8 @@
 #include <tuple>
 #include <vector>
 
+class TiledCanvas;
+
 double bezier_quad(const double t, const int c0, const int c1, const int c2);
 double bezier_quad_d1(const double t, const int c0, const int c1, const int c2);
 double bezier_quad_d2(const int c0, const int c1, const int c2);
@@ -49,4 +51,41 @@ void draw_bezier_cubic(
     int x3, int y3
 );
 
+// Anti-aliased: blend the color over the pixels by their coverage.
+// Pixels outside the screen are discarded. The cubic is drawn as
+// quadratic pieces within half a pixel of it.
+void draw_bezier_quad_aa(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    int x0, int y0,
+    int x1, int y1,
+    int x2, int y2
+);
+
+void draw_bezier_cubic_aa(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    int x0, int y0,
+    float x1, float y1,
+    float x2, float y2,
+    int x3, int y3
+);
+
+void draw_bezier_quad(
+    TiledCanvas& canvas,
+    const std::uint32_t color,
+    int x0, int y0,
+    int x1, int y1,
+    int x2, int y2
+);
+
+void draw_bezier_cubic(
+    TiledCanvas& canvas,
+    const std::uint32_t color,
+    int x0, int y0,
+    float x1, float y1,
+    float x2, float y2,
+    int x3, int y3
+);
+
 #endif
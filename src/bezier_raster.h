@@ -0,0 +1,716 @@
+#ifndef BEZIER_RASTER_H
+#define BEZIER_RASTER_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include "line_raster.h"
+#include "instrument.h"
+
+// Bezier rasterizers templated on a pixel sink (see pixel_sink.h).
+// The functions in bezier.h are instantiations of these.
+// The following algorithms were all taken from:
+// "A Rasterizing Algorithm for Drawing Curves" by Alois Zingl
+
+template <typename Sink>
+void rasterize_bezier_quad_seg(
+    Sink& sink,
+    int x0, int y0,
+    int x1, int y1,
+    int x2, int y2)
+{
+    INSTRUMENT_ADD(bezier_quad, segments, 1);
+    int sx = x2 - x1;
+    int sy = y2 - y1;
+    // Relative values for checks
+    long xx = x0 - x1;
+    long yy = y0 - y1;
+    // Sign of gradient must not change
+    assert(xx * sx <= 0 && yy * sy <= 0);
+    // Curvature
+    double cur = (xx * sy) - (yy * sx);
+
+    if ((sx * static_cast<long>(sx)) + (sy * static_cast<long>(sy)) > (xx * xx) + (yy * yy)) {
+        // Begin with longer part.
+        // Swap P0 and P2.
+        x2 = x0;
+        x0 = sx + x1;
+        y2 = y0;
+        y0 = sy + y1;
+        cur = -cur;
+    }
+
+    // Not a straight line
+    if (cur != 0) {
+        // X step direction
+        xx += sx;
+        sx = x0 < x2 ? 1 : -1;
+        xx *= sx;
+        // Y step direction
+        yy += sy;
+        sy = y0 < y2 ? 1 : -1;
+        yy *= sy;
+        // Differences 2nd degree
+        long xy = 2 * xx * yy;
+        xx *= xx;
+        yy *= yy;
+
+        // Negated curvature
+        if (cur * sx * sy < 0) {
+            xx = -xx;
+            yy = -yy;
+            xy = -xy;
+            cur = -cur;
+        }
+
+        double dx = (4.0 * sy * cur * (x1 - x0)) + xx - xy;
+        double dy = (4.0 * sx * cur * (y0 - y1)) + yy - xy;
+        xx += xx;
+        yy += yy;
+        double err = dx + dy + xy;
+
+        do {
+            sink.plot(x0, y0);
+            INSTRUMENT_ADD(bezier_quad, pixels, 1);
+            if (x0 == x2 && y0 == y2) {
+                // Last pixel; curve finished
+                return;
+            }
+            const double two_err = 2 * err;
+            const bool two_err_lt_dx = two_err < dx;
+            // X step
+            if (two_err > dy) {
+                x0 += sx;
+                dx -= xy;
+                dy += yy;
+                err += dy;
+            }
+            // Y step
+            if (two_err_lt_dx) {
+                y0 += sy;
+                dy -= xy;
+                dx += xx;
+                err += dx;
+            }
+        } while (dy < 0 && dx > 0); // Algorithm fails if gradient negates
+    }
+
+    // Plot remaining part to end
+    INSTRUMENT_ADD(bezier_quad, pixels, std::max(std::abs(x2 - x0), std::abs(y2 - y0)) + 1);
+    rasterize_line_bresenham(sink, x0, y0, x2, y2);
+}
+
+// Cuts a quadratic Bezier at its horizontal and vertical extrema and
+// calls emit_segment(x0, y0, x1, y1, x2, y2) with each of the monotonic
+// pieces, in order
+template <typename SegmentFunc>
+void split_bezier_quad(
+    int x0, int y0,
+    int x1, int y1,
+    int x2, int y2,
+    SegmentFunc&& emit_segment)
+{
+    int x = x0 - x1;
+    int y = y0 - y1;
+    double t = x0 - (2 * x1) + x2;
+
+    // horizontal cut at P4?
+    if (static_cast<long>(x) * (x2 - x1) > 0) {
+        // Vertical cut at P6 too? And which first?
+        if ((static_cast<long>(y) * (y2 - y1) > 0) && (std::fabs(((y0 - (2 * y1) + y2) / t) * x) > std::abs(y))) {
+            // Swap points.
+            // Now the horizontal cut at P4 comes first.
+            x0 = x2;
+            x2 = x + x1;
+            y0 = y2;
+            y2 = y + y1;    
+        }
+        t = (x0 - x1) / t;
+        // By (t = P4)
+        double r = ((1 - t) * (((1 - t) * y0) + (2.0 * t * y1))) + (t * t * y2);
+        // Gradient dP4 / dx = 0
+        t = (((x0 * x2) - (x1 * x1)) * t) / (x0 - x1);
+        x = std::floor(t + 0.5);
+        y = std::floor(r + 0.5);
+        // Intersect P3 | P0 P1
+        r = (((y1 - y0) * (t - x0)) / (x1 - x0)) + y0;
+        emit_segment(x0, y0, x, std::floor(r + 0.5), x, y);
+        // Intersect P4 | P1 P2
+        r = (((y1 - y2) * (t - x2)) / (x1 - x2)) + y2;
+        // P0 = P4, P1 = P8
+        x1 = x;
+        x0 = x1;
+        y0 = y;
+        y1 = std::floor(r + 0.5);
+    }
+
+    // Vertical cut at P6?
+    if (static_cast<long>(y0 - y1) * (y2 - y1) > 0) {
+        t = y0 - (2 * y1) + y2;
+        t = (y0 - y1) / t;
+        // Bx(t = P6)
+        double r = ((1 - t) * (((1 - t) * x0) + (2.0 * t * x1))) + (t * t * x2);
+        // Gradient dP6 / dy = 0
+        t = (((y0 * y2) - (y1 * y1)) * t) / (y0 - y1);
+        x = std::floor(r + 0.5);
+        y = std::floor(t + 0.5);
+        // Intersect P6 | P0 P1
+        r = (((x1 - x0) * (t - y0)) / (y1 - y0)) + x0;
+        emit_segment(x0, y0, std::floor(r + 0.5), y, x, y);
+        // Intersect P7 | P1 P2
+        r = (((x1 - x2) * (t - y2)) / (y1 - y2)) + x2;
+        // P0 = P6, P1 = P7
+        x0 = x;
+        x1 = std::floor(r + 0.5);
+        y1 = y;
+        y0 = y1;
+    }
+
+    // Remaining part
+    emit_segment(x0, y0, x1, y1, x2, y2);
+}
+
+template <typename Sink>
+void rasterize_bezier_quad(
+    Sink& sink,
+    const int x0, const int y0,
+    const int x1, const int y1,
+    const int x2, const int y2)
+{
+    split_bezier_quad(x0, y0, x1, y1, x2, y2, [&](const int ax, const int ay, const int bx, const int by, const int cx, const int cy) {
+        rasterize_bezier_quad_seg(sink, ax, ay, bx, by, cx, cy);
+    });
+}
+
+// Zingl scales the error of the anti-aliased quadratic Bezier to a
+// distance by the larger component of its gradient times
+// 1 + 2 r^2 / (4 + r^2), r the ratio of the smaller component to it.
+// The factor, in 16.16 fixed point, for r = i / 16 up to 16.
+struct QuadGradientFactors {
+    std::array<std::int64_t, 257> factors;
+
+    constexpr QuadGradientFactors() : factors()
+    {
+        for (std::int64_t i = 0; i < 257; i++) {
+            factors[i] = (std::int64_t{1} << 16) + (((2 * i * i) << 16) / (1024 + (i * i)));
+        }
+    }
+};
+
+inline constexpr QuadGradientFactors QUAD_GRADIENT_FACTORS;
+
+// Most pixels rasterize_bezier_quad_seg_aa steps in one direction before
+// it recomputes the gradient length
+constexpr int QUAD_AA_RUN = 8;
+
+// Approximate length of the gradient of the implicit curve, from its
+// larger component and the smaller, possibly negative, one
+inline std::int64_t get_quad_gradient_length(const std::int64_t longer, const std::int64_t shorter)
+{
+    if (longer <= 0) {
+        return 1;
+    }
+    const std::int64_t i = std::min((std::abs(shorter) << 4) / longer, std::int64_t{256});
+    return std::max((longer * QUAD_GRADIENT_FACTORS.factors[i]) >> 16, std::int64_t{1});
+}
+
+// Anti-aliased rasterize_bezier_quad_seg, with the error terms in 64-bit
+// integers. Coverage comes from the error over the gradient length, as
+// for the line; the pixel beside each step is blended too while the
+// curve passes within a pixel of it.
+template <typename Sink>
+void rasterize_bezier_quad_seg_aa(
+    Sink& sink,
+    int x0, int y0,
+    int x1, int y1,
+    int x2, int y2)
+{
+    INSTRUMENT_ADD(bezier_quad, segments, 1);
+    int sx = x2 - x1;
+    int sy = y2 - y1;
+    std::int64_t xx = x0 - x1;
+    std::int64_t yy = y0 - y1;
+    // Sign of gradient must not change
+    assert(xx * sx <= 0 && yy * sy <= 0);
+    std::int64_t cur = (xx * sy) - (yy * sx);
+
+    if ((sx * static_cast<std::int64_t>(sx)) + (sy * static_cast<std::int64_t>(sy)) > (xx * xx) + (yy * yy)) {
+        // Begin with longer part
+        x2 = x0;
+        x0 = sx + x1;
+        y2 = y0;
+        y0 = sy + y1;
+        cur = -cur;
+    }
+
+    if (cur != 0) {
+        xx += sx;
+        sx = x0 < x2 ? 1 : -1;
+        xx *= sx;
+        yy += sy;
+        sy = y0 < y2 ? 1 : -1;
+        yy *= sy;
+        std::int64_t xy = 2 * xx * yy;
+        xx *= xx;
+        yy *= yy;
+
+        if (cur * sx * sy < 0) {
+            xx = -xx;
+            yy = -yy;
+            xy = -xy;
+            cur = -cur;
+        }
+
+        std::int64_t dx = (4 * sy * cur * (x1 - x0)) + xx - xy;
+        std::int64_t dy = (4 * sx * cur * (y0 - y1)) + yy - xy;
+        xx += xx;
+        yy += yy;
+        std::int64_t err = dx + dy + xy;
+
+        // The gradient length, and the reciprocal that coverage divides
+        // by, change little from one pixel to the next. Each costs a
+        // divide, so both are only recomputed where the step direction
+        // changes, and at least every QUAD_AA_RUN pixels on long runs.
+        std::int64_t ed = 1;
+        AaCoverage coverage(ed);
+        int step = -1;
+        int last_step = -2;
+        int run = 0;
+        do {
+            if (step != last_step || run == QUAD_AA_RUN) {
+                ed = get_quad_gradient_length(std::max(dx + xy, -xy - dy), std::min(dx + xy, -xy - dy));
+                coverage = AaCoverage(ed);
+                run = 0;
+            }
+            run++;
+            last_step = step;
+            sink.blend(x0, y0, coverage(std::abs(err - dx - dy - xy)));
+            INSTRUMENT_ADD(bezier_quad, pixels, 1);
+            if (x0 == x2 || y0 == y2) {
+                break;
+            }
+            const int x_prev = x0;
+            const std::int64_t x_side = dx - err;
+            const bool step_y = (2 * err) + dy < 0;
+            const bool step_x = (2 * err) + dx > 0;
+            step = (step_x ? 1 : 0) + (step_y ? 2 : 0);
+            // X step
+            if (step_x) {
+                if (err - dy < ed) {
+                    sink.blend(x0, y0 + sy, coverage(err - dy));
+                }
+                x0 += sx;
+                dx -= xy;
+                dy += yy;
+                err += dy;
+            }
+            // Y step
+            if (step_y) {
+                if (x_side < ed) {
+                    sink.blend(x_prev + sx, y0, coverage(x_side));
+                }
+                y0 += sy;
+                dy -= xy;
+                dx += xx;
+                err += dx;
+            }
+        } while (dy < dx);
+    }
+
+    // Plot remaining part to end
+    INSTRUMENT_ADD(bezier_quad, pixels, std::max(std::abs(x2 - x0), std::abs(y2 - y0)) + 1);
+    rasterize_line_zingl_aa(sink, x0, y0, x2, y2);
+}
+
+template <typename Sink>
+void rasterize_bezier_quad_aa(
+    Sink& sink,
+    const int x0, const int y0,
+    const int x1, const int y1,
+    const int x2, const int y2)
+{
+    split_bezier_quad(x0, y0, x1, y1, x2, y2, [&](const int ax, const int ay, const int bx, const int by, const int cx, const int cy) {
+        rasterize_bezier_quad_seg_aa(sink, ax, ay, bx, by, cx, cy);
+    });
+}
+
+template <typename Sink>
+void rasterize_bezier_cubic_seg(
+    Sink& sink,
+    int x0, int y0,
+    float x1, float y1,
+    float x2, float y2,
+    int x3, int y3)
+{
+    INSTRUMENT_ADD(bezier_cubic, segments, 1);
+    // Step direction
+    int sx = x0 < x3 ? 1 : -1;
+    int sy = y0 < y3 ? 1 : -1;
+
+    float xc = -std::fabs(x0 + x1 - x2 - x3);
+    float xa = xc - (4 * sx * (x1 - x2));
+    float xb = sx * (x0 - x1 - x2 + x3);
+    float yc = -std::fabs(y0 + y1 - y2 -y3);
+    float ya = yc - (4 * sy * (y1 - y2));
+    float yb = sy * (y0 - y1 - y2 + y3);
+    double EP = 0.01;
+
+    // Check for curve restraints:
+    // Slope P0-P1 == P2-P3 and (P0-P3 == P1-P2 or no slope change) 
+    assert((x1 - x0) * (x2 - x3) < EP && ((x3 - x0) * (x1 - x2) < EP || xb * xb < (xa * xc) + EP));
+    assert((y1 - y0) * (y2 - y3) < EP && ((y3 - y0) * (y1 - y2) < EP || yb * yb < (ya * yc) + EP));
+
+    // quadratic Bezier
+    if (xa == 0 && ya == 0) {
+        // New midpoint
+        sx = std::floor(((3 * x1) - x0 + 1) / 2);
+        sy = std::floor(((3 * y1) - y0 + 1) / 2);
+        rasterize_bezier_quad_seg(sink, x0, y0, sx, sy, x3, y3);
+        return;
+    }
+
+    // Line lengths
+    x1 = ((x1 - x0) * (x1 - x0)) + ((y1 - y0) * (y1 - y0)) + 1;
+    x2 = ((x2 - x3) * (x2 - x3)) + ((y2 - y3) * (y2 - y3)) + 1;
+    int leg = 1;
+    // loop over both ends
+    do {
+        double ab = (xa * yb) - (xb * ya);
+        double ac = (xa * yc) - (xc * ya);
+        double bc = (xb * yc) - (xc * yb);
+        // P0 part of self-intersection loop?
+        double ex = (ab * (ab + ac - (3 * bc))) + (ac * ac);
+        // Calculate resolution
+        int f = ex > 0 ? 1 : std::sqrt(1 + (1024/x1));
+        // Increase resolution
+        ab *= f;
+        ac *= f;
+        bc *= f;
+        ex *= f * f;
+
+        // Init differences of 1st degree
+        double xy = (9 * (ab + ac + bc)) / 8;
+        double cb = 8 * (xa - ya);
+        double dx = (27 * (8*ab*(yb*yb-ya*yc)+ex*(ya+2*yb+yc)) / 64) - (ya * ya * (xy - ya));
+        double dy = (27 * (8*ab*(xb*xb-xa*xc)-ex*(xa+2*xb+xc)) / 64) - (xa * xa * (xy + xa));
+
+        // Init differences of 2nd degree
+        double xx = 3*(3*ab*(3*yb*yb-ya*ya-2*ya*yc)-ya*(3*ac*(ya+yb)+ya*cb))/4;
+        double yy = 3*(3*ab*(3*xb*xb-xa*xa-2*xa*xc)-xa*(3*ac*(xa+xb)+xa*cb))/4;
+        xy = xa * ya * ((6 * ab) + (6 * ac) - (3 * bc) + cb);
+        ac = ya * ya;
+        cb = xa * xa;
+        xy = 3 * (xy + (9 * f * ((cb * yb * yc) - (xb * xc * ac))) - (18 * xb * yb * ab)) / 8;
+
+        if (ex < 0) {
+            // Negate values if inside self-intersection loop
+            dx = -dx;
+            dy = -dy;
+            xx = -xx;
+            yy = -yy;
+            xy = -xy;
+            ac = -ac;
+            cb = -cb;
+        }
+
+        // Init differences of 3rd degree
+        ab =  6 * ya * ac;
+        ac = -6 * xa * ac;
+        bc =  6 * ya * cb;
+        cb = -6 * xa * cb;
+
+        // Error of 1st step
+        dx += xy;
+        ex = dx + dy;
+        dy += xy; 
+
+        double* pxy = &xy;
+        double fx = f;
+        double fy = f;
+        while (x0 != x3 && y0 != y3) {
+            bool should_exit_for_loop = false;
+            sink.plot(x0, y0);
+            INSTRUMENT_ADD(bezier_cubic, pixels, 1);
+            do {
+                // Move sub-steps of one pixel
+                // Confusing values
+                if (dx > *pxy || dy < *pxy) {
+                    should_exit_for_loop = true;
+                    break;
+                }
+                INSTRUMENT_ADD(bezier_cubic, sub_steps, 1);
+                // Save value for test of y step
+                y1 = (2 * ex) - dy;
+                if (2 * ex >= dx) {
+                    // X sub-step
+                    fx--;
+                    dx += xx;
+                    ex += dx;
+                    xy += ac;
+                    dy += xy;
+                    yy += bc;
+                    xx += ab;
+                }
+                if (y1 <= 0) {
+                    // Y sub-step
+                    fy--;
+                    dy += yy;
+                    ex += dy;
+                    xy += bc;
+                    dx += xy;
+                    xx += ac;
+                    yy += cb;
+                }
+            } while (fx > 0 && fy > 0); // Pixel complete?
+
+            if (should_exit_for_loop) {
+                break;
+            }
+
+            if (2 * fx <= f) {
+                // X step
+                x0 += sx;
+                fx += f;
+            }
+            if (2 * fy <= f) {
+                // Y step
+                y0 += sy;
+                fy += f;
+            }
+            if (pxy == &xy && dx < 0 && dy > 0) {
+                // Pixel ahead is valid
+                pxy = &EP;
+            }
+        }
+
+        // Swap legs
+        xx = x0;
+        x0 = x3;
+        x3 = xx;
+        sx = -sx;
+        xb = -xb;
+        yy = y0;
+        y0 = y3;
+        y3 = yy;
+        sy = -sy;
+        yb = -yb;
+        x1 = x2;
+    } while (leg--); // Try other end
+
+    // Remaining part in case of cusp or crunode
+    INSTRUMENT_ADD(bezier_cubic, pixels, std::max(std::abs(x3 - x0), std::abs(y3 - y0)) + 1);
+    rasterize_line_bresenham(sink, x0, y0, x3, y3);
+}
+
+// Cuts a cubic Bezier where the sign of its gradient changes and calls
+// emit_segment(x0, y0, x1, y1, x2, y2, x3, y3) with each of the
+// monotonic pieces, in order; the inner control points are floats
+template <typename SegmentFunc>
+void split_bezier_cubic(
+    int x0, int y0,
+    float x1, float y1,
+    float x2, float y2,
+    int x3, int y3,
+    SegmentFunc&& emit_segment)
+{
+    long xc = x0 + x1 - x2 - x3;
+    long xa = xc - (4 * (x1 - x2));
+    long xb = x0 - x1 - x2 + x3;
+    long xd = xb + (4 * (x1 + x2));
+    long yc = y0 + y1 - y2 - y3;
+    long ya = yc - (4 * (y1 - y2));
+    long yb = y0 - y1 - y2 + y3;
+    long yd = yb + (4 * (y1 + y2));
+    double t1 = (xb * xb) - (xa * xc);
+    std::array<double, 5> t;
+    std::size_t n = 0;
+
+    // Sub-divide curve at gradient sign changes
+    if (xa == 0) {
+        // Horizontal
+        // One change
+        if (std::abs(xc) < 2 * std::abs(xb)) {
+            t.at(n++) = xc / (2.0 * xb);
+        }
+    } else if (t1 > 0.0) {
+        // Two changes
+        double t2 = std::sqrt(t1);
+        t1 = (xb - t2) / xa;
+        if (std::fabs(t1) < 1.0) {
+            t.at(n++) = t1;
+        }
+        t1 = (xb + t2) / xa;
+        if (std::fabs(t1) < 1.0) {
+            t.at(n++) = t1;
+        }
+    }
+
+    t1 = (yb * yb) - (ya * yc);
+    if (ya == 0) {
+        // Vertical
+        // One change
+        if (std::abs(yc) < 2 * std::abs(yb)) {
+            t.at(n++) = yc / (2.0 * yb);
+        }
+    } else if (t1 > 0.0) {
+        // Two changes
+        double t2 = std::sqrt(t1);
+        t1 = (yb - t2) / ya;
+        if (std::fabs(t1) < 1.0) {
+            t.at(n++) = t1;
+        }
+        t1 = (yb + t2) / ya;
+        if (std::fabs(t1) < 1.0) {
+            t.at(n++) = t1;
+        }
+    }
+
+    // Bubble sort of 4 points
+    for (std::size_t i = 1; i < n; i++) {
+        t1 = t.at(i-1);
+        if (t1 > t.at(i)) {
+            t.at(i-1) = t.at(i);
+            t.at(i) = t1;
+            i = 0;
+        }
+    }
+
+    // Begin / end point
+    t1 = -1.0;
+    t.at(n) = 1.0;
+
+    // Plot each segment separately
+    float fx0 = x0;
+    float fy0 = y0;
+    for (std::size_t i = 0; i <= n; i++) {
+        // Sub-divide at t[i-1], t[i]
+        double t2 = t.at(i);
+        float fx1 = (t1*(t1*xb-2*xc)-t2*(t1*(t1*xa-2*xb)+xc)+xd)/8-fx0;
+        float fy1 = (t1*(t1*yb-2*yc)-t2*(t1*(t1*ya-2*yb)+yc)+yd)/8-fy0;
+        float fx2 = (t2*(t2*xb-2*xc)-t1*(t2*(t2*xa-2*xb)+xc)+xd)/8-fx0;
+        float fy2 = (t2*(t2*yb-2*yc)-t1*(t2*(t2*ya-2*yb)+yc)+yd)/8-fy0;
+        float fx3 = (t2*(t2*(3*xb-t2*xa)-3*xc)+xd)/8;
+        fx0 -= fx3;
+        float fy3 = (t2*(t2*(3*yb-t2*ya)-3*yc)+yd)/8;
+        fy0 -= fy3;
+        // Scale bounds to int
+        x3 = std::floor(fx3 + 0.5);
+        y3 = std::floor(fy3 + 0.5);
+        if (fx0 != 0.0) {
+            fx0 = (x0 - x3) / fx0;
+            fx1 *= fx0;
+            fx2 *= fx0;
+        }
+        if (fy0 != 0.0) {
+            fy0 = (y0 - y3) / fy0;
+            fy1 *= fy0;
+            fy2 *= fy0;
+        }
+        if (x0 != x3 || y0 != y3) {
+            // Segment t1 - t2
+            emit_segment(x0, y0, x0 + fx1, y0 + fy1, x0 + fx2, y0 + fy2, x3, y3);
+        }
+        x0 = x3;
+        y0 = y3;
+        fx0 = fx3;
+        fy0 = fy3;
+        t1 = t2;
+    }
+}
+
+template <typename Sink>
+void rasterize_bezier_cubic(
+    Sink& sink,
+    const int x0, const int y0,
+    const float x1, const float y1,
+    const float x2, const float y2,
+    const int x3, const int y3)
+{
+    split_bezier_cubic(x0, y0, x1, y1, x2, y2, x3, y3,
+        [&](const int ax, const int ay, const float bx, const float by, const float cx, const float cy, const int dx, const int dy) {
+            rasterize_bezier_cubic_seg(sink, ax, ay, bx, by, cx, cy, dx, dy);
+        });
+}
+
+// Greatest distance, in pixels, allowed between a monotonic cubic piece
+// and the quadratic pieces standing in for it in the anti-aliased cubic
+constexpr double CUBIC_AA_TOLERANCE = 0.5;
+constexpr int MAX_CUBIC_AA_PIECES = 64;
+
+// Anti-aliased monotonic cubic segment. Zingl's cubic stepper needs
+// floating point in its loop, so the segment is drawn instead as
+// quadratic pieces on the integer stepper. A quadratic through the ends
+// of a cubic with control point (3 (P1 + P2) - P0 - P3) / 4 is within
+// sqrt(3) / 36 |P3 - 3 P2 + 3 P1 - P0| of it, and cutting the cubic into
+// n pieces divides that by n^3, which sets the number of pieces.
+template <typename Sink>
+void rasterize_bezier_cubic_seg_aa(
+    Sink& sink,
+    const int x0, const int y0,
+    const float x1, const float y1,
+    const float x2, const float y2,
+    const int x3, const int y3)
+{
+    INSTRUMENT_ADD(bezier_cubic, segments, 1);
+    const double ex = x3 - (3.0 * x2) + (3.0 * x1) - x0;
+    const double ey = y3 - (3.0 * y2) + (3.0 * y1) - y0;
+    const double dist = std::sqrt(3.0) / 36 * std::sqrt((ex * ex) + (ey * ey));
+    const int n = std::min(static_cast<int>(std::ceil(std::cbrt(dist / CUBIC_AA_TOLERANCE))), MAX_CUBIC_AA_PIECES);
+
+    // Control points of the part not drawn yet
+    std::array<double, 4> px = {static_cast<double>(x0), x1, x2, static_cast<double>(x3)};
+    std::array<double, 4> py = {static_cast<double>(y0), y1, y2, static_cast<double>(y3)};
+    int ax = x0;
+    int ay = y0;
+    for (int i = std::max(n, 1); i > 0; i--) {
+        // Split off the first 1 / i of the rest (de Casteljau)
+        const double t = 1.0 / i;
+        const auto lerp = [t](const double a, const double b) { return a + ((b - a) * t); };
+        const double x01 = lerp(px[0], px[1]);
+        const double y01 = lerp(py[0], py[1]);
+        const double x12 = lerp(px[1], px[2]);
+        const double y12 = lerp(py[1], py[2]);
+        const double x23 = lerp(px[2], px[3]);
+        const double y23 = lerp(py[2], py[3]);
+        const double xa = lerp(x01, x12);
+        const double ya = lerp(y01, y12);
+        const double xb = lerp(x12, x23);
+        const double yb = lerp(y12, y23);
+        const double xm = lerp(xa, xb);
+        const double ym = lerp(ya, yb);
+
+        const int bx = i == 1 ? x3 : static_cast<int>(std::floor(xm + 0.5));
+        const int by = i == 1 ? y3 : static_cast<int>(std::floor(ym + 0.5));
+        // Control point, kept between the rounded ends so that the
+        // piece stays monotonic
+        const int cx = std::clamp(static_cast<int>(std::floor((((3 * (x01 + xa)) - px[0] - xm) / 4) + 0.5)), std::min(ax, bx), std::max(ax, bx));
+        const int cy = std::clamp(static_cast<int>(std::floor((((3 * (y01 + ya)) - py[0] - ym) / 4) + 0.5)), std::min(ay, by), std::max(ay, by));
+        if (ax != bx || ay != by) {
+            rasterize_bezier_quad_seg_aa(sink, ax, ay, cx, cy, bx, by);
+        }
+        px = {xm, xb, x23, px[3]};
+        py = {ym, yb, y23, py[3]};
+        ax = bx;
+        ay = by;
+    }
+}
+
+template <typename Sink>
+void rasterize_bezier_cubic_aa(
+    Sink& sink,
+    const int x0, const int y0,
+    const float x1, const float y1,
+    const float x2, const float y2,
+    const int x3, const int y3)
+{
+    split_bezier_cubic(x0, y0, x1, y1, x2, y2, x3, y3,
+        [&](const int ax, const int ay, const float bx, const float by, const float cx, const float cy, const int dx, const int dy) {
+            rasterize_bezier_cubic_seg_aa(sink, ax, ay, bx, by, cx, cy, dx, dy);
+        });
+}
+
+#endif
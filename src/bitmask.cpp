@@ -0,0 +1,112 @@
+#include "bitmask.h"
+#include <algorithm>
+#include <array>
+#include "fill.h"
+#include "instrument.h"
+#include "kernels.h"
+#include "row_executor.h"
+
+constexpr std::uint64_t ALL_BITS = ~std::uint64_t{0};
+
+BitMask::BitMask(const int width, const int height)
+    : width(width),
+      height(height),
+      words_per_row((width + 63) / 64),
+      words(static_cast<std::size_t>(words_per_row) * height, 0)
+{
+}
+
+void BitMask::set_span(const int x0, const int x1, const int y)
+{
+    std::uint64_t* words_row = row(y);
+    const int w0 = x0 >> 6;
+    const int w1 = x1 >> 6;
+    const std::uint64_t head = ALL_BITS << (x0 & 63);
+    const std::uint64_t tail = ALL_BITS >> (63 - (x1 & 63));
+    if (w0 == w1) {
+        words_row[w0] |= head & tail;
+        return;
+    }
+    words_row[w0] |= head;
+    std::fill(words_row + w0 + 1, words_row + w1, ALL_BITS);
+    words_row[w1] |= tail;
+}
+
+void BitMask::clear()
+{
+    std::fill(words.begin(), words.end(), 0);
+}
+
+void BitMask::reset(const int new_width, const int new_height)
+{
+    width = new_width;
+    height = new_height;
+    words_per_row = (width + 63) / 64;
+    words.assign(static_cast<std::size_t>(words_per_row) * height, 0);
+}
+
+int BitMask::find_next_bit(const int y, const int start, const int end, const bool value) const
+{
+    if (start >= end) {
+        return end;
+    }
+    const std::uint64_t* words_row = row(y);
+    const std::uint64_t flip = value ? 0 : ~std::uint64_t{0};
+    int w = start >> 6;
+    std::uint64_t bits = (words_row[w] ^ flip) & (~std::uint64_t{0} << (start & 63));
+    while (bits == 0) {
+        w++;
+        if (w * 64 >= end) {
+            return end;
+        }
+        bits = words_row[w] ^ flip;
+    }
+    return std::min((w * 64) + __builtin_ctzll(bits), end);
+}
+
+void expand_bitmask(
+    std::vector<std::uint32_t>& pixels,
+    const BitMask& mask,
+    const BoundingRect& rect,
+    const std::uint32_t color)
+{
+    if (rect.x_min > rect.x_max) {
+        return;
+    }
+    const std::size_t row_bytes = sizeof(std::uint32_t) * (rect.x_max - rect.x_min + 1);
+    get_row_executor().for_each_band(rect.y_min, rect.y_max + 1, row_bytes, [&](const int y0, const int y1) {
+        for (int y = y0; y < y1; y++) {
+            expand_bitmask_span(pixels, mask, rect.x_min, rect.x_max, y, color);
+        }
+    });
+}
+
+void expand_bitmask_span(
+    std::vector<std::uint32_t>& pixels,
+    const BitMask& mask,
+    const int x0, const int x1, const int y,
+    const std::uint32_t color)
+{
+    const int w0 = x0 >> 6;
+    const int w1 = x1 >> 6;
+    const std::uint64_t head = ALL_BITS << (x0 & 63);
+    const std::uint64_t tail = ALL_BITS >> (63 - (x1 & 63));
+    const std::uint64_t* words_row = mask.row(y);
+    std::uint32_t* pixels_row = pixels.data() + (y * mask.get_width());
+    // Copied a chunk at a time to mask off the bits outside [x0, x1]
+    std::array<std::uint64_t, 32> chunk;
+    for (int w = w0; w <= w1; w += chunk.size()) {
+        const int n = std::min(static_cast<int>(chunk.size()), w1 - w + 1);
+        std::copy(words_row + w, words_row + w + n, chunk.begin());
+        if (w == w0) {
+            chunk[0] &= head;
+        }
+        if (w + n - 1 == w1) {
+            chunk[n - 1] &= tail;
+        }
+        for (int i = 0; i < n; i++) {
+            INSTRUMENT_ADD(path, pixels, __builtin_popcountll(chunk[i]));
+        }
+        get_kernels().expand_bits_u32(pixels_row + (w * 64), chunk.data(), n, color);
+    }
+}
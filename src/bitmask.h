@@ -0,0 +1,67 @@
+#ifndef BITMASK_H
+#define BITMASK_H
+
+#include <cstdint>
+#include <vector>
+
+struct BoundingRect;
+
+// Packed 1-bit-per-pixel mask, stored row by row in 64-bit words.
+// Bit (x % 64) of word (x / 64) in a row holds pixel x.
+class BitMask {
+public:
+    BitMask(const int width, const int height);
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+    int get_words_per_row() const { return words_per_row; }
+
+    std::uint64_t* row(const int y) { return words.data() + (y * words_per_row); }
+    const std::uint64_t* row(const int y) const { return words.data() + (y * words_per_row); }
+
+    bool test(const int x, const int y) const
+    {
+        return (row(y)[x >> 6] >> (x & 63)) & 1;
+    }
+
+    void set(const int x, const int y)
+    {
+        row(y)[x >> 6] |= std::uint64_t{1} << (x & 63);
+    }
+
+    // Sets pixels x0 through x1 inclusive with whole-word ORs
+    void set_span(const int x0, const int x1, const int y);
+
+    void clear();
+    // Makes the mask width x height and clear, keeping its storage
+    void reset(const int new_width, const int new_height);
+
+    // First x >= start in row y whose bit equals value, or end if there
+    // is none before end. end may reach into the padding of the last word.
+    int find_next_bit(const int y, const int start, const int end, const bool value) const;
+
+private:
+    int width;
+    int height;
+    int words_per_row;
+    std::vector<std::uint64_t> words;
+};
+
+// Writes color to every pixel of the (width x height) frame
+// whose bit is set within the rectangle.
+void expand_bitmask(
+    std::vector<std::uint32_t>& pixels,
+    const BitMask& mask,
+    const BoundingRect& rect,
+    const std::uint32_t color
+);
+
+// The same for pixels x0 through x1 inclusive of row y
+void expand_bitmask_span(
+    std::vector<std::uint32_t>& pixels,
+    const BitMask& mask,
+    const int x0, const int x1, const int y,
+    const std::uint32_t color
+);
+
+#endif
@@ -1,5 +1,7 @@
 #include "circle.h"
-#include "constants.h"
+#include "circle_raster.h"
+#include "pixel_sink.h"
+#include "instrument.h"
 
 void plot_circle_points(
     std::vector<std::uint32_t>& pixels,
@@ -7,36 +9,8 @@ void plot_circle_points(
     const int cx, const int cy,
     const int x, const int y)
 {
-    /*
-       Normal order (x, y):
-       cx + x, cy + y
-       cx - x, cy + y
-       cx + x, cy - y
-       cx - x, cy - y
-       cx + y, cy + x
-       cx - y, cy + x
-       cx + y, cy - x
-       cx - y, cy - x
-     */
-
-    // When accessing the array, the coordinates are in reverse order:
-    // pixels.at((y * SCREEN_WIDTH) + x) = color;
-    const int y_cy_add_y = (cy + y) * SCREEN_WIDTH;
-    const int y_cy_sub_y = (cy - y) * SCREEN_WIDTH; 
-    const int y_cy_add_x = (cy + x) * SCREEN_WIDTH;
-    const int y_cy_sub_x = (cy - x) * SCREEN_WIDTH;
-    const int x_cx_add_x = cx + x;
-    const int x_cx_sub_x = cx - x;
-    const int x_cx_add_y = cx + y;
-    const int x_cx_sub_y = cx - y;
-    pixels[y_cy_add_y + x_cx_add_x] = color;
-    pixels[y_cy_add_y + x_cx_sub_x] = color;
-    pixels[y_cy_sub_y + x_cx_add_x] = color;
-    pixels[y_cy_sub_y + x_cx_sub_x] = color;
-    pixels[y_cy_add_x + x_cx_add_y] = color;
-    pixels[y_cy_add_x + x_cx_sub_y] = color;
-    pixels[y_cy_sub_x + x_cx_add_y] = color;
-    pixels[y_cy_sub_x + x_cx_sub_y] = color;
+    UncheckedSink sink(pixels, color);
+    plot_circle_points(sink, cx, cy, x, y);
 }
 
 void draw_circle_midpoint(
@@ -45,20 +19,34 @@ void draw_circle_midpoint(
     const int cx, const int cy,
     const int radius)
 {
-    int x = 0;
-    int y = radius;
-    int p = 1 - radius;
-
-    plot_circle_points(pixels, color, cx, cy, x, y);
+    INSTRUMENT_SCOPE(circle);
+    UncheckedSink sink(pixels, color);
+    rasterize_circle_midpoint(sink, cx, cy, radius);
+}
 
-    while (x < y) {
-        x++;
-        if (p < 0) {
-            p += (2 * x) + 1;
-        } else {
-            y--;
-            p += (2 * (x - y)) + 1;	
-        }
-        plot_circle_points(pixels, color, cx, cy, x, y);
+void draw_circle_midpoint_aa(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const int cx, const int cy,
+    const int radius)
+{
+    INSTRUMENT_SCOPE(circle);
+    if (is_aa_hull_on_screen(cx - radius, cy - radius, cx + radius, cy + radius)) {
+        UncheckedCoverageSink sink(pixels, color);
+        rasterize_circle_midpoint_aa(sink, cx, cy, radius);
+    } else {
+        CoverageSink sink(pixels, color);
+        rasterize_circle_midpoint_aa(sink, cx, cy, radius);
     }
 }
+
+void draw_circle_midpoint(
+    TiledCanvas& canvas,
+    const std::uint32_t color,
+    const int cx, const int cy,
+    const int radius)
+{
+    INSTRUMENT_SCOPE(circle);
+    TiledCanvasSink sink(canvas, color);
+    rasterize_circle_midpoint(sink, cx, cy, radius);
+}
@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <vector>
 
+class TiledCanvas;
+
 // cx, cy = circle center coordinates
 void plot_circle_points(
     std::vector<std::uint32_t>& pixels,
@@ -19,4 +21,20 @@ void draw_circle_midpoint(
     const int radius
 );
 
+// Anti-aliased: blends the color over the pixels by their coverage.
+// Pixels outside the screen are discarded.
+void draw_circle_midpoint_aa(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const int cx, const int cy,
+    const int radius
+);
+
+void draw_circle_midpoint(
+    TiledCanvas& canvas,
+    const std::uint32_t color,
+    const int cx, const int cy,
+    const int radius
+);
+
 #endif
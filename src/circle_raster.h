@@ -0,0 +1,122 @@
+#ifndef CIRCLE_RASTER_H
+#define CIRCLE_RASTER_H
+
+#include <cstdlib>
+#include "instrument.h"
+#include "line_raster.h"
+
+// Circle rasterizers templated on a pixel sink (see pixel_sink.h).
+// The functions in circle.h are instantiations of these.
+
+// cx, cy = circle center coordinates
+template <typename Sink>
+void plot_circle_points(
+    Sink& sink,
+    const int cx, const int cy,
+    const int x, const int y)
+{
+    /*
+       Normal order (x, y):
+       cx + x, cy + y
+       cx - x, cy + y
+       cx + x, cy - y
+       cx - x, cy - y
+       cx + y, cy + x
+       cx - y, cy + x
+       cx + y, cy - x
+       cx - y, cy - x
+     */
+    sink.plot(cx + x, cy + y);
+    sink.plot(cx - x, cy + y);
+    sink.plot(cx + x, cy - y);
+    sink.plot(cx - x, cy - y);
+    sink.plot(cx + y, cy + x);
+    sink.plot(cx - y, cy + x);
+    sink.plot(cx + y, cy - x);
+    sink.plot(cx - y, cy - x);
+}
+
+template <typename Sink>
+void rasterize_circle_midpoint(
+    Sink& sink,
+    const int cx, const int cy,
+    const int radius)
+{
+    int x = 0;
+    int y = radius;
+    int p = 1 - radius;
+
+    plot_circle_points(sink, cx, cy, x, y);
+
+    while (x < y) {
+        x++;
+        if (p < 0) {
+            p += (2 * x) + 1;
+        } else {
+            y--;
+            p += (2 * (x - y)) + 1;	
+        }
+        plot_circle_points(sink, cx, cy, x, y);
+    }
+    // Eight octant points per step
+    INSTRUMENT_ADD(circle, pixels, 8 * (x + 1));
+}
+
+// Anti-aliased circle after Zingl, stepping a quadrant from (-r, 0) and
+// mirroring it to the other three. The error term is scaled by 2r - 1
+// per pixel of distance from the circle; the pixel on the inside of
+// each step is blended too while it is within a pixel of it.
+template <typename Sink>
+void rasterize_circle_midpoint_aa(
+    Sink& sink,
+    const int cx, const int cy,
+    const int radius)
+{
+    if (radius <= 0) {
+        if (radius == 0) {
+            sink.blend(cx, cy, 255);
+        }
+        return;
+    }
+    int x = -radius;
+    int y = 0;
+    int err = 2 - (2 * radius);
+    const AaCoverage coverage(1 - err);
+
+    do {
+        const std::uint32_t on = coverage(std::abs(err - (2 * (x + y)) - 2));
+        sink.blend(cx - x, cy + y, on);
+        sink.blend(cx - y, cy - x, on);
+        sink.blend(cx + x, cy - y, on);
+        sink.blend(cx + y, cy + x, on);
+        INSTRUMENT_ADD(circle, pixels, 4);
+        const int e2 = err;
+        const int x2 = x;
+        if (err + y > 0) {
+            // X step
+            const std::uint32_t inside = coverage(err - (2 * x) - 1);
+            if (inside > 0) {
+                sink.blend(cx - x, cy + y + 1, inside);
+                sink.blend(cx - y - 1, cy - x, inside);
+                sink.blend(cx + x, cy - y - 1, inside);
+                sink.blend(cx + y + 1, cy + x, inside);
+            }
+            x++;
+            err += (2 * x) + 1;
+        }
+        if (e2 + x2 <= 0) {
+            // Y step
+            const std::uint32_t inside = coverage((2 * y) + 3 - e2);
+            if (inside > 0) {
+                sink.blend(cx - x2 - 1, cy + y, inside);
+                sink.blend(cx - y, cy - x2 - 1, inside);
+                sink.blend(cx + x2 + 1, cy - y, inside);
+                sink.blend(cx + y, cy + x2 + 1, inside);
+            }
+            y++;
+            err += (2 * y) + 1;
+        }
+    } while (x < 0);
+}
+
+#endif
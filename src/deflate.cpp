@@ -0,0 +1,535 @@
+#include "deflate.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+constexpr int WINDOW_SIZE = 32768;
+constexpr int HASH_BITS = 15;
+constexpr int MIN_MATCH = 4;
+constexpr int MAX_MATCH = 258;
+// Symbols per block; each block gets its own Huffman codes
+constexpr std::size_t BLOCK_SYMBOLS = 32768;
+constexpr int MAX_CODE_BITS = 15;
+constexpr int MAX_CODE_LENGTH_BITS = 7;
+constexpr int NUM_LITLEN_CODES = 286;
+constexpr int NUM_DIST_CODES = 30;
+constexpr int NUM_CODE_LENGTH_CODES = 19;
+constexpr int END_OF_BLOCK = 256;
+constexpr std::size_t MAX_STORED_SIZE = 65535;
+
+constexpr std::array<int, 29> LENGTH_BASE = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+constexpr std::array<int, 29> LENGTH_EXTRA = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+constexpr std::array<int, 30> DIST_BASE = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+constexpr std::array<int, 30> DIST_EXTRA = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+// Order in which the code length code lengths are sent
+constexpr std::array<int, NUM_CODE_LENGTH_CODES> CODE_LENGTH_ORDER = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+// A literal (dist == 0) or a match of length litlen at distance dist
+struct LzSymbol {
+    std::uint16_t litlen;
+    std::uint16_t dist;
+};
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<std::uint8_t>& out) : out(out), bits(0), count(0) {}
+
+    void put(const std::uint32_t value, const int n)
+    {
+        bits |= static_cast<std::uint64_t>(value) << count;
+        count += n;
+        if (count >= 32) {
+            const std::uint8_t bytes[4] = {
+                static_cast<std::uint8_t>(bits),
+                static_cast<std::uint8_t>(bits >> 8),
+                static_cast<std::uint8_t>(bits >> 16),
+                static_cast<std::uint8_t>(bits >> 24)
+            };
+            out.insert(out.end(), bytes, bytes + 4);
+            bits >>= 32;
+            count -= 32;
+        }
+    }
+
+    // Pads to a byte boundary and writes out every pending bit
+    void align()
+    {
+        while (count > 0) {
+            out.push_back(static_cast<std::uint8_t>(bits));
+            bits >>= 8;
+            count -= 8;
+        }
+        bits = 0;
+        count = 0;
+    }
+
+private:
+    std::vector<std::uint8_t>& out;
+    std::uint64_t bits;
+    int count;
+};
+
+static int get_length_code(const int length)
+{
+    if (length == MAX_MATCH) {
+        return 285;
+    }
+    const int x = length - 3;
+    if (x < 8) {
+        return 257 + x;
+    }
+    const int nb = 31 - __builtin_clz(x);
+    return 257 + (4 * (nb - 1)) + ((x >> (nb - 2)) & 3);
+}
+
+static int get_dist_code(const int dist)
+{
+    const int x = dist - 1;
+    if (x < 4) {
+        return x;
+    }
+    const int nb = 31 - __builtin_clz(x);
+    return (2 * nb) + ((x >> (nb - 1)) & 1);
+}
+
+static std::uint32_t load32(const std::uint8_t* p)
+{
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static std::uint64_t load64(const std::uint8_t* p)
+{
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// In-place minimum-redundancy code lengths for weights sorted in
+// increasing order (Moffat and Katajainen). On return a[i] holds the
+// code length of the i-th weight.
+static void calculate_minimum_redundancy(int* a, const int n)
+{
+    a[0] += a[1];
+    int root = 0;
+    int leaf = 2;
+    for (int next = 1; next < n - 1; next++) {
+        if (leaf >= n || a[root] < a[leaf]) {
+            a[next] = a[root];
+            a[root++] = next;
+        } else {
+            a[next] = a[leaf++];
+        }
+        if (leaf >= n || (root < next && a[root] < a[leaf])) {
+            a[next] += a[root];
+            a[root++] = next;
+        } else {
+            a[next] += a[leaf++];
+        }
+    }
+    a[n - 2] = 0;
+    for (int next = n - 3; next >= 0; next--) {
+        a[next] = a[a[next]] + 1;
+    }
+    int available = 1;
+    int used = 0;
+    int depth = 0;
+    int root_index = n - 2;
+    int next = n - 1;
+    while (available > 0) {
+        while (root_index >= 0 && a[root_index] == depth) {
+            used++;
+            root_index--;
+        }
+        while (available > used) {
+            a[next--] = depth;
+            available--;
+        }
+        available = 2 * used;
+        depth++;
+        used = 0;
+    }
+}
+
+// Huffman code lengths of at most max_bits for the symbols with
+// nonzero frequency
+static void build_code_lengths(const std::uint32_t* freq, const int n, const int max_bits, std::uint8_t* lengths)
+{
+    std::fill(lengths, lengths + n, 0);
+    std::array<std::pair<std::uint32_t, int>, NUM_LITLEN_CODES> items;
+    int m = 0;
+    for (int s = 0; s < n; s++) {
+        if (freq[s] != 0) {
+            items[m++] = {freq[s], s};
+        }
+    }
+    if (m <= 1) {
+        // Inflaters reject incomplete codes, so pad to two 1-bit codes
+        const int s = m == 0 ? 0 : items[0].second;
+        lengths[s] = 1;
+        lengths[s == 0 ? 1 : 0] = 1;
+        return;
+    }
+    std::sort(items.begin(), items.begin() + m);
+    std::array<int, NUM_LITLEN_CODES> depths;
+    for (int i = 0; i < m; i++) {
+        depths[i] = static_cast<int>(items[i].first);
+    }
+    calculate_minimum_redundancy(depths.data(), m);
+
+    // Clamp to max_bits, then lengthen the shortest codes that can
+    // take it until the lengths form a complete code again
+    std::array<int, MAX_CODE_BITS + 1> counts = {};
+    for (int i = 0; i < m; i++) {
+        counts[std::min(depths[i], max_bits)]++;
+    }
+    std::uint32_t total = 0;
+    for (int len = 1; len <= max_bits; len++) {
+        total += static_cast<std::uint32_t>(counts[len]) << (max_bits - len);
+    }
+    while (total != (std::uint32_t{1} << max_bits)) {
+        counts[max_bits]--;
+        for (int len = max_bits - 1; len > 0; len--) {
+            if (counts[len] != 0) {
+                counts[len]--;
+                counts[len + 1] += 2;
+                break;
+            }
+        }
+        total--;
+    }
+    // The least frequent symbols get the longest codes
+    int i = 0;
+    for (int len = max_bits; len > 0; len--) {
+        for (int k = 0; k < counts[len]; k++) {
+            lengths[items[i++].second] = static_cast<std::uint8_t>(len);
+        }
+    }
+}
+
+// Canonical codes for the lengths, bit-reversed for LSB-first output
+static void build_codes(const std::uint8_t* lengths, const int n, std::uint16_t* codes)
+{
+    std::array<int, MAX_CODE_BITS + 1> counts = {};
+    for (int s = 0; s < n; s++) {
+        counts[lengths[s]]++;
+    }
+    counts[0] = 0;
+    std::array<int, MAX_CODE_BITS + 1> next_code = {};
+    int code = 0;
+    for (int len = 1; len <= MAX_CODE_BITS; len++) {
+        code = (code + counts[len - 1]) << 1;
+        next_code[len] = code;
+    }
+    for (int s = 0; s < n; s++) {
+        const int len = lengths[s];
+        if (len == 0) {
+            continue;
+        }
+        int c = next_code[len]++;
+        int reversed = 0;
+        for (int b = 0; b < len; b++) {
+            reversed = (reversed << 1) | (c & 1);
+            c >>= 1;
+        }
+        codes[s] = static_cast<std::uint16_t>(reversed);
+    }
+}
+
+static void write_stored_blocks(BitWriter& writer, std::vector<std::uint8_t>& out, const std::uint8_t* data, std::size_t size)
+{
+    do {
+        const std::size_t n = std::min(size, MAX_STORED_SIZE);
+        writer.put(0, 3);
+        writer.align();
+        const std::uint8_t header[4] = {
+            static_cast<std::uint8_t>(n),
+            static_cast<std::uint8_t>(n >> 8),
+            static_cast<std::uint8_t>(~n),
+            static_cast<std::uint8_t>(~n >> 8)
+        };
+        out.insert(out.end(), header, header + 4);
+        out.insert(out.end(), data, data + n);
+        data += n;
+        size -= n;
+    } while (size > 0);
+}
+
+// Writes one non-final block for the symbols, which encode
+// data[0, size), as a dynamic Huffman block or as stored blocks,
+// whichever is smaller
+static void write_block(
+    BitWriter& writer,
+    std::vector<std::uint8_t>& out,
+    const std::vector<LzSymbol>& symbols,
+    const std::uint8_t* data, const std::size_t size)
+{
+    std::array<std::uint32_t, NUM_LITLEN_CODES> litlen_freq = {};
+    std::array<std::uint32_t, NUM_DIST_CODES> dist_freq = {};
+    for (const LzSymbol& sym : symbols) {
+        if (sym.dist == 0) {
+            litlen_freq[sym.litlen]++;
+        } else {
+            litlen_freq[get_length_code(sym.litlen)]++;
+            dist_freq[get_dist_code(sym.dist)]++;
+        }
+    }
+    litlen_freq[END_OF_BLOCK] = 1;
+
+    std::array<std::uint8_t, NUM_LITLEN_CODES + NUM_DIST_CODES> lengths;
+    std::uint8_t* const litlen_lengths = lengths.data();
+    std::uint8_t* const dist_lengths = lengths.data() + NUM_LITLEN_CODES;
+    build_code_lengths(litlen_freq.data(), NUM_LITLEN_CODES, MAX_CODE_BITS, litlen_lengths);
+    build_code_lengths(dist_freq.data(), NUM_DIST_CODES, MAX_CODE_BITS, dist_lengths);
+    int num_litlen = NUM_LITLEN_CODES;
+    while (num_litlen > 257 && litlen_lengths[num_litlen - 1] == 0) {
+        num_litlen--;
+    }
+    int num_dist = NUM_DIST_CODES;
+    while (num_dist > 1 && dist_lengths[num_dist - 1] == 0) {
+        num_dist--;
+    }
+
+    // Run-length code the two length tables as one sequence
+    std::array<std::uint8_t, NUM_LITLEN_CODES + NUM_DIST_CODES> all_lengths;
+    std::copy(litlen_lengths, litlen_lengths + num_litlen, all_lengths.begin());
+    std::copy(dist_lengths, dist_lengths + num_dist, all_lengths.begin() + num_litlen);
+    const int num_lengths = num_litlen + num_dist;
+    std::vector<std::pair<int, int>> rle;
+    std::array<std::uint32_t, NUM_CODE_LENGTH_CODES> cl_freq = {};
+    const auto emit = [&](const int sym, const int extra) {
+        rle.push_back({sym, extra});
+        cl_freq[sym]++;
+    };
+    for (int i = 0; i < num_lengths;) {
+        const int value = all_lengths[i];
+        int run = 1;
+        while (i + run < num_lengths && all_lengths[i + run] == value) {
+            run++;
+        }
+        i += run;
+        if (value == 0) {
+            while (run >= 11) {
+                const int r = std::min(run, 138);
+                emit(18, r - 11);
+                run -= r;
+            }
+            if (run >= 3) {
+                emit(17, run - 3);
+                run = 0;
+            }
+        } else {
+            emit(value, 0);
+            run--;
+            while (run >= 3) {
+                const int r = std::min(run, 6);
+                emit(16, r - 3);
+                run -= r;
+            }
+        }
+        for (; run > 0; run--) {
+            emit(value, 0);
+        }
+    }
+    std::array<std::uint8_t, NUM_CODE_LENGTH_CODES> cl_lengths;
+    build_code_lengths(cl_freq.data(), NUM_CODE_LENGTH_CODES, MAX_CODE_LENGTH_BITS, cl_lengths.data());
+    int num_cl = NUM_CODE_LENGTH_CODES;
+    while (num_cl > 4 && cl_lengths[CODE_LENGTH_ORDER[num_cl - 1]] == 0) {
+        num_cl--;
+    }
+
+    // Compare the sizes of the two block types
+    std::uint64_t dynamic_bits = 3 + 5 + 5 + 4 + (3 * num_cl);
+    for (const auto& [sym, extra] : rle) {
+        dynamic_bits += cl_lengths[sym] + (sym == 16 ? 2 : (sym == 17 ? 3 : (sym == 18 ? 7 : 0)));
+    }
+    for (int s = 0; s < NUM_LITLEN_CODES; s++) {
+        dynamic_bits += static_cast<std::uint64_t>(litlen_freq[s]) * (litlen_lengths[s] + (s > 256 ? LENGTH_EXTRA[s - 257] : 0));
+    }
+    for (int s = 0; s < NUM_DIST_CODES; s++) {
+        dynamic_bits += static_cast<std::uint64_t>(dist_freq[s]) * (dist_lengths[s] + DIST_EXTRA[s]);
+    }
+    const std::uint64_t stored_bits = (size + (5 * ((size / MAX_STORED_SIZE) + 1))) * 8;
+    if (stored_bits < dynamic_bits) {
+        write_stored_blocks(writer, out, data, size);
+        return;
+    }
+
+    std::array<std::uint16_t, NUM_LITLEN_CODES> litlen_codes;
+    std::array<std::uint16_t, NUM_DIST_CODES> dist_codes;
+    std::array<std::uint16_t, NUM_CODE_LENGTH_CODES> cl_codes;
+    build_codes(litlen_lengths, NUM_LITLEN_CODES, litlen_codes.data());
+    build_codes(dist_lengths, NUM_DIST_CODES, dist_codes.data());
+    build_codes(cl_lengths.data(), NUM_CODE_LENGTH_CODES, cl_codes.data());
+
+    writer.put(0, 1);
+    writer.put(2, 2);
+    writer.put(num_litlen - 257, 5);
+    writer.put(num_dist - 1, 5);
+    writer.put(num_cl - 4, 4);
+    for (int i = 0; i < num_cl; i++) {
+        writer.put(cl_lengths[CODE_LENGTH_ORDER[i]], 3);
+    }
+    for (const auto& [sym, extra] : rle) {
+        writer.put(cl_codes[sym], cl_lengths[sym]);
+        if (sym >= 16) {
+            writer.put(extra, sym == 16 ? 2 : (sym == 17 ? 3 : 7));
+        }
+    }
+    for (const LzSymbol& sym : symbols) {
+        if (sym.dist == 0) {
+            writer.put(litlen_codes[sym.litlen], litlen_lengths[sym.litlen]);
+            continue;
+        }
+        const int lc = get_length_code(sym.litlen);
+        writer.put(litlen_codes[lc], litlen_lengths[lc]);
+        writer.put(sym.litlen - LENGTH_BASE[lc - 257], LENGTH_EXTRA[lc - 257]);
+        const int dc = get_dist_code(sym.dist);
+        writer.put(dist_codes[dc], dist_lengths[dc]);
+        writer.put(sym.dist - DIST_BASE[dc], DIST_EXTRA[dc]);
+    }
+    writer.put(litlen_codes[END_OF_BLOCK], litlen_lengths[END_OF_BLOCK]);
+}
+
+void deflate_append(std::vector<std::uint8_t>& out, const std::uint8_t* data, const std::size_t size)
+{
+    BitWriter writer(out);
+    // Most recent position of each hashed 4-byte sequence
+    std::vector<std::int32_t> head(std::size_t{1} << HASH_BITS, -WINDOW_SIZE - 1);
+    std::vector<LzSymbol> symbols;
+    symbols.reserve(BLOCK_SYMBOLS);
+    std::size_t block_start = 0;
+    std::size_t i = 0;
+    while (i < size) {
+        std::size_t length = 1;
+        if (i + MIN_MATCH <= size) {
+            const std::uint32_t word = load32(data + i);
+            const std::uint32_t h = (word * 2654435761u) >> (32 - HASH_BITS);
+            const std::int32_t candidate = head[h];
+            head[h] = static_cast<std::int32_t>(i);
+            const long dist = static_cast<long>(i) - candidate;
+            if (dist <= WINDOW_SIZE && load32(data + candidate) == word) {
+                const std::size_t max_length = std::min<std::size_t>(MAX_MATCH, size - i);
+                const std::uint8_t* a = data + i;
+                const std::uint8_t* b = data + candidate;
+                length = MIN_MATCH;
+                while (length + 8 <= max_length) {
+                    const std::uint64_t diff = load64(a + length) ^ load64(b + length);
+                    if (diff != 0) {
+                        length += __builtin_ctzll(diff) >> 3;
+                        break;
+                    }
+                    length += 8;
+                }
+                if (length + 8 > max_length) {
+                    while (length < max_length && a[length] == b[length]) {
+                        length++;
+                    }
+                }
+                symbols.push_back({static_cast<std::uint16_t>(length), static_cast<std::uint16_t>(dist)});
+            }
+        }
+        if (length == 1) {
+            symbols.push_back({data[i], 0});
+        }
+        i += length;
+        if (symbols.size() == BLOCK_SYMBOLS) {
+            write_block(writer, out, symbols, data + block_start, i - block_start);
+            symbols.clear();
+            block_start = i;
+        }
+    }
+    if (!symbols.empty()) {
+        write_block(writer, out, symbols, data + block_start, i - block_start);
+    }
+    // Empty stored block to end on a byte boundary
+    writer.put(0, 3);
+    writer.align();
+    const std::uint8_t sync[4] = {0x00, 0x00, 0xFF, 0xFF};
+    out.insert(out.end(), sync, sync + 4);
+}
+
+constexpr std::uint32_t ADLER_BASE = 65521;
+// Most bytes that can be summed before s2 could overflow
+constexpr std::size_t ADLER_NMAX = 5552;
+
+std::uint32_t adler32(const std::uint8_t* data, std::size_t size, const std::uint32_t adler)
+{
+    std::uint32_t s1 = adler & 0xFFFF;
+    std::uint32_t s2 = adler >> 16;
+    while (size > 0) {
+        const std::size_t n = std::min(size, ADLER_NMAX);
+        for (std::size_t i = 0; i < n; i++) {
+            s1 += data[i];
+            s2 += s1;
+        }
+        s1 %= ADLER_BASE;
+        s2 %= ADLER_BASE;
+        data += n;
+        size -= n;
+    }
+    return (s2 << 16) | s1;
+}
+
+std::uint32_t adler32_combine(const std::uint32_t adler1, const std::uint32_t adler2, const std::size_t size2)
+{
+    const std::uint32_t rem = static_cast<std::uint32_t>(size2 % ADLER_BASE);
+    std::uint32_t s1 = adler1 & 0xFFFF;
+    std::uint32_t s2 = static_cast<std::uint32_t>((static_cast<std::uint64_t>(rem) * s1) % ADLER_BASE);
+    s1 += (adler2 & 0xFFFF) + ADLER_BASE - 1;
+    s2 += (adler1 >> 16) + (adler2 >> 16) + ADLER_BASE - rem;
+    if (s1 >= ADLER_BASE) {
+        s1 -= ADLER_BASE;
+    }
+    if (s1 >= ADLER_BASE) {
+        s1 -= ADLER_BASE;
+    }
+    if (s2 >= 2 * ADLER_BASE) {
+        s2 -= 2 * ADLER_BASE;
+    }
+    if (s2 >= ADLER_BASE) {
+        s2 -= ADLER_BASE;
+    }
+    return (s2 << 16) | s1;
+}
+
+static const std::array<std::uint32_t, 256>& get_crc_table()
+{
+    static const std::array<std::uint32_t, 256> table = []() {
+        std::array<std::uint32_t, 256> t;
+        for (std::uint32_t n = 0; n < 256; n++) {
+            std::uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+    return table;
+}
+
+std::uint32_t crc32(const std::uint8_t* data, const std::size_t size, const std::uint32_t crc)
+{
+    const std::array<std::uint32_t, 256>& table = get_crc_table();
+    std::uint32_t c = ~crc;
+    for (std::size_t i = 0; i < size; i++) {
+        c = table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    }
+    return ~c;
+}
@@ -0,0 +1,30 @@
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Raw deflate (RFC 1951) compressor: greedy LZ77 over a 32 KB window,
+// with a dynamic Huffman or stored block per 32K symbols.
+//
+// deflate_append() compresses data into non-final blocks and ends with
+// an empty stored block, like zlib's Z_SYNC_FLUSH. The output is byte
+// aligned and needs no earlier data, so pieces compressed separately
+// (e.g. on different threads) can be concatenated into one stream.
+// A stream is ended with DEFLATE_FINAL_BLOCK.
+void deflate_append(std::vector<std::uint8_t>& out, const std::uint8_t* data, const std::size_t size);
+
+// Empty final block with fixed codes
+constexpr std::array<std::uint8_t, 2> DEFLATE_FINAL_BLOCK = {0x03, 0x00};
+
+std::uint32_t adler32(const std::uint8_t* data, const std::size_t size, const std::uint32_t adler = 1);
+// Adler-32 of two pieces joined, from the checksums of each piece and
+// the length of the second
+std::uint32_t adler32_combine(const std::uint32_t adler1, const std::uint32_t adler2, const std::size_t size2);
+
+// CRC-32 as used by PNG and zlib's crc32()
+std::uint32_t crc32(const std::uint8_t* data, const std::size_t size, const std::uint32_t crc = 0);
+
+#endif
@@ -0,0 +1,272 @@
+#include "display_list.h"
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <stdexcept>
+#include "bezier.h"
+#include "circle.h"
+#include "fill.h"
+#include "constants.h"
+
+constexpr int TILE_SHIFT = 6;
+
+static_assert(sizeof(DrawCommand) == 64, "DrawCommand should fit in one cache line");
+
+static DrawBounds get_points_bounds(std::initializer_list<float> xs, std::initializer_list<float> ys)
+{
+    const auto [x_min, x_max] = std::minmax(xs);
+    const auto [y_min, y_max] = std::minmax(ys);
+    return {
+        static_cast<int>(std::floor(x_min)),
+        static_cast<int>(std::floor(y_min)),
+        static_cast<int>(std::ceil(x_max)),
+        static_cast<int>(std::ceil(y_max))
+    };
+}
+
+// Interleaves the bits of the tile coordinates
+static std::uint32_t get_morton_code(const DrawBounds& bounds)
+{
+    const std::uint32_t tx = std::clamp(bounds.x_min, 0, SCREEN_WIDTH - 1) >> TILE_SHIFT;
+    const std::uint32_t ty = std::clamp(bounds.y_min, 0, SCREEN_HEIGHT - 1) >> TILE_SHIFT;
+    std::uint32_t code = 0;
+    for (unsigned int bit = 0; bit < 16; bit++) {
+        code |= ((tx >> bit) & 1) << (2 * bit);
+        code |= ((ty >> bit) & 1) << ((2 * bit) + 1);
+    }
+    return code;
+}
+
+static bool is_barrier(const DrawCommand& cmd)
+{
+    return cmd.type == DrawCommandType::scanline_fill || cmd.type == DrawCommandType::flood_fill;
+}
+
+void DisplayList::clear()
+{
+    commands.clear();
+    paths.clear();
+}
+
+std::size_t DisplayList::size() const
+{
+    return commands.size();
+}
+
+DrawCommand make_line_command(
+    const LineAlgorithm algorithm,
+    const std::uint32_t color,
+    const int ax, const int ay,
+    const int bx, const int by)
+{
+    DrawCommand cmd{};
+    cmd.type = DrawCommandType::line;
+    cmd.algorithm = algorithm;
+    cmd.color = color;
+    cmd.bounds = {std::min(ax, bx), std::min(ay, by), std::max(ax, bx), std::max(ay, by)};
+    cmd.i = {ax, ay, bx, by};
+    return cmd;
+}
+
+DrawCommand make_circle_command(const std::uint32_t color, const int cx, const int cy, const int radius)
+{
+    DrawCommand cmd{};
+    cmd.type = DrawCommandType::circle;
+    cmd.color = color;
+    cmd.bounds = {cx - radius, cy - radius, cx + radius, cy + radius};
+    cmd.i = {cx, cy, radius};
+    return cmd;
+}
+
+DrawCommand make_bezier_quad_command(
+    const std::uint32_t color,
+    const int x0, const int y0,
+    const int x1, const int y1,
+    const int x2, const int y2)
+{
+    DrawCommand cmd{};
+    cmd.type = DrawCommandType::bezier_quad;
+    cmd.color = color;
+    // The curve lies within the hull of its control points
+    cmd.bounds = {std::min({x0, x1, x2}), std::min({y0, y1, y2}), std::max({x0, x1, x2}), std::max({y0, y1, y2})};
+    cmd.i = {x0, y0, x1, y1, x2, y2};
+    return cmd;
+}
+
+DrawCommand make_bezier_cubic_command(
+    const std::uint32_t color,
+    const int x0, const int y0,
+    const float x1, const float y1,
+    const float x2, const float y2,
+    const int x3, const int y3)
+{
+    DrawCommand cmd{};
+    cmd.type = DrawCommandType::bezier_cubic;
+    cmd.color = color;
+    cmd.bounds = get_points_bounds(
+        {static_cast<float>(x0), x1, x2, static_cast<float>(x3)},
+        {static_cast<float>(y0), y1, y2, static_cast<float>(y3)}
+    );
+    cmd.i = {x0, y0, x3, y3};
+    cmd.f = {x1, y1, x2, y2};
+    return cmd;
+}
+
+DrawBounds get_path_bounds(const std::vector<PathSegment>& segments)
+{
+    DrawBounds bounds = {segments.front().c[0], segments.front().c[1], segments.front().c[0], segments.front().c[1]};
+    for (const PathSegment& seg : segments) {
+        const int num_points = seg.type == PathSegmentType::line ? 2 : (seg.type == PathSegmentType::quad ? 3 : 4);
+        for (int p = 0; p < num_points; p++) {
+            bounds.x_min = std::min(bounds.x_min, seg.c[2 * p]);
+            bounds.y_min = std::min(bounds.y_min, seg.c[(2 * p) + 1]);
+            bounds.x_max = std::max(bounds.x_max, seg.c[2 * p]);
+            bounds.y_max = std::max(bounds.y_max, seg.c[(2 * p) + 1]);
+        }
+    }
+    return bounds;
+}
+
+void DisplayList::record_line(
+    const LineAlgorithm algorithm,
+    const std::uint32_t color,
+    const int ax, const int ay,
+    const int bx, const int by)
+{
+    commands.push_back(make_line_command(algorithm, color, ax, ay, bx, by));
+}
+
+void DisplayList::record_circle(const std::uint32_t color, const int cx, const int cy, const int radius)
+{
+    commands.push_back(make_circle_command(color, cx, cy, radius));
+}
+
+void DisplayList::record_bezier_quad(
+    const std::uint32_t color,
+    const int x0, const int y0,
+    const int x1, const int y1,
+    const int x2, const int y2)
+{
+    commands.push_back(make_bezier_quad_command(color, x0, y0, x1, y1, x2, y2));
+}
+
+void DisplayList::record_bezier_cubic(
+    const std::uint32_t color,
+    const int x0, const int y0,
+    const float x1, const float y1,
+    const float x2, const float y2,
+    const int x3, const int y3)
+{
+    commands.push_back(make_bezier_cubic_command(color, x0, y0, x1, y1, x2, y2, x3, y3));
+}
+
+void DisplayList::record_path(const std::uint32_t color, const std::string& path)
+{
+    std::vector<PathSegment> segments = parse_path(path);
+    if (segments.empty()) {
+        return;
+    }
+
+    DrawCommand cmd{};
+    cmd.type = DrawCommandType::path;
+    cmd.color = color;
+    cmd.bounds = get_path_bounds(segments);
+    cmd.i = {static_cast<int>(paths.size())};
+    paths.push_back(std::move(segments));
+    commands.push_back(cmd);
+}
+
+void DisplayList::record_svg(const std::uint32_t color, const std::string& file_path)
+{
+    for (const std::string& path : get_paths_from_svg(file_path)) {
+        record_path(color, path);
+    }
+}
+
+void DisplayList::record_scanline_fill(const std::uint32_t color)
+{
+    DrawCommand cmd{};
+    cmd.type = DrawCommandType::scanline_fill;
+    cmd.color = color;
+    cmd.bounds = {0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1};
+    commands.push_back(cmd);
+}
+
+void DisplayList::record_flood_fill(const std::uint32_t color, const int x, const int y)
+{
+    DrawCommand cmd{};
+    cmd.type = DrawCommandType::flood_fill;
+    cmd.color = color;
+    cmd.bounds = {0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1};
+    cmd.i = {x, y};
+    commands.push_back(cmd);
+}
+
+void DisplayList::sort(const DisplayListOrder order)
+{
+    auto run_begin = commands.begin();
+    while (run_begin != commands.end()) {
+        const auto run_end = std::find_if(run_begin, commands.end(), is_barrier);
+        if (order == DisplayListOrder::by_tile) {
+            std::stable_sort(run_begin, run_end, [](const DrawCommand& a, const DrawCommand& b) {
+                return get_morton_code(a.bounds) < get_morton_code(b.bounds);
+            });
+        } else {
+            std::stable_sort(run_begin, run_end, [](const DrawCommand& a, const DrawCommand& b) {
+                return a.type < b.type;
+            });
+        }
+        run_begin = run_end == commands.end() ? run_end : run_end + 1;
+    }
+}
+
+const DrawCommand& DisplayList::get_command(const std::size_t index) const
+{
+    if (index >= commands.size()) {
+        throw std::out_of_range("DisplayList::get_command: index out of range");
+    }
+    return commands[index];
+}
+
+const std::vector<PathSegment>& DisplayList::get_path(const DrawCommand& cmd) const
+{
+    if (cmd.type != DrawCommandType::path || cmd.i[0] < 0 || static_cast<std::size_t>(cmd.i[0]) >= paths.size()) {
+        throw std::out_of_range("DisplayList::get_path: not a path of this list");
+    }
+    return paths[cmd.i[0]];
+}
+
+void DisplayList::replay(std::vector<std::uint32_t>& pixels) const
+{
+    for (const DrawCommand& cmd : commands) {
+        replay_command(pixels, cmd);
+    }
+}
+
+void DisplayList::replay_command(std::vector<std::uint32_t>& pixels, const DrawCommand& cmd) const
+{
+    const std::array<int, 6>& i = cmd.i;
+    switch (cmd.type) {
+        case DrawCommandType::line:
+            draw_line(pixels, cmd.color, cmd.algorithm, i[0], i[1], i[2], i[3]);
+            break;
+        case DrawCommandType::circle:
+            draw_circle_midpoint(pixels, cmd.color, i[0], i[1], i[2]);
+            break;
+        case DrawCommandType::bezier_quad:
+            draw_bezier_quad(pixels, cmd.color, i[0], i[1], i[2], i[3], i[4], i[5]);
+            break;
+        case DrawCommandType::bezier_cubic:
+            draw_bezier_cubic(pixels, cmd.color, i[0], i[1], cmd.f[0], cmd.f[1], cmd.f[2], cmd.f[3], i[2], i[3]);
+            break;
+        case DrawCommandType::path:
+            fill_path_segments_clipped(pixels, cmd.color, paths[i[0]]);
+            break;
+        case DrawCommandType::scanline_fill:
+            scanline_fill(pixels, cmd.color);
+            break;
+        case DrawCommandType::flood_fill:
+            flood_fill_stack(pixels, cmd.color, i[0], i[1]);
+            break;
+    }
+}
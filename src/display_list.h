@@ -0,0 +1,130 @@
+#ifndef DISPLAY_LIST_H
+#define DISPLAY_LIST_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "line.h"
+#include "svg.h"
+
+enum class DrawCommandType : std::uint8_t {
+    line,
+    circle,
+    bezier_quad,
+    bezier_cubic,
+    path,
+    scanline_fill,
+    flood_fill
+};
+
+enum class DisplayListOrder {
+    // Group commands by the 64x64 tile containing their bounds' origin,
+    // walking tiles in Morton order
+    by_tile,
+    // Group commands of the same primitive type together
+    by_type
+};
+
+struct DrawBounds {
+    int x_min;
+    int y_min;
+    int x_max;
+    int y_max;
+};
+
+// One recorded command; 64 bytes, so one command per cache line.
+// Integer parameters go in i, the floating point control points
+// of cubic Beziers in f. Paths store their index in i[0].
+struct DrawCommand {
+    DrawCommandType type;
+    LineAlgorithm algorithm;
+    std::uint32_t color;
+    DrawBounds bounds;
+    std::array<int, 6> i;
+    std::array<float, 4> f;
+};
+
+// Commands with their bounds filled in. The bounds of a curve are the
+// hull of its control points.
+DrawCommand make_line_command(
+    const LineAlgorithm algorithm,
+    const std::uint32_t color,
+    const int ax, const int ay,
+    const int bx, const int by
+);
+DrawCommand make_circle_command(const std::uint32_t color, const int cx, const int cy, const int radius);
+DrawCommand make_bezier_quad_command(
+    const std::uint32_t color,
+    const int x0, const int y0,
+    const int x1, const int y1,
+    const int x2, const int y2
+);
+DrawCommand make_bezier_cubic_command(
+    const std::uint32_t color,
+    const int x0, const int y0,
+    const float x1, const float y1,
+    const float x2, const float y2,
+    const int x3, const int y3
+);
+
+// Bounds of the points of a non-empty path
+DrawBounds get_path_bounds(const std::vector<PathSegment>& segments);
+
+// Records draw calls so they can be replayed, repeatedly, into any
+// pixel buffer. SVG files and path strings are parsed when recorded,
+// so replaying only costs the rasterization.
+class DisplayList {
+public:
+    void clear();
+    std::size_t size() const;
+
+    void record_line(
+        const LineAlgorithm algorithm,
+        const std::uint32_t color,
+        const int ax, const int ay,
+        const int bx, const int by
+    );
+    void record_circle(const std::uint32_t color, const int cx, const int cy, const int radius);
+    void record_bezier_quad(
+        const std::uint32_t color,
+        const int x0, const int y0,
+        const int x1, const int y1,
+        const int x2, const int y2
+    );
+    void record_bezier_cubic(
+        const std::uint32_t color,
+        const int x0, const int y0,
+        const float x1, const float y1,
+        const float x2, const float y2,
+        const int x3, const int y3
+    );
+    // Filled path, as drawn by draw_svg
+    void record_path(const std::uint32_t color, const std::string& path);
+    void record_svg(const std::uint32_t color, const std::string& file_path);
+    void record_scanline_fill(const std::uint32_t color);
+    void record_flood_fill(const std::uint32_t color, const int x, const int y);
+
+    // Reorders commands for memory locality. Fills read back the frame,
+    // so they act as barriers: only commands between two fills are
+    // reordered, and the sort is stable. Where primitives of different
+    // colors overlap, the topmost one may change.
+    void sort(const DisplayListOrder order);
+
+    void replay(std::vector<std::uint32_t>& pixels) const;
+    // Draws one command of the list, for callers that replay it piecewise
+    void replay_command(std::vector<std::uint32_t>& pixels, const DrawCommand& cmd) const;
+
+    // Throws std::out_of_range for an index past the end
+    const DrawCommand& get_command(const std::size_t index) const;
+    // Segments of a path command of this list; throws std::out_of_range
+    // for any other command
+    const std::vector<PathSegment>& get_path(const DrawCommand& cmd) const;
+
+private:
+    std::vector<DrawCommand> commands;
+    std::vector<std::vector<PathSegment>> paths;
+};
+
+#endif
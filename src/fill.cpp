@@ -1,32 +1,50 @@
 #include "fill.h"
 #include "constants.h"
+#include "instrument.h"
+#include "kernels.h"
+#include "pixel_sink.h"
+#include "row_executor.h"
+#include "tiled_canvas.h"
+#include <algorithm>
 #include <stack>
+#include <stdexcept>
 
-BoundingRect get_bounding_rect(const std::vector<std::uint32_t> pixels, const std::uint32_t border_color)
+BoundingRect get_bounding_rect(const std::vector<std::uint32_t>& pixels, const std::uint32_t border_color)
 {
-    unsigned int x_min = SCREEN_WIDTH;
-    unsigned int y_min = SCREEN_HEIGHT;
-    unsigned int x_max = 0;
-    unsigned int y_max = 0;
-    for (unsigned int y = 0; y < SCREEN_HEIGHT; y++) {
-        const unsigned int row = y * SCREEN_WIDTH;
-        for (unsigned int x = 0; x < SCREEN_WIDTH; x++) {
-            if (pixels.at(row + x) == border_color) {
-                if (x < x_min) {
-                    x_min = x;
-                }
-                if (y < y_min) {
-                    y_min = y;
-                }
-                if (x > x_max) {
-                    x_max = x;
-                }
-                y_max = y;
-                x = x_max;
+    INSTRUMENT_SCOPE(bounding_rect);
+    if (pixels.size() < static_cast<std::size_t>(NUM_PIXELS)) {
+        throw std::out_of_range("get_bounding_rect: buffer smaller than the screen");
+    }
+    const Kernels& kernels = get_kernels();
+    // Each band of rows finds its own rect, and the rects are merged
+    const BoundingRect empty = {SCREEN_WIDTH, SCREEN_HEIGHT, 0, 0};
+    const auto scan_rows = [&](const int y0, const int y1) {
+        BoundingRect br = empty;
+        for (unsigned int y = y0; y < static_cast<unsigned int>(y1); y++) {
+            const std::uint32_t* row = pixels.data() + (y * SCREEN_WIDTH);
+            const unsigned int first = kernels.find_u32(row, SCREEN_WIDTH, border_color);
+            if (first == SCREEN_WIDTH) {
+                INSTRUMENT_ADD(bounding_rect, bytes_scanned, sizeof(std::uint32_t) * SCREEN_WIDTH);
+                continue;
             }
+            const unsigned int last = kernels.find_last_u32(row, SCREEN_WIDTH, border_color);
+            INSTRUMENT_ADD(bounding_rect, bytes_scanned, sizeof(std::uint32_t) * (first + SCREEN_WIDTH - last));
+            br.x_min = std::min(br.x_min, first);
+            br.x_max = std::max(br.x_max, last);
+            br.y_min = std::min(br.y_min, y);
+            br.y_max = y;
         }
-    }
-    return {x_min, y_min, x_max, y_max};
+        return br;
+    };
+    const auto merge = [](const BoundingRect& a, const BoundingRect& b) {
+        return BoundingRect{
+            std::min(a.x_min, b.x_min),
+            std::min(a.y_min, b.y_min),
+            std::max(a.x_max, b.x_max),
+            std::max(a.y_max, b.y_max)
+        };
+    };
+    return get_row_executor().reduce_bands(0, SCREEN_HEIGHT, sizeof(std::uint32_t) * SCREEN_WIDTH, empty, scan_rows, merge);
 }
 
 void scanline_fill_area(
@@ -35,24 +53,106 @@ void scanline_fill_area(
     const unsigned int x_max, const unsigned int y_max,
     const std::uint32_t color)
 {
-    for (unsigned int y = y_min; y < y_max; y++) {
-        const unsigned int row = y * SCREEN_WIDTH;
-        const unsigned int row_start = row + x_min;
-        const unsigned int row_end = row + x_max;
-        unsigned int line_start = row_start;
-        while (pixels.at(line_start) != color && line_start < row_end) {
-            line_start++;
+    INSTRUMENT_SCOPE(scanline_fill);
+    if (x_min > x_max || y_min >= y_max) {
+        return;
+    }
+    if (x_max >= SCREEN_WIDTH || y_max > SCREEN_HEIGHT || pixels.size() < static_cast<std::size_t>(NUM_PIXELS)) {
+        throw std::out_of_range("scanline_fill_area: area outside of the buffer");
+    }
+    const Kernels& kernels = get_kernels();
+    const unsigned int width = x_max - x_min;
+    // Rows are filled independently, so bands of them run in parallel
+    get_row_executor().for_each_band(y_min, y_max, sizeof(std::uint32_t) * (width + 1), [&](const int y0, const int y1) {
+        for (unsigned int y = y0; y < static_cast<unsigned int>(y1); y++) {
+            std::uint32_t* row_start = pixels.data() + (y * SCREEN_WIDTH) + x_min;
+            // First border pixel in [x_min, x_max), last in (x_min, x_max]
+            const unsigned int line_start = kernels.find_u32(row_start, width, color);
+            const unsigned int found_end = kernels.find_last_u32(row_start + 1, width, color);
+            const unsigned int line_end = found_end == width ? 0 : found_end + 1;
+            INSTRUMENT_ADD(scanline_fill, bytes_scanned, sizeof(std::uint32_t) * (line_start + (width - line_end) + 2));
+            if (line_start >= line_end) {
+                continue;
+            }
+            INSTRUMENT_ADD(scanline_fill, pixels, line_end - line_start - 1);
+            kernels.fill_u32(row_start + line_start + 1, line_end - line_start - 1, color);
         }
-        unsigned int line_end = row_end;
-        while (pixels.at(line_end) != color && line_end > row_start) {
-            line_end--;
+    });
+}
+
+BoundingRect get_bounding_rect(const BitMask& mask)
+{
+    INSTRUMENT_SCOPE(bounding_rect);
+    unsigned int x_min = mask.get_width();
+    unsigned int y_min = mask.get_height();
+    unsigned int x_max = 0;
+    unsigned int y_max = 0;
+    const int num_words = mask.get_words_per_row();
+    for (int y = 0; y < mask.get_height(); y++) {
+        const std::uint64_t* row = mask.row(y);
+        int first = 0;
+        while (first < num_words && row[first] == 0) {
+            first++;
         }
-        if (line_start >= line_end) {
+        INSTRUMENT_ADD(bounding_rect, bytes_scanned, sizeof(std::uint64_t) * first);
+        if (first == num_words) {
             continue;
         }
-        for (unsigned int i = line_start + 1; i < line_end; i++) {
-            pixels.at(i) = color;
+        int last = num_words - 1;
+        while (row[last] == 0) {
+            last--;
         }
+        INSTRUMENT_ADD(bounding_rect, bytes_scanned, sizeof(std::uint64_t) * (num_words - last));
+        const unsigned int x_first = (first * 64) + __builtin_ctzll(row[first]);
+        const unsigned int x_last = (last * 64) + 63 - __builtin_clzll(row[last]);
+        x_min = std::min(x_min, x_first);
+        x_max = std::max(x_max, x_last);
+        y_min = std::min(y_min, static_cast<unsigned int>(y));
+        y_max = y;
+    }
+    return {x_min, y_min, x_max, y_max};
+}
+
+void scanline_fill_area(
+    BitMask& mask,
+    const unsigned int x_min, const unsigned int y_min,
+    const unsigned int x_max, const unsigned int y_max)
+{
+    INSTRUMENT_SCOPE(scanline_fill);
+    if (x_min > x_max) {
+        return;
+    }
+    const int w0 = x_min >> 6;
+    const int w1 = x_max >> 6;
+    const std::uint64_t head = ~std::uint64_t{0} << (x_min & 63);
+    const std::uint64_t tail = ~std::uint64_t{0} >> (63 - (x_max & 63));
+    for (unsigned int y = y_min; y < y_max; y++) {
+        std::uint64_t* row = mask.row(y);
+        // First and last border pixels within [x_min, x_max]
+        int first = w0;
+        std::uint64_t bits = row[first] & head & (first == w1 ? tail : ~std::uint64_t{0});
+        while (bits == 0 && first < w1) {
+            first++;
+            bits = row[first] & (first == w1 ? tail : ~std::uint64_t{0});
+        }
+        if (bits == 0) {
+            INSTRUMENT_ADD(scanline_fill, bytes_scanned, sizeof(std::uint64_t) * (w1 - w0 + 1));
+            continue;
+        }
+        const int line_start = (first * 64) + __builtin_ctzll(bits);
+        int last = w1;
+        bits = row[last] & tail & (last == w0 ? head : ~std::uint64_t{0});
+        while (bits == 0) {
+            last--;
+            bits = row[last] & (last == w0 ? head : ~std::uint64_t{0});
+        }
+        const int line_end = (last * 64) + 63 - __builtin_clzll(bits);
+        INSTRUMENT_ADD(scanline_fill, bytes_scanned, sizeof(std::uint64_t) * ((first - w0) + (w1 - last) + 2));
+        if (line_end - line_start < 2) {
+            continue;
+        }
+        INSTRUMENT_ADD(scanline_fill, pixels, line_end - line_start - 1);
+        mask.set_span(line_start + 1, line_end - 1, y);
     }
 }
 
@@ -67,7 +167,9 @@ void flood_fill_stack(
     const std::uint32_t color,
     const int x, const int y)
 {
+    INSTRUMENT_SCOPE(flood_fill);
     if ((x < 0) || (x >= SCREEN_WIDTH) || (y < 0) || (y >= SCREEN_HEIGHT)) {
+        INSTRUMENT_ADD(flood_fill, clipped, 1);
         return;
     }
 
@@ -78,6 +180,8 @@ void flood_fill_stack(
         pointStack.pop();
         if ((p >= 0) && (p < NUM_PIXELS) && (pixels.at(p) != color)) {
             pixels.at(p) = color;
+            INSTRUMENT_ADD(flood_fill, pixels, 1);
+            INSTRUMENT_ADD(flood_fill, stack_pushes, 4);
             pointStack.push(p - 1);
             pointStack.push(p + 1);
             pointStack.push(p - SCREEN_WIDTH);
@@ -86,7 +190,56 @@ void flood_fill_stack(
     }
 }
 
-void flood_fill_recursive(
+void flood_fill_stack(
+    TiledCanvas& canvas,
+    const std::uint32_t color,
+    const int x, const int y)
+{
+    INSTRUMENT_SCOPE(flood_fill);
+    if ((x < 0) || (x >= canvas.get_width()) || (y < 0) || (y >= canvas.get_height())) {
+        INSTRUMENT_ADD(flood_fill, clipped, 1);
+        return;
+    }
+
+    TiledCanvasSink sink(canvas, color);
+    std::stack<std::pair<int, int>> seeds;
+    seeds.push({x, y});
+    while (!seeds.empty()) {
+        const auto [sx, sy] = seeds.top();
+        seeds.pop();
+        if (canvas.get_pixel(sx, sy) == color) {
+            continue;
+        }
+        int x0 = sx;
+        while (x0 > 0 && canvas.get_pixel(x0 - 1, sy) != color) {
+            x0--;
+        }
+        int x1 = sx;
+        while (x1 < canvas.get_width() - 1 && canvas.get_pixel(x1 + 1, sy) != color) {
+            x1++;
+        }
+        sink.span(x0, x1, sy);
+        INSTRUMENT_ADD(flood_fill, pixels, x1 - x0 + 1);
+
+        // One seed for each run of unfilled pixels above and below
+        for (const int ny : {sy - 1, sy + 1}) {
+            if (ny < 0 || ny >= canvas.get_height()) {
+                continue;
+            }
+            bool in_run = false;
+            for (int nx = x0; nx <= x1; nx++) {
+                const bool unfilled = canvas.get_pixel(nx, ny) != color;
+                if (unfilled && !in_run) {
+                    seeds.push({nx, ny});
+                    INSTRUMENT_ADD(flood_fill, stack_pushes, 1);
+                }
+                in_run = unfilled;
+            }
+        }
+    }
+}
+
+static void flood_fill_recursive_from(
     std::vector<std::uint32_t>& pixels,
     const std::uint32_t color,
     const int x, const int y)
@@ -98,9 +251,21 @@ void flood_fill_recursive(
     const int row = y * SCREEN_WIDTH;
     if (pixels.at(row + x) != color) {
         pixels.at(row + x) = color;
-        flood_fill_recursive(pixels, color, x + 1, y);
-        flood_fill_recursive(pixels, color, x - 1, y);
-        flood_fill_recursive(pixels, color, x, y + 1);
-        flood_fill_recursive(pixels, color, x, y - 1);
+        INSTRUMENT_ADD(flood_fill, pixels, 1);
+        // Each recursive call is a push onto the call stack
+        INSTRUMENT_ADD(flood_fill, stack_pushes, 4);
+        flood_fill_recursive_from(pixels, color, x + 1, y);
+        flood_fill_recursive_from(pixels, color, x - 1, y);
+        flood_fill_recursive_from(pixels, color, x, y + 1);
+        flood_fill_recursive_from(pixels, color, x, y - 1);
     }
 }
+
+void flood_fill_recursive(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const int x, const int y)
+{
+    INSTRUMENT_SCOPE(flood_fill);
+    flood_fill_recursive_from(pixels, color, x, y);
+}
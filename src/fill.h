@@ -3,6 +3,9 @@
 
 #include <cstdint>
 #include <vector>
+#include "bitmask.h"
+
+class TiledCanvas;
 
 struct BoundingRect {
     unsigned int x_min;
@@ -11,7 +14,7 @@ struct BoundingRect {
     unsigned int y_max;
 };
 
-BoundingRect get_bounding_rect(const std::vector<std::uint32_t> pixels, const std::uint32_t border_color);
+BoundingRect get_bounding_rect(const std::vector<std::uint32_t>& pixels, const std::uint32_t border_color);
 
 void scanline_fill_area(
     std::vector<std::uint32_t>& pixels,
@@ -20,6 +23,15 @@ void scanline_fill_area(
     const std::uint32_t color
 );
 
+// Bit mask variants of the above: rows are scanned a 64-bit word at a time
+BoundingRect get_bounding_rect(const BitMask& mask);
+
+void scanline_fill_area(
+    BitMask& mask,
+    const unsigned int x_min, const unsigned int y_min,
+    const unsigned int x_max, const unsigned int y_max
+);
+
 void scanline_fill(std::vector<std::uint32_t>& pixels, const std::uint32_t color);
 
 void flood_fill_stack(
@@ -28,6 +40,14 @@ void flood_fill_stack(
     const int x, const int y
 );
 
+// Flood fill of a TiledCanvas. Works a row span at a time, so the stack
+// holds one seed per span rather than four pushes per pixel.
+void flood_fill_stack(
+    TiledCanvas& canvas,
+    const std::uint32_t color,
+    const int x, const int y
+);
+
 void flood_fill_recursive(
     std::vector<std::uint32_t>& pixels,
     const std::uint32_t color,
@@ -0,0 +1,307 @@
+#include "frame_stream.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "kernels.h"
+
+constexpr int MAX_RUN = 128;
+
+// Run-length code of n pixels, appended to out
+static void encode_pixels(const std::uint32_t* px, const std::size_t n, std::vector<std::uint8_t>& out)
+{
+    const auto put_pixel = [&out](const std::uint32_t value) {
+        const std::size_t size = out.size();
+        out.resize(size + sizeof(value));
+        std::memcpy(out.data() + size, &value, sizeof(value));
+    };
+    std::size_t i = 0;
+    while (i < n) {
+        std::size_t j = i + 1;
+        while (j < n && j - i < MAX_RUN && px[j] == px[i]) {
+            j++;
+        }
+        if (j - i >= 2) {
+            out.push_back(static_cast<std::uint8_t>(127 + (j - i)));
+            put_pixel(px[i]);
+            i = j;
+            continue;
+        }
+        // Literals up to the start of the next run
+        j = i + 1;
+        while (j < n && j - i < MAX_RUN && !(j + 1 < n && px[j] == px[j + 1])) {
+            j++;
+        }
+        out.push_back(static_cast<std::uint8_t>(j - i - 1));
+        for (std::size_t k = i; k < j; k++) {
+            put_pixel(px[k]);
+        }
+        i = j;
+    }
+}
+
+// Decodes exactly n pixels, throwing std::runtime_error if the data
+// does not hold them
+static void decode_pixels(const std::uint8_t* data, const std::size_t size, std::uint32_t* px, const std::size_t n)
+{
+    std::size_t pos = 0;
+    std::size_t i = 0;
+    while (i < n) {
+        if (pos >= size) {
+            throw std::runtime_error("Frame stream tile data is truncated.");
+        }
+        const std::uint8_t c = data[pos++];
+        const std::size_t count = c < 128 ? c + 1 : c - 127;
+        const std::size_t bytes = c < 128 ? count * sizeof(std::uint32_t) : sizeof(std::uint32_t);
+        if (i + count > n || pos + bytes > size) {
+            throw std::runtime_error("Frame stream tile data is corrupt.");
+        }
+        if (c < 128) {
+            std::memcpy(px + i, data + pos, bytes);
+        } else {
+            std::uint32_t value;
+            std::memcpy(&value, data + pos, sizeof(value));
+            std::fill(px + i, px + i + count, value);
+        }
+        pos += bytes;
+        i += count;
+    }
+}
+
+FrameStreamWriter::FrameStreamWriter(const std::string& file_path, const int width, const int height, const int keyframe_interval)
+    : file_path(file_path),
+      width(width),
+      height(height),
+      tiles_x((width + FRAME_STREAM_TILE_SIZE - 1) / FRAME_STREAM_TILE_SIZE),
+      tiles_y((height + FRAME_STREAM_TILE_SIZE - 1) / FRAME_STREAM_TILE_SIZE),
+      keyframe_interval(std::max(keyframe_interval, 1)),
+      num_frames(0),
+      num_tiles_written(0),
+      offset(0)
+{
+    if (width <= 0 || height <= 0) {
+        throw std::runtime_error("Frame width and height must be positive.");
+    }
+    file.open(file_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open \"" + file_path + "\".");
+    }
+    FrameStreamHeader header = {};
+    std::memcpy(header.magic, FRAME_STREAM_MAGIC, sizeof(header.magic));
+    header.version = FRAME_STREAM_VERSION;
+    header.width = width;
+    header.height = height;
+    header.tile_size = FRAME_STREAM_TILE_SIZE;
+    header.keyframe_interval = this->keyframe_interval;
+    write(&header, sizeof(header));
+    tile.resize(FRAME_STREAM_TILE_SIZE * FRAME_STREAM_TILE_SIZE);
+}
+
+void FrameStreamWriter::write(const void* data, const std::size_t size)
+{
+    file.write(static_cast<const char*>(data), size);
+    if (!file) {
+        throw std::runtime_error("Unable to write to \"" + file_path + "\".");
+    }
+    offset += size;
+}
+
+bool FrameStreamWriter::has_tile_changed(const std::vector<std::uint32_t>& pixels, const int tx, const int ty) const
+{
+    const Kernels& kernels = get_kernels();
+    const int x0 = tx * FRAME_STREAM_TILE_SIZE;
+    const int y0 = ty * FRAME_STREAM_TILE_SIZE;
+    const std::size_t w = std::min(FRAME_STREAM_TILE_SIZE, width - x0);
+    const int y1 = std::min(y0 + FRAME_STREAM_TILE_SIZE, height);
+    for (int y = y0; y < y1; y++) {
+        const std::size_t row = (static_cast<std::size_t>(y) * width) + x0;
+        if (kernels.mismatch_u32(pixels.data() + row, previous.data() + row, w) != w) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FrameStreamWriter::write_frame(const std::vector<std::uint32_t>& pixels)
+{
+    if (pixels.size() != static_cast<std::size_t>(width) * height) {
+        throw std::runtime_error("Frame size does not match the stream.");
+    }
+    const bool is_keyframe = num_frames % keyframe_interval == 0;
+    if (is_keyframe) {
+        keyframes.push_back({num_frames, 0, offset});
+    }
+
+    const bool is_first = previous.empty();
+    if (is_first) {
+        previous = pixels;
+    }
+    buffer.clear();
+    std::uint32_t num_tiles = 0;
+    for (int ty = 0; ty < tiles_y; ty++) {
+        for (int tx = 0; tx < tiles_x; tx++) {
+            const bool has_changed = !is_first && has_tile_changed(pixels, tx, ty);
+            if (!is_keyframe && !has_changed) {
+                continue;
+            }
+            const int x0 = tx * FRAME_STREAM_TILE_SIZE;
+            const int y0 = ty * FRAME_STREAM_TILE_SIZE;
+            const int w = std::min(FRAME_STREAM_TILE_SIZE, width - x0);
+            const int h = std::min(FRAME_STREAM_TILE_SIZE, height - y0);
+            // Only changed tiles are copied into previous, rather than
+            // the whole frame
+            for (int y = 0; y < h; y++) {
+                const std::size_t row = (static_cast<std::size_t>(y0 + y) * width) + x0;
+                std::copy(pixels.begin() + row, pixels.begin() + row + w, tile.begin() + (y * w));
+                if (has_changed) {
+                    std::copy(pixels.begin() + row, pixels.begin() + row + w, previous.begin() + row);
+                }
+            }
+            const std::size_t record_pos = buffer.size();
+            buffer.resize(record_pos + sizeof(TileRecord));
+            encode_pixels(tile.data(), static_cast<std::size_t>(w) * h, buffer);
+            const TileRecord record = {static_cast<std::uint32_t>((ty * tiles_x) + tx),
+                static_cast<std::uint32_t>(buffer.size() - record_pos - sizeof(TileRecord))};
+            std::memcpy(buffer.data() + record_pos, &record, sizeof(record));
+            num_tiles++;
+        }
+    }
+
+    const FrameRecord record = {is_keyframe ? 1u : 0u, num_tiles, buffer.size()};
+    write(&record, sizeof(record));
+    write(buffer.data(), buffer.size());
+    num_tiles_written += num_tiles;
+    num_frames++;
+}
+
+void FrameStreamWriter::finish()
+{
+    FrameStreamTrailer trailer = {};
+    trailer.index_offset = offset;
+    trailer.num_frames = num_frames;
+    trailer.num_keyframes = static_cast<std::uint32_t>(keyframes.size());
+    std::memcpy(trailer.magic, FRAME_INDEX_MAGIC, sizeof(trailer.magic));
+    write(keyframes.data(), keyframes.size() * sizeof(FrameIndexEntry));
+    write(&trailer, sizeof(trailer));
+    file.close();
+}
+
+FrameStreamReader::FrameStreamReader(const std::string& file_path)
+    : file_path(file_path),
+      file(file_path, std::ios::binary),
+      current(-1)
+{
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open \"" + file_path + "\".");
+    }
+    FrameStreamHeader header;
+    read(&header, sizeof(header));
+    if (std::memcmp(header.magic, FRAME_STREAM_MAGIC, sizeof(header.magic)) != 0
+        || header.version != FRAME_STREAM_VERSION
+        || header.tile_size != FRAME_STREAM_TILE_SIZE
+        || header.width == 0 || header.height == 0
+        || header.width > (1u << 16) || header.height > (1u << 16)) {
+        throw std::runtime_error("\"" + file_path + "\" is not a frame stream.");
+    }
+    width = static_cast<int>(header.width);
+    height = static_cast<int>(header.height);
+    tiles_x = (width + FRAME_STREAM_TILE_SIZE - 1) / FRAME_STREAM_TILE_SIZE;
+    tiles_y = (height + FRAME_STREAM_TILE_SIZE - 1) / FRAME_STREAM_TILE_SIZE;
+
+    file.seekg(0, std::ios::end);
+    const std::uint64_t file_size = static_cast<std::uint64_t>(file.tellg());
+    FrameStreamTrailer trailer;
+    if (file_size < sizeof(header) + sizeof(trailer)) {
+        throw std::runtime_error("\"" + file_path + "\" is not a finished frame stream.");
+    }
+    file.seekg(file_size - sizeof(trailer));
+    read(&trailer, sizeof(trailer));
+    if (std::memcmp(trailer.magic, FRAME_INDEX_MAGIC, sizeof(trailer.magic)) != 0
+        || trailer.index_offset < sizeof(header)
+        || trailer.index_offset + (trailer.num_keyframes * sizeof(FrameIndexEntry)) != file_size - sizeof(trailer)) {
+        throw std::runtime_error("\"" + file_path + "\" is not a finished frame stream.");
+    }
+    num_frames = trailer.num_frames;
+    index_offset = trailer.index_offset;
+    keyframes.resize(trailer.num_keyframes);
+    file.seekg(index_offset);
+    read(keyframes.data(), keyframes.size() * sizeof(FrameIndexEntry));
+    for (std::size_t i = 0; i < keyframes.size(); i++) {
+        if (keyframes[i].frame >= num_frames || keyframes[i].offset < sizeof(header) || keyframes[i].offset >= index_offset
+            || (i > 0 && keyframes[i].frame <= keyframes[i - 1].frame)) {
+            throw std::runtime_error("\"" + file_path + "\" has a corrupt keyframe index.");
+        }
+    }
+    if (num_frames > 0 && (keyframes.empty() || keyframes[0].frame != 0)) {
+        throw std::runtime_error("\"" + file_path + "\" has a corrupt keyframe index.");
+    }
+    pixels.resize(static_cast<std::size_t>(width) * height);
+    tile.resize(FRAME_STREAM_TILE_SIZE * FRAME_STREAM_TILE_SIZE);
+}
+
+void FrameStreamReader::read(void* data, const std::size_t size)
+{
+    file.read(static_cast<char*>(data), size);
+    if (!file) {
+        throw std::runtime_error("Unable to read \"" + file_path + "\".");
+    }
+}
+
+void FrameStreamReader::apply_next_record()
+{
+    FrameRecord record;
+    read(&record, sizeof(record));
+    if (record.size > index_offset || record.num_tiles > static_cast<std::uint32_t>(tiles_x * tiles_y)) {
+        throw std::runtime_error("\"" + file_path + "\" has a corrupt frame.");
+    }
+    buffer.resize(record.size);
+    read(buffer.data(), buffer.size());
+
+    std::size_t pos = 0;
+    for (std::uint32_t i = 0; i < record.num_tiles; i++) {
+        TileRecord tile_record;
+        if (pos + sizeof(tile_record) > buffer.size()) {
+            throw std::runtime_error("\"" + file_path + "\" has a corrupt frame.");
+        }
+        std::memcpy(&tile_record, buffer.data() + pos, sizeof(tile_record));
+        pos += sizeof(tile_record);
+        if (tile_record.index >= static_cast<std::uint32_t>(tiles_x * tiles_y) || tile_record.size > buffer.size() - pos) {
+            throw std::runtime_error("\"" + file_path + "\" has a corrupt frame.");
+        }
+        const int x0 = (tile_record.index % tiles_x) * FRAME_STREAM_TILE_SIZE;
+        const int y0 = (tile_record.index / tiles_x) * FRAME_STREAM_TILE_SIZE;
+        const int w = std::min(FRAME_STREAM_TILE_SIZE, width - x0);
+        const int h = std::min(FRAME_STREAM_TILE_SIZE, height - y0);
+        decode_pixels(buffer.data() + pos, tile_record.size, tile.data(), static_cast<std::size_t>(w) * h);
+        for (int y = 0; y < h; y++) {
+            std::copy(tile.begin() + (y * w), tile.begin() + ((y + 1) * w),
+                pixels.begin() + (static_cast<std::size_t>(y0 + y) * width) + x0);
+        }
+        pos += tile_record.size;
+    }
+}
+
+const std::vector<std::uint32_t>& FrameStreamReader::read_frame(const int frame)
+{
+    if (frame < 0 || static_cast<std::uint32_t>(frame) >= num_frames) {
+        throw std::out_of_range("Frame " + std::to_string(frame) + " is not in the stream");
+    }
+    // Last keyframe at or before the frame
+    const auto keyframe = std::upper_bound(keyframes.begin(), keyframes.end(), static_cast<std::uint32_t>(frame),
+        [](const std::uint32_t f, const FrameIndexEntry& entry) { return f < entry.frame; }) - 1;
+    int position = current;
+    // Decoding on from the current frame is cheaper unless the keyframe
+    // is closer
+    if (frame <= current || static_cast<int>(keyframe->frame) > current) {
+        file.clear();
+        file.seekg(keyframe->offset);
+        position = static_cast<int>(keyframe->frame) - 1;
+    }
+    // Unknown if a record turns out to be corrupt
+    current = -1;
+    while (position < frame) {
+        apply_next_record();
+        position++;
+    }
+    current = position;
+    return pixels;
+}
@@ -0,0 +1,143 @@
+#ifndef FRAME_STREAM_H
+#define FRAME_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Frame streams hold a sequence of frames of the same size, such as an
+// animation, storing per frame only the tiles that changed since the
+// previous one. Every keyframe_interval frames a keyframe stores all
+// tiles, so a reader can seek without decoding from the start.
+//
+// Tiles are compared a row at a time with the mismatch_u32 kernel and
+// compressed with a run-length code on whole pixels, which suits the
+// flat colors drawn here:
+//   control byte c < 128: c + 1 literal pixels follow
+//   control byte c >= 128: the next pixel repeats c - 127 times
+//
+// File layout, in native byte order:
+//   FrameStreamHeader
+//   per frame: FrameRecord, then per tile a TileRecord and its data
+//   FrameIndexEntry[num_keyframes]
+//   FrameStreamTrailer
+
+constexpr char FRAME_STREAM_MAGIC[4] = {'D', '2', 'F', 'S'};
+constexpr char FRAME_INDEX_MAGIC[4] = {'D', '2', 'F', 'I'};
+constexpr std::uint32_t FRAME_STREAM_VERSION = 1;
+constexpr int FRAME_STREAM_TILE_SIZE = 64;
+
+struct FrameStreamHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t tile_size;
+    std::uint32_t keyframe_interval;
+};
+
+struct FrameRecord {
+    std::uint32_t is_keyframe;
+    std::uint32_t num_tiles;
+    // Bytes of tile records and data that follow
+    std::uint64_t size;
+};
+
+struct TileRecord {
+    // Row-major index of the tile in the frame
+    std::uint32_t index;
+    // Bytes of compressed data that follow
+    std::uint32_t size;
+};
+
+struct FrameIndexEntry {
+    std::uint32_t frame;
+    std::uint32_t reserved;
+    // File offset of the keyframe's FrameRecord
+    std::uint64_t offset;
+};
+
+struct FrameStreamTrailer {
+    std::uint64_t index_offset;
+    std::uint32_t num_frames;
+    std::uint32_t num_keyframes;
+    char magic[4];
+    std::uint32_t reserved;
+};
+
+// Writes frames as they are produced. Throws std::runtime_error on I/O
+// errors; the file is only readable once finish() has been called.
+class FrameStreamWriter {
+public:
+    FrameStreamWriter(const std::string& file_path, const int width, const int height, const int keyframe_interval = 60);
+
+    // pixels must hold width * height pixels
+    void write_frame(const std::vector<std::uint32_t>& pixels);
+    void finish();
+
+    int get_num_frames() const { return static_cast<int>(num_frames); }
+    std::size_t get_num_tiles_written() const { return num_tiles_written; }
+    std::size_t get_bytes_written() const { return offset; }
+
+private:
+    std::string file_path;
+    std::ofstream file;
+    int width;
+    int height;
+    int tiles_x;
+    int tiles_y;
+    int keyframe_interval;
+    std::uint32_t num_frames;
+    std::size_t num_tiles_written;
+    std::uint64_t offset;
+    std::vector<std::uint32_t> previous;
+    std::vector<FrameIndexEntry> keyframes;
+    // Reused between frames
+    std::vector<std::uint32_t> tile;
+    std::vector<std::uint8_t> buffer;
+
+    bool has_tile_changed(const std::vector<std::uint32_t>& pixels, const int tx, const int ty) const;
+    void write(const void* data, const std::size_t size);
+};
+
+// Reads back the frames of a finished stream. Throws std::runtime_error
+// if the file cannot be read or is not a consistent stream.
+class FrameStreamReader {
+public:
+    explicit FrameStreamReader(const std::string& file_path);
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+    int get_num_frames() const { return static_cast<int>(num_frames); }
+
+    // Reconstructs a frame. Reading on from the last frame read only
+    // applies the changes in between; other frames are decoded from the
+    // nearest keyframe before them. Throws std::out_of_range for a frame
+    // not in the stream. The frame is valid until the next call.
+    const std::vector<std::uint32_t>& read_frame(const int frame);
+
+private:
+    std::string file_path;
+    std::ifstream file;
+    int width;
+    int height;
+    int tiles_x;
+    int tiles_y;
+    std::uint32_t num_frames;
+    std::uint64_t index_offset;
+    std::vector<FrameIndexEntry> keyframes;
+    std::vector<std::uint32_t> pixels;
+    // Frame in pixels, -1 before the first read
+    int current;
+    // Reused between frames
+    std::vector<std::uint32_t> tile;
+    std::vector<std::uint8_t> buffer;
+
+    // Applies the record at the file position
+    void apply_next_record();
+    void read(void* data, const std::size_t size);
+};
+
+#endif
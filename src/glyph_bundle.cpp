@@ -0,0 +1,288 @@
+#include "glyph_bundle.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "bezier_raster.h"
+#include "bitmask.h"
+#include "constants.h"
+#include "fill.h"
+#include "instrument.h"
+#include "line_raster.h"
+#include "pixel_sink.h"
+#include "svg.h"
+
+// Pieces of curves with float control points may round one pixel
+// outside the hull of their control points
+constexpr int PATH_MARGIN = 1;
+
+static std::uint32_t get_glyph_id(const std::filesystem::path& file_path)
+{
+    const std::string stem = file_path.stem().string();
+    if (stem.empty() || stem.size() > 10 || !std::all_of(stem.begin(), stem.end(), [](const char c) { return c >= '0' && c <= '9'; })) {
+        throw std::runtime_error("\"" + file_path.string() + "\" is not named by a glyph id.");
+    }
+    const unsigned long long id = std::stoull(stem);
+    if (id > UINT32_MAX) {
+        throw std::runtime_error("\"" + file_path.string() + "\" is not named by a glyph id.");
+    }
+    return static_cast<std::uint32_t>(id);
+}
+
+static void merge_bounds(DrawBounds& bounds, const DrawBounds& other)
+{
+    bounds.x_min = std::min(bounds.x_min, other.x_min);
+    bounds.y_min = std::min(bounds.y_min, other.y_min);
+    bounds.x_max = std::max(bounds.x_max, other.x_max);
+    bounds.y_max = std::max(bounds.y_max, other.y_max);
+}
+
+template <typename T>
+static void write_records(std::ofstream& file, const std::vector<T>& records)
+{
+    file.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(T)));
+}
+
+std::size_t compile_glyph_bundle(const std::string& dir_path, const std::string& bundle_path)
+{
+    std::vector<std::pair<std::uint32_t, std::string>> files;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(dir_path)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".svg") {
+            files.emplace_back(get_glyph_id(entry.path()), entry.path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    for (std::size_t i = 1; i < files.size(); i++) {
+        if (files[i].first == files[i - 1].first) {
+            throw std::runtime_error("\"" + files[i - 1].second + "\" and \"" + files[i].second + "\" have the same glyph id.");
+        }
+    }
+
+    std::vector<BundleGlyph> glyphs;
+    std::vector<BundlePath> paths;
+    std::vector<BundleLine> lines;
+    std::vector<BundleQuad> quads;
+    std::vector<BundleCubic> cubics;
+    for (const auto& [id, file_path] : files) {
+        BundleGlyph glyph = {id, static_cast<std::uint32_t>(paths.size()), 0, {0, 0, -1, -1}};
+        for (const std::string& path_str : get_paths_from_svg(file_path)) {
+            const std::vector<PathSegment> segments = parse_path(path_str);
+            if (segments.empty()) {
+                continue;
+            }
+            BundlePath path = {
+                static_cast<std::uint32_t>(lines.size()), 0,
+                static_cast<std::uint32_t>(quads.size()), 0,
+                static_cast<std::uint32_t>(cubics.size()), 0,
+                get_path_bounds(segments)
+            };
+            for (const PathSegment& seg : segments) {
+                const std::array<int, 8>& c = seg.c;
+                switch (seg.type) {
+                    case PathSegmentType::line:
+                        lines.push_back({c[0], c[1], c[2], c[3]});
+                        break;
+                    case PathSegmentType::quad:
+                        split_bezier_quad(c[0], c[1], c[2], c[3], c[4], c[5],
+                            [&](const int x0, const int y0, const int x1, const int y1, const int x2, const int y2) {
+                                quads.push_back({x0, y0, x1, y1, x2, y2});
+                            });
+                        break;
+                    case PathSegmentType::cubic:
+                        split_bezier_cubic(c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7],
+                            [&](const int x0, const int y0, const float x1, const float y1, const float x2, const float y2, const int x3, const int y3) {
+                                cubics.push_back({x0, y0, x1, y1, x2, y2, x3, y3});
+                            });
+                        break;
+                }
+            }
+            path.num_lines = static_cast<std::uint32_t>(lines.size()) - path.first_line;
+            path.num_quads = static_cast<std::uint32_t>(quads.size()) - path.first_quad;
+            path.num_cubics = static_cast<std::uint32_t>(cubics.size()) - path.first_cubic;
+            if (glyph.num_paths == 0) {
+                glyph.bounds = path.bounds;
+            } else {
+                merge_bounds(glyph.bounds, path.bounds);
+            }
+            glyph.num_paths++;
+            paths.push_back(path);
+        }
+        glyphs.push_back(glyph);
+    }
+
+    BundleHeader header = {};
+    std::copy(std::begin(GLYPH_BUNDLE_MAGIC), std::end(GLYPH_BUNDLE_MAGIC), header.magic);
+    header.version = GLYPH_BUNDLE_VERSION;
+    header.num_glyphs = static_cast<std::uint32_t>(glyphs.size());
+    header.num_paths = static_cast<std::uint32_t>(paths.size());
+    header.num_lines = static_cast<std::uint32_t>(lines.size());
+    header.num_quads = static_cast<std::uint32_t>(quads.size());
+    header.num_cubics = static_cast<std::uint32_t>(cubics.size());
+
+    std::ofstream file(bundle_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open \"" + bundle_path + "\".");
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_records(file, glyphs);
+    write_records(file, paths);
+    write_records(file, lines);
+    write_records(file, quads);
+    write_records(file, cubics);
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Unable to write \"" + bundle_path + "\".");
+    }
+    return glyphs.size();
+}
+
+// True if [first, first + count) lies within an array of size records
+static bool is_valid_range(const std::uint32_t first, const std::uint32_t count, const std::uint32_t size)
+{
+    return static_cast<std::uint64_t>(first) + count <= size;
+}
+
+GlyphBundle::GlyphBundle(const std::string& file_path)
+    : mapping(nullptr), mapping_size(0)
+{
+    const int fd = open(file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to open \"" + file_path + "\": " + std::strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(BundleHeader)) {
+        close(fd);
+        throw std::runtime_error("\"" + file_path + "\" is not a glyph bundle.");
+    }
+    mapping_size = static_cast<std::size_t>(st.st_size);
+    void* const address = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    const int error = errno;
+    close(fd);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("Unable to map \"" + file_path + "\": " + std::strerror(error));
+    }
+    mapping = static_cast<const unsigned char*>(address);
+
+    // The records are all 4-byte aligned, and the mapping is page aligned
+    header = reinterpret_cast<const BundleHeader*>(mapping);
+    bool is_valid = std::equal(std::begin(GLYPH_BUNDLE_MAGIC), std::end(GLYPH_BUNDLE_MAGIC), header->magic)
+        && header->version == GLYPH_BUNDLE_VERSION
+        && sizeof(BundleHeader)
+            + (std::size_t{header->num_glyphs} * sizeof(BundleGlyph))
+            + (std::size_t{header->num_paths} * sizeof(BundlePath))
+            + (std::size_t{header->num_lines} * sizeof(BundleLine))
+            + (std::size_t{header->num_quads} * sizeof(BundleQuad))
+            + (std::size_t{header->num_cubics} * sizeof(BundleCubic)) == mapping_size;
+    if (is_valid) {
+        glyphs = reinterpret_cast<const BundleGlyph*>(header + 1);
+        paths = reinterpret_cast<const BundlePath*>(glyphs + header->num_glyphs);
+        lines = reinterpret_cast<const BundleLine*>(paths + header->num_paths);
+        quads = reinterpret_cast<const BundleQuad*>(lines + header->num_lines);
+        cubics = reinterpret_cast<const BundleCubic*>(quads + header->num_quads);
+    }
+    for (std::uint32_t i = 0; is_valid && i < header->num_glyphs; i++) {
+        is_valid = is_valid_range(glyphs[i].first_path, glyphs[i].num_paths, header->num_paths)
+            && (i == 0 || glyphs[i - 1].id < glyphs[i].id);
+    }
+    for (std::uint32_t i = 0; is_valid && i < header->num_paths; i++) {
+        const BundlePath& path = paths[i];
+        is_valid = is_valid_range(path.first_line, path.num_lines, header->num_lines)
+            && is_valid_range(path.first_quad, path.num_quads, header->num_quads)
+            && is_valid_range(path.first_cubic, path.num_cubics, header->num_cubics);
+    }
+    if (!is_valid) {
+        munmap(const_cast<unsigned char*>(mapping), mapping_size);
+        throw std::runtime_error("\"" + file_path + "\" is not a valid glyph bundle.");
+    }
+}
+
+GlyphBundle::~GlyphBundle()
+{
+    munmap(const_cast<unsigned char*>(mapping), mapping_size);
+}
+
+const BundleGlyph* GlyphBundle::find_glyph(const std::uint32_t id) const
+{
+    const BundleGlyph* end = glyphs + header->num_glyphs;
+    const BundleGlyph* glyph = std::lower_bound(glyphs, end, id, [](const BundleGlyph& g, const std::uint32_t value) {
+        return g.id < value;
+    });
+    return glyph != end && glyph->id == id ? glyph : nullptr;
+}
+
+void GlyphBundle::draw_glyph(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const std::uint32_t id,
+    const int dx, const int dy) const
+{
+    INSTRUMENT_SCOPE(svg);
+    const BundleGlyph* glyph = find_glyph(id);
+    if (glyph == nullptr) {
+        throw std::out_of_range("GlyphBundle: no glyph " + std::to_string(id));
+    }
+    const BundlePath* first = paths + glyph->first_path;
+    for (const BundlePath* path = first; path != first + glyph->num_paths; path++) {
+        fill_path(pixels, color, *path, dx, dy);
+    }
+}
+
+// Same steps as fill_path_segments, on a mask covering only the path.
+// The path is rasterized where it is in the glyph and only its fill is
+// offset and clipped to the screen, so a glyph partly off the screen
+// keeps its outline closed.
+void GlyphBundle::fill_path(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const BundlePath& path,
+    const int dx, const int dy) const
+{
+    INSTRUMENT_SCOPE(path);
+    const int x_min = path.bounds.x_min - PATH_MARGIN;
+    const int y_min = path.bounds.y_min - PATH_MARGIN;
+    const int x_max = path.bounds.x_max + PATH_MARGIN;
+    const int y_max = path.bounds.y_max + PATH_MARGIN;
+    if (x_max + dx < 0 || y_max + dy < 0 || x_min + dx >= SCREEN_WIDTH || y_min + dy >= SCREEN_HEIGHT) {
+        return;
+    }
+
+    BitMask mask(x_max - x_min + 1, y_max - y_min + 1);
+    OffsetMaskSink mask_sink(mask, x_max + 1, y_max + 1, x_min, y_min);
+    for (const BundleLine* l = lines + path.first_line; l != lines + path.first_line + path.num_lines; l++) {
+        rasterize_line_bresenham(mask_sink, l->x0, l->y0, l->x1, l->y1);
+    }
+    for (const BundleQuad* q = quads + path.first_quad; q != quads + path.first_quad + path.num_quads; q++) {
+        rasterize_bezier_quad_seg(mask_sink, q->x0, q->y0, q->x1, q->y1, q->x2, q->y2);
+    }
+    for (const BundleCubic* c = cubics + path.first_cubic; c != cubics + path.first_cubic + path.num_cubics; c++) {
+        rasterize_bezier_cubic_seg(mask_sink, c->x0, c->y0, c->x1, c->y1, c->x2, c->y2, c->x3, c->y3);
+    }
+    const BoundingRect br = get_bounding_rect(mask);
+    if (br.x_min > br.x_max) {
+        return;
+    }
+    scanline_fill_area(mask, br.x_min, br.y_min, br.x_max, br.y_max);
+
+    // Mask pixel (x, y) lands on screen pixel (x + ox, y + oy)
+    const int ox = x_min + dx;
+    const int oy = y_min + dy;
+    const int y_begin = std::max(static_cast<int>(br.y_min), -oy);
+    const int y_end = std::min(static_cast<int>(br.y_max) + 1, SCREEN_HEIGHT - oy);
+    const int x_begin = std::max(static_cast<int>(br.x_min), -ox);
+    const int x_end = std::min(mask.get_width(), SCREEN_WIDTH - ox);
+    UncheckedSink sink(pixels, color);
+    for (int y = y_begin; y < y_end; y++) {
+        int x = mask.find_next_bit(y, x_begin, x_end, true);
+        while (x < x_end) {
+            const int run_end = mask.find_next_bit(y, x, x_end, false);
+            sink.span(x + ox, run_end - 1 + ox, y + oy);
+            x = mask.find_next_bit(y, run_end, x_end, true);
+        }
+    }
+}
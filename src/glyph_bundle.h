@@ -0,0 +1,121 @@
+#ifndef GLYPH_BUNDLE_H
+#define GLYPH_BUNDLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "display_list.h"
+
+// A glyph bundle holds the SVG glyphs of a directory, compiled offline
+// into one file that is mapped into memory and drawn from in place.
+// Curves are stored already cut into the monotonic pieces the Bezier
+// rasterizers draw, so drawing a glyph does no parsing, splitting or
+// copying.
+//
+// File layout, in native byte order, every record 4-byte aligned:
+//   BundleHeader
+//   BundleGlyph[num_glyphs], sorted by id
+//   BundlePath[num_paths]
+//   BundleLine[num_lines]
+//   BundleQuad[num_quads]
+//   BundleCubic[num_cubics]
+// The paths of a glyph, and the lines, quads and cubics of a path, are
+// contiguous runs of their arrays.
+
+constexpr char GLYPH_BUNDLE_MAGIC[4] = {'D', '2', 'G', 'B'};
+constexpr std::uint32_t GLYPH_BUNDLE_VERSION = 1;
+
+struct BundleHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t num_glyphs;
+    std::uint32_t num_paths;
+    std::uint32_t num_lines;
+    std::uint32_t num_quads;
+    std::uint32_t num_cubics;
+    std::uint32_t reserved;
+};
+
+struct BundleGlyph {
+    std::uint32_t id;
+    std::uint32_t first_path;
+    std::uint32_t num_paths;
+    // Hull of the control points of all paths
+    DrawBounds bounds;
+};
+
+struct BundlePath {
+    std::uint32_t first_line;
+    std::uint32_t num_lines;
+    std::uint32_t first_quad;
+    std::uint32_t num_quads;
+    std::uint32_t first_cubic;
+    std::uint32_t num_cubics;
+    DrawBounds bounds;
+};
+
+struct BundleLine {
+    std::int32_t x0, y0, x1, y1;
+};
+
+// Monotonic quadratic piece, as passed to rasterize_bezier_quad_seg
+struct BundleQuad {
+    std::int32_t x0, y0, x1, y1, x2, y2;
+};
+
+// Monotonic cubic piece, as passed to rasterize_bezier_cubic_seg
+struct BundleCubic {
+    std::int32_t x0, y0;
+    float x1, y1, x2, y2;
+    std::int32_t x3, y3;
+};
+
+// Compiles every SVG file in dir_path into a bundle at bundle_path and
+// returns the number of glyphs. A glyph's id is its file name, which
+// must be a decimal number as in AnimCJK ("19976.svg"). Throws
+// std::runtime_error for other file names and for I/O errors.
+std::size_t compile_glyph_bundle(const std::string& dir_path, const std::string& bundle_path);
+
+// Read-only mapping of a bundle file
+class GlyphBundle {
+public:
+    // Throws std::runtime_error if the file cannot be mapped or is not
+    // a consistent bundle
+    explicit GlyphBundle(const std::string& file_path);
+    ~GlyphBundle();
+
+    GlyphBundle(const GlyphBundle&) = delete;
+    GlyphBundle& operator=(const GlyphBundle&) = delete;
+
+    std::size_t get_num_glyphs() const { return header->num_glyphs; }
+    std::size_t get_size() const { return mapping_size; }
+    const BundleGlyph& get_glyph(const std::size_t index) const { return glyphs[index]; }
+
+    // nullptr if the bundle has no glyph with this id
+    const BundleGlyph* find_glyph(const std::uint32_t id) const;
+
+    // Fills the paths of a glyph as draw_svg does, offset by (dx, dy).
+    // Pixels off the screen are discarded. Throws std::out_of_range if
+    // the bundle has no glyph with this id.
+    void draw_glyph(
+        std::vector<std::uint32_t>& pixels,
+        const std::uint32_t color,
+        const std::uint32_t id,
+        const int dx = 0, const int dy = 0
+    ) const;
+
+private:
+    const unsigned char* mapping;
+    std::size_t mapping_size;
+    const BundleHeader* header;
+    const BundleGlyph* glyphs;
+    const BundlePath* paths;
+    const BundleLine* lines;
+    const BundleQuad* quads;
+    const BundleCubic* cubics;
+
+    void fill_path(std::vector<std::uint32_t>& pixels, const std::uint32_t color, const BundlePath& path, const int dx, const int dy) const;
+};
+
+#endif
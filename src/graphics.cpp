@@ -1,12 +1,17 @@
 #include "graphics.h"
 #include "constants.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <exception>
 #include "line.h"
+#include "kernels.h"
+#include "row_executor.h"
 
 bool Graphics::was_instantiated = false;
 
-Graphics::Graphics()
+Graphics::Graphics(const bool vsync)
     : pixels(NUM_PIXELS, blank)
 {
     if (was_instantiated) {
@@ -30,7 +35,7 @@ Graphics::Graphics()
         throw std::runtime_error("SDL_CreateWindow failed");
     }
 
-    renderer = SDL_CreateRenderer(window, -1, 0);
+    renderer = SDL_CreateRenderer(window, -1, vsync ? SDL_RENDERER_PRESENTVSYNC : 0);
     if (renderer == nullptr) {
         throw std::runtime_error("SDL_CreateRenderer failed");
     }
@@ -62,5 +67,114 @@ void Graphics::render()
     SDL_UpdateTexture(texture, nullptr, pixels.data(), TEXTURE_PITCH);
     SDL_RenderCopy(renderer, texture, nullptr, nullptr);
     SDL_RenderPresent(renderer);
-    std::fill(pixels.begin(), pixels.end(), 0x00FFFFFF);
+    const Kernels& kernels = get_kernels();
+    get_row_executor().for_each_band(0, SCREEN_HEIGHT, TEXTURE_PITCH, [&](const int y0, const int y1) {
+        kernels.fill_u32(pixels.data() + (y0 * SCREEN_WIDTH), (y1 - y0) * SCREEN_WIDTH, blank);
+    });
+}
+
+void Graphics::present()
+{
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+    SDL_RenderPresent(renderer);
+}
+
+FrameLoop::FrameLoop(Graphics& gfx, const double target_fps)
+    : gfx(gfx), target_fps(target_fps), redraw_requested(false)
+{
+    reset_stats();
+}
+
+void FrameLoop::reset_stats()
+{
+    stats = {0, 0, 0, 0, 0};
+}
+
+void FrameLoop::end_frame(const std::chrono::steady_clock::time_point frame_start)
+{
+    gfx.render();
+    const auto frame_end = std::chrono::steady_clock::now();
+    const double us_elapsed = std::chrono::duration<double, std::micro>(frame_end - frame_start).count();
+    stats.num_frames++;
+    stats.us_frame_total += us_elapsed;
+    stats.us_frame_max = std::max(stats.us_frame_max, us_elapsed);
+}
+
+LoopControl FrameLoop::run(
+    const std::function<LoopControl(const SDL_Event&)>& on_event,
+    const std::function<bool(double)>& on_frame)
+{
+    using clock = std::chrono::steady_clock;
+    const auto loop_start = clock::now();
+    const auto frame_period = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>(target_fps > 0 ? 1 / target_fps : 0));
+    auto next_frame = loop_start;
+    bool animating = static_cast<bool>(on_frame);
+    LoopControl control = LoopControl::keep_running;
+
+    while (control == LoopControl::keep_running) {
+        // Sleep until an event arrives or, when animating, the next frame
+        // is due. -1 waits indefinitely.
+        int timeout_ms = -1;
+        if (redraw_requested) {
+            timeout_ms = 0;
+        } else if (animating) {
+            const double ms_left = std::chrono::duration<double, std::milli>(next_frame - clock::now()).count();
+            timeout_ms = std::max(0, static_cast<int>(std::ceil(ms_left)));
+        }
+        SDL_Event event;
+        const auto wait_start = clock::now();
+        bool has_event = timeout_ms < 0 ? SDL_WaitEvent(&event) != 0 : SDL_WaitEventTimeout(&event, timeout_ms) != 0;
+        stats.us_idle += std::chrono::duration<double, std::micro>(clock::now() - wait_start).count();
+
+        while (has_event && control == LoopControl::keep_running) {
+            if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_EXPOSED) {
+                gfx.present();
+            }
+            control = on_event(event);
+            has_event = SDL_PollEvent(&event) != 0;
+        }
+        if (control != LoopControl::keep_running) {
+            break;
+        }
+
+        const auto frame_start = clock::now();
+        if (animating && frame_start >= next_frame) {
+            animating = on_frame(std::chrono::duration<double>(frame_start - loop_start).count());
+            end_frame(frame_start);
+            redraw_requested = false;
+            next_frame += frame_period;
+            if (next_frame < clock::now()) {
+                next_frame = clock::now();
+            }
+            if (!animating) {
+                control = LoopControl::finish;
+            }
+        } else if (redraw_requested) {
+            end_frame(frame_start);
+            redraw_requested = false;
+        }
+    }
+    stats.us_total += std::chrono::duration<double, std::micro>(clock::now() - loop_start).count();
+    return control;
+}
+
+LoopControl get_default_control(const SDL_Event& event)
+{
+    if (event.type == SDL_QUIT) {
+        return LoopControl::quit;
+    }
+    if (event.type == SDL_KEYDOWN) {
+        switch (event.key.keysym.sym) {
+        case SDLK_RETURN:
+        case SDLK_SPACE:
+            return LoopControl::finish;
+        case SDLK_ESCAPE:
+            return LoopControl::quit;
+        default:
+            break;
+        }
+    }
+    return LoopControl::keep_running;
 }
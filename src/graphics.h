@@ -2,16 +2,22 @@
 #define GRAPHICS_H
 
 #include <vector>
+#include <chrono>
 #include <cstdint>
+#include <functional>
 #include <SDL2/SDL.h>
 
 class Graphics {
 public:
     std::vector<std::uint32_t> pixels;
 
-    Graphics();
+    // With vsync, render() blocks until the next display refresh
+    explicit Graphics(const bool vsync = false);
     ~Graphics();
     void render();
+    // Shows the last rendered frame again, e.g. after the window was
+    // uncovered
+    void present();
 
 private:
     static bool was_instantiated;
@@ -20,4 +26,65 @@ private:
     SDL_Texture* texture;
 };
 
+// What a FrameLoop does after an input event
+enum class LoopControl {
+    keep_running,
+    // Leave the loop normally
+    finish,
+    // Leave the loop and the program
+    quit
+};
+
+struct FrameStats {
+    // Frames rendered, whether animation frames or redraws
+    int num_frames;
+    // Drawing and rendering; with vsync this includes waiting for the
+    // display
+    double us_frame_total;
+    double us_frame_max;
+    // Time spent blocked waiting for events or for the next frame
+    double us_idle;
+    double us_total;
+};
+
+// Event-driven render loop. Between frames it sleeps in
+// SDL_WaitEventTimeout instead of polling, so an idle window uses no CPU.
+//
+// Without an animation it renders only when an event handler asks for a
+// redraw. With one, frames are paced to target_fps; a target_fps of 0
+// renders frames back to back, which is paced by the display when the
+// Graphics has vsync. Frames that fall behind are dropped rather than
+// rendered in a burst.
+class FrameLoop {
+public:
+    FrameLoop(Graphics& gfx, const double target_fps);
+
+    // Runs until on_event returns finish or quit, or until on_frame
+    // returns false. on_frame(t) draws the frame at t seconds after the
+    // loop started into gfx.pixels. Returns finish when the animation
+    // ends.
+    LoopControl run(
+        const std::function<LoopControl(const SDL_Event&)>& on_event,
+        const std::function<bool(double)>& on_frame = nullptr
+    );
+
+    // Renders gfx.pixels once the pending events are handled
+    void request_redraw() { redraw_requested = true; }
+
+    const FrameStats& get_stats() const { return stats; }
+    void reset_stats();
+
+private:
+    Graphics& gfx;
+    const double target_fps;
+    bool redraw_requested;
+    FrameStats stats;
+
+    // Renders gfx.pixels and records the time since frame_start
+    void end_frame(const std::chrono::steady_clock::time_point frame_start);
+};
+
+// Quits on the window closing or Escape and finishes on Enter or Space
+LoopControl get_default_control(const SDL_Event& event);
+
 #endif
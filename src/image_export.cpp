@@ -0,0 +1,339 @@
+#include "image_export.h"
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include "constants.h"
+#include "deflate.h"
+#include "tiled_canvas.h"
+
+// Output is handed to the file in pieces of about this size
+constexpr std::size_t WRITE_BUFFER_SIZE = 1 << 20;
+// Uncompressed bytes per PNG band, enough to amortize the block headers
+// and the restart of the match window
+constexpr std::size_t PNG_BAND_BYTES = 256 * 1024;
+
+constexpr std::uint8_t QOI_OP_INDEX = 0x00;
+constexpr std::uint8_t QOI_OP_DIFF = 0x40;
+constexpr std::uint8_t QOI_OP_LUMA = 0x80;
+constexpr std::uint8_t QOI_OP_RUN = 0xC0;
+constexpr std::uint8_t QOI_OP_RGB = 0xFE;
+constexpr int QOI_MAX_RUN = 62;
+
+static void put_u32_be(std::vector<std::uint8_t>& out, const std::uint32_t value)
+{
+    out.push_back(static_cast<std::uint8_t>(value >> 24));
+    out.push_back(static_cast<std::uint8_t>(value >> 16));
+    out.push_back(static_cast<std::uint8_t>(value >> 8));
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+static std::ofstream open_for_writing(const std::string& file_path, const int width, const int height)
+{
+    if (width <= 0 || height <= 0) {
+        throw std::runtime_error("Image width and height must be positive.");
+    }
+    std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open \"" + file_path + "\".");
+    }
+    return file;
+}
+
+static void check_rows(const int rows_written, const int num_rows, const int height)
+{
+    if (num_rows < 0 || rows_written + num_rows > height) {
+        throw std::out_of_range("More rows written than the image has");
+    }
+}
+
+QoiWriter::QoiWriter(const std::string& file_path, const int width, const int height)
+    : file_path(file_path),
+      file(open_for_writing(file_path, width, height)),
+      width(width),
+      height(height),
+      rows_written(0),
+      index(),
+      previous(0xFF000000),
+      run(0)
+{
+    buffer.reserve(WRITE_BUFFER_SIZE + (static_cast<std::size_t>(width) * 4));
+    buffer.insert(buffer.end(), {'q', 'o', 'i', 'f'});
+    put_u32_be(buffer, width);
+    put_u32_be(buffer, height);
+    // RGB, sRGB with linear alpha
+    buffer.push_back(3);
+    buffer.push_back(0);
+}
+
+void QoiWriter::write_rows(const std::uint32_t* rows, const int num_rows, const std::size_t stride)
+{
+    check_rows(rows_written, num_rows, height);
+    for (int y = 0; y < num_rows; y++) {
+        const std::uint32_t* row = rows + (y * stride);
+        for (int x = 0; x < width; x++) {
+            const std::uint32_t px = row[x] | 0xFF000000;
+            if (px == previous) {
+                run++;
+                if (run == QOI_MAX_RUN) {
+                    buffer.push_back(QOI_OP_RUN | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                buffer.push_back(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+            const int r = (px >> 16) & 0xFF;
+            const int g = (px >> 8) & 0xFF;
+            const int b = px & 0xFF;
+            const int hash = ((r * 3) + (g * 5) + (b * 7) + (255 * 11)) % 64;
+            if (index[hash] == px) {
+                buffer.push_back(QOI_OP_INDEX | hash);
+            } else {
+                index[hash] = px;
+                // Channel differences wrap around
+                const int dr = static_cast<std::int8_t>(r - ((previous >> 16) & 0xFF));
+                const int dg = static_cast<std::int8_t>(g - ((previous >> 8) & 0xFF));
+                const int db = static_cast<std::int8_t>(b - (previous & 0xFF));
+                const int dr_dg = dr - dg;
+                const int db_dg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    buffer.push_back(QOI_OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+                } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+                    buffer.push_back(QOI_OP_LUMA | (dg + 32));
+                    buffer.push_back(((dr_dg + 8) << 4) | (db_dg + 8));
+                } else {
+                    buffer.insert(buffer.end(), {
+                        QOI_OP_RGB,
+                        static_cast<std::uint8_t>(r),
+                        static_cast<std::uint8_t>(g),
+                        static_cast<std::uint8_t>(b)
+                    });
+                }
+            }
+            previous = px;
+        }
+        if (buffer.size() >= WRITE_BUFFER_SIZE) {
+            flush_buffer();
+        }
+    }
+    rows_written += num_rows;
+}
+
+void QoiWriter::finish()
+{
+    if (rows_written != height) {
+        throw std::runtime_error("Unable to finish \"" + file_path + "\": rows missing.");
+    }
+    if (run > 0) {
+        buffer.push_back(QOI_OP_RUN | (run - 1));
+        run = 0;
+    }
+    buffer.insert(buffer.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+    flush_buffer();
+    file.close();
+    if (file.fail()) {
+        throw std::runtime_error("Unable to write \"" + file_path + "\".");
+    }
+}
+
+void QoiWriter::flush_buffer()
+{
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    if (file.fail()) {
+        throw std::runtime_error("Unable to write \"" + file_path + "\".");
+    }
+    buffer.clear();
+}
+
+// Filters rows 1..num_rows of pixels with the Up filter, each against
+// the row before it, and deflates them into an IDAT chunk
+static std::vector<std::uint8_t> encode_png_band(
+    const std::vector<std::uint32_t>& pixels,
+    const int width,
+    const int num_rows,
+    std::uint32_t& adler,
+    std::size_t& size)
+{
+    const std::size_t row_bytes = 1 + (static_cast<std::size_t>(width) * 3);
+    std::vector<std::uint8_t> filtered(row_bytes * num_rows);
+    for (int y = 0; y < num_rows; y++) {
+        const std::uint32_t* above = pixels.data() + (static_cast<std::size_t>(y) * width);
+        const std::uint32_t* row = above + width;
+        std::uint8_t* out = filtered.data() + (y * row_bytes);
+        *out++ = 2;
+        for (int x = 0; x < width; x++) {
+            // Byte-wise subtraction of the R, G and B channels
+            const std::uint32_t diff = ((row[x] | 0x80808080) - (above[x] & 0x7F7F7F7F)) ^ ((row[x] ^ ~above[x]) & 0x80808080);
+            out[0] = static_cast<std::uint8_t>(diff >> 16);
+            out[1] = static_cast<std::uint8_t>(diff >> 8);
+            out[2] = static_cast<std::uint8_t>(diff);
+            out += 3;
+        }
+    }
+    adler = adler32(filtered.data(), filtered.size());
+    size = filtered.size();
+
+    std::vector<std::uint8_t> chunk = {0, 0, 0, 0, 'I', 'D', 'A', 'T'};
+    deflate_append(chunk, filtered.data(), filtered.size());
+    const std::uint32_t length = static_cast<std::uint32_t>(chunk.size() - 8);
+    for (int i = 0; i < 4; i++) {
+        chunk[i] = static_cast<std::uint8_t>(length >> (24 - (8 * i)));
+    }
+    put_u32_be(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+    return chunk;
+}
+
+PngWriter::PngWriter(const std::string& file_path, const int width, const int height, const int num_threads)
+    : file_path(file_path),
+      file(open_for_writing(file_path, width, height)),
+      width(width),
+      height(height),
+      rows_written(0),
+      rows_per_band(std::max<int>(1, PNG_BAND_BYTES / (static_cast<std::size_t>(width) * 3))),
+      max_pending(num_threads > 0 ? num_threads : std::max(1u, std::thread::hardware_concurrency())),
+      band(width, 0),
+      band_rows(0),
+      adler(1)
+{
+    static const std::uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+    std::vector<std::uint8_t> header;
+    put_u32_be(header, width);
+    put_u32_be(header, height);
+    // 8 bits per channel, RGB, deflate, adaptive filtering, no interlace
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+    write_chunk("IHDR", header.data(), header.size());
+    // zlib header: deflate with a 32 KB window, no preset dictionary
+    static const std::uint8_t zlib_header[2] = {0x78, 0x01};
+    write_chunk("IDAT", zlib_header, sizeof(zlib_header));
+}
+
+PngWriter::~PngWriter()
+{
+    for (std::future<EncodedBand>& band_future : pending) {
+        band_future.wait();
+    }
+}
+
+void PngWriter::write_rows(const std::uint32_t* rows, const int num_rows, const std::size_t stride)
+{
+    check_rows(rows_written, num_rows, height);
+    for (int y = 0; y < num_rows; y++) {
+        const std::uint32_t* row = rows + (y * stride);
+        band.insert(band.end(), row, row + width);
+        band_rows++;
+        if (band_rows == rows_per_band) {
+            submit_band();
+        }
+    }
+    rows_written += num_rows;
+}
+
+void PngWriter::submit_band()
+{
+    // With one thread, bands are encoded when they are written out
+    const std::launch policy = max_pending > 1 ? std::launch::async : std::launch::deferred;
+    std::vector<std::uint32_t> next_band(band.end() - width, band.end());
+    next_band.reserve(static_cast<std::size_t>(rows_per_band + 1) * width);
+    pending.push_back(std::async(policy, [pixels = std::move(band), width = width, num_rows = band_rows]() {
+        EncodedBand encoded;
+        encoded.chunk = encode_png_band(pixels, width, num_rows, encoded.adler, encoded.size);
+        return encoded;
+    }));
+    band = std::move(next_band);
+    band_rows = 0;
+    while (pending.size() >= max_pending) {
+        write_band(pending.front().get());
+        pending.pop_front();
+    }
+}
+
+void PngWriter::write_band(EncodedBand encoded)
+{
+    adler = adler32_combine(adler, encoded.adler, encoded.size);
+    file.write(reinterpret_cast<const char*>(encoded.chunk.data()), encoded.chunk.size());
+    if (file.fail()) {
+        throw std::runtime_error("Unable to write \"" + file_path + "\".");
+    }
+}
+
+void PngWriter::write_chunk(const char* type, const std::uint8_t* data, const std::size_t size)
+{
+    std::vector<std::uint8_t> chunk;
+    put_u32_be(chunk, static_cast<std::uint32_t>(size));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data, data + size);
+    put_u32_be(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+    file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+    if (file.fail()) {
+        throw std::runtime_error("Unable to write \"" + file_path + "\".");
+    }
+}
+
+void PngWriter::finish()
+{
+    if (rows_written != height) {
+        throw std::runtime_error("Unable to finish \"" + file_path + "\": rows missing.");
+    }
+    if (band_rows > 0) {
+        submit_band();
+    }
+    while (!pending.empty()) {
+        write_band(pending.front().get());
+        pending.pop_front();
+    }
+    std::vector<std::uint8_t> trailer(DEFLATE_FINAL_BLOCK.begin(), DEFLATE_FINAL_BLOCK.end());
+    put_u32_be(trailer, adler);
+    write_chunk("IDAT", trailer.data(), trailer.size());
+    write_chunk("IEND", nullptr, 0);
+    file.close();
+    if (file.fail()) {
+        throw std::runtime_error("Unable to write \"" + file_path + "\".");
+    }
+}
+
+void write_qoi(const std::string& file_path, const std::vector<std::uint32_t>& pixels)
+{
+    if (pixels.size() < static_cast<std::size_t>(NUM_PIXELS)) {
+        throw std::out_of_range("write_qoi: frame smaller than the screen");
+    }
+    QoiWriter writer(file_path, SCREEN_WIDTH, SCREEN_HEIGHT);
+    writer.write_rows(pixels.data(), SCREEN_HEIGHT, SCREEN_WIDTH);
+    writer.finish();
+}
+
+void write_png(const std::string& file_path, const std::vector<std::uint32_t>& pixels)
+{
+    if (pixels.size() < static_cast<std::size_t>(NUM_PIXELS)) {
+        throw std::out_of_range("write_png: frame smaller than the screen");
+    }
+    PngWriter writer(file_path, SCREEN_WIDTH, SCREEN_HEIGHT);
+    writer.write_rows(pixels.data(), SCREEN_HEIGHT, SCREEN_WIDTH);
+    writer.finish();
+}
+
+template <typename Writer>
+static void write_canvas(Writer& writer, const TiledCanvas& canvas)
+{
+    std::vector<std::uint32_t> rows(static_cast<std::size_t>(canvas.get_width()) * TiledCanvas::TILE_SIZE);
+    for (int y = 0; y < canvas.get_height(); y += TiledCanvas::TILE_SIZE) {
+        const int num_rows = std::min(TiledCanvas::TILE_SIZE, canvas.get_height() - y);
+        canvas.read_rows(rows.data(), y, num_rows);
+        writer.write_rows(rows.data(), num_rows, canvas.get_width());
+    }
+    writer.finish();
+}
+
+void write_qoi(const std::string& file_path, const TiledCanvas& canvas)
+{
+    QoiWriter writer(file_path, canvas.get_width(), canvas.get_height());
+    write_canvas(writer, canvas);
+}
+
+void write_png(const std::string& file_path, const TiledCanvas& canvas)
+{
+    PngWriter writer(file_path, canvas.get_width(), canvas.get_height());
+    write_canvas(writer, canvas);
+}
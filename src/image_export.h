@@ -0,0 +1,97 @@
+#ifndef IMAGE_EXPORT_H
+#define IMAGE_EXPORT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <string>
+#include <vector>
+
+class TiledCanvas;
+
+// Image files are written as opaque 24-bit RGB. The alpha byte of the
+// ARGB pixels is ignored, since blank has alpha 0 but is drawn as white.
+//
+// The writers take rows as they become available, so an image never
+// has to be in memory as a whole. Rows are given in order, `stride`
+// pixels apart, and every writer must be finished once all rows are
+// in; finish() throws std::runtime_error if any are missing.
+
+// QOI ("Quite OK Image") encoder. The format is sequential, so rows
+// are encoded as they arrive, on the calling thread.
+class QoiWriter {
+public:
+    QoiWriter(const std::string& file_path, const int width, const int height);
+
+    void write_rows(const std::uint32_t* rows, const int num_rows, const std::size_t stride);
+    void finish();
+
+private:
+    std::string file_path;
+    std::ofstream file;
+    int width;
+    int height;
+    int rows_written;
+    std::array<std::uint32_t, 64> index;
+    std::uint32_t previous;
+    int run;
+    std::vector<std::uint8_t> buffer;
+
+    void flush_buffer();
+};
+
+// PNG encoder. Rows are cut into bands that are filtered and deflated
+// on up to num_threads threads at once (0: one per hardware thread).
+// Each band is a self-contained piece of the zlib stream, written out
+// in order as soon as it and the bands before it are done.
+class PngWriter {
+public:
+    PngWriter(const std::string& file_path, const int width, const int height, const int num_threads = 0);
+    // Waits for bands still being encoded; the file is left incomplete
+    // unless finish() was called
+    ~PngWriter();
+
+    PngWriter(const PngWriter&) = delete;
+    PngWriter& operator=(const PngWriter&) = delete;
+
+    void write_rows(const std::uint32_t* rows, const int num_rows, const std::size_t stride);
+    void finish();
+
+private:
+    // IDAT chunk holding one compressed band
+    struct EncodedBand {
+        std::vector<std::uint8_t> chunk;
+        std::uint32_t adler;
+        std::size_t size;
+    };
+
+    std::string file_path;
+    std::ofstream file;
+    int width;
+    int height;
+    int rows_written;
+    int rows_per_band;
+    std::size_t max_pending;
+    // Last row of the previous band, then the rows of this one
+    std::vector<std::uint32_t> band;
+    int band_rows;
+    std::deque<std::future<EncodedBand>> pending;
+    std::uint32_t adler;
+
+    void submit_band();
+    void write_band(EncodedBand encoded);
+    void write_chunk(const char* type, const std::uint8_t* data, const std::size_t size);
+};
+
+// Screen-sized frames
+void write_qoi(const std::string& file_path, const std::vector<std::uint32_t>& pixels);
+void write_png(const std::string& file_path, const std::vector<std::uint32_t>& pixels);
+
+// A whole canvas, read one row of tiles at a time
+void write_qoi(const std::string& file_path, const TiledCanvas& canvas);
+void write_png(const std::string& file_path, const TiledCanvas& canvas);
+
+#endif
@@ -0,0 +1,151 @@
+#include "instrument.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <mutex>
+#include <vector>
+
+static const std::array<const char*, static_cast<std::size_t>(InstrumentedPrimitive::count)> primitive_names = {
+    "line_dda",
+    "line_bresenham",
+    "line_zingl",
+    "line_run_slice",
+    "circle",
+    "bezier_quad",
+    "bezier_cubic",
+    "stroke",
+    "path",
+    "svg",
+    "bounding_rect",
+    "scanline_fill",
+    "flood_fill"
+};
+
+#ifdef DRAW2D_INSTRUMENT
+
+static void add_counters(InstrumentCounters& total, const InstrumentCounters& counters)
+{
+    for (std::size_t i = 0; i < total.size(); i++) {
+        total[i].calls += counters[i].calls;
+        total[i].pixels += counters[i].pixels;
+        total[i].clipped += counters[i].clipped;
+        total[i].segments += counters[i].segments;
+        total[i].sub_steps += counters[i].sub_steps;
+        total[i].stack_pushes += counters[i].stack_pushes;
+        total[i].bytes_scanned += counters[i].bytes_scanned;
+        total[i].time_ns += counters[i].time_ns;
+    }
+}
+
+// Registry of the live threads' counter blocks,
+// plus the totals of threads that have exited
+struct InstrumentRegistry {
+    std::mutex mutex;
+    std::vector<InstrumentCounters*> live;
+    InstrumentCounters retired{};
+};
+
+static InstrumentRegistry& get_registry()
+{
+    // Never destroyed, so threads exiting during shutdown can still retire
+    static InstrumentRegistry* registry = new InstrumentRegistry();
+    return *registry;
+}
+
+class ThreadCounters {
+public:
+    InstrumentCounters counters{};
+
+    ThreadCounters()
+    {
+        InstrumentRegistry& registry = get_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.live.push_back(&counters);
+    }
+
+    ~ThreadCounters()
+    {
+        InstrumentRegistry& registry = get_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        add_counters(registry.retired, counters);
+        registry.live.erase(std::find(registry.live.begin(), registry.live.end(), &counters));
+    }
+};
+
+InstrumentCounters& get_thread_counters()
+{
+    thread_local ThreadCounters thread_counters;
+    return thread_counters.counters;
+}
+
+InstrumentedPrimitive& get_thread_scope()
+{
+    thread_local InstrumentedPrimitive scope = InstrumentedPrimitive::count;
+    return scope;
+}
+
+InstrumentCounters get_instrument_counters()
+{
+    InstrumentRegistry& registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    InstrumentCounters total = registry.retired;
+    for (const InstrumentCounters* counters : registry.live) {
+        add_counters(total, *counters);
+    }
+    return total;
+}
+
+void reset_instrument_counters()
+{
+    InstrumentRegistry& registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.retired = {};
+    for (InstrumentCounters* counters : registry.live) {
+        *counters = {};
+    }
+}
+
+#else
+
+InstrumentCounters get_instrument_counters()
+{
+    return {};
+}
+
+void reset_instrument_counters()
+{
+}
+
+#endif
+
+void write_instrument_json(std::ostream& os)
+{
+    const InstrumentCounters total = get_instrument_counters();
+    os << "{\n";
+    os << "  \"enabled\": " << (is_instrumentation_enabled() ? "true" : "false") << ",\n";
+    os << "  \"primitives\": {";
+    for (std::size_t i = 0; i < total.size(); i++) {
+        const PrimitiveCounters& c = total[i];
+        os << (i == 0 ? "\n" : ",\n");
+        os << "    \"" << primitive_names[i] << "\": {"
+           << "\"calls\": " << c.calls
+           << ", \"pixels\": " << c.pixels
+           << ", \"clipped\": " << c.clipped
+           << ", \"segments\": " << c.segments
+           << ", \"sub_steps\": " << c.sub_steps
+           << ", \"stack_pushes\": " << c.stack_pushes
+           << ", \"bytes_scanned\": " << c.bytes_scanned
+           << ", \"time_ns\": " << c.time_ns
+           << "}";
+    }
+    os << "\n  }\n}\n";
+}
+
+void write_instrument_json(const std::string& file_path)
+{
+    std::ofstream json_file(file_path);
+    if (!json_file.is_open()) {
+        throw std::runtime_error("Unable to open \"" + file_path + "\".");
+    }
+    write_instrument_json(json_file);
+}
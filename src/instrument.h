@@ -0,0 +1,127 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Per-primitive counters, enabled by building with -DDRAW2D_INSTRUMENT
+// (make INSTRUMENT=1). When disabled, the macros below expand to nothing.
+// Each thread counts into its own thread-local block; blocks are summed
+// when a snapshot is taken, and folded into a global total on thread exit.
+// A count is only kept while the innermost InstrumentScope open on the
+// thread is for the same primitive; RowExecutor bands run under the
+// scope of the thread that started them. The rasterizer templates are
+// shared, so this attributes their counts to the public draw call in
+// progress: a run-slice line handing its axis lines to the Bresenham
+// loop, or a Bezier drawing its straight tail, counts once under its own
+// name, and rasterizing done for a Scene, stamp cache or mask counts
+// under none.
+
+enum class InstrumentedPrimitive : std::size_t {
+    line_dda,
+    line_bresenham,
+    line_zingl,
+    line_run_slice,
+    circle,
+    bezier_quad,
+    bezier_cubic,
+    stroke,
+    path,
+    svg,
+    bounding_rect,
+    scanline_fill,
+    flood_fill,
+    count
+};
+
+struct PrimitiveCounters {
+    std::uint64_t calls;
+    std::uint64_t pixels;
+    // Primitives clipped to, or rejected by, the frame bounds
+    std::uint64_t clipped;
+    // Monotonic Bezier segments drawn after subdivision
+    std::uint64_t segments;
+    // Sub-steps of the cubic Bezier segment stepper
+    std::uint64_t sub_steps;
+    std::uint64_t stack_pushes;
+    std::uint64_t bytes_scanned;
+    std::uint64_t time_ns;
+};
+
+using InstrumentCounters = std::array<PrimitiveCounters, static_cast<std::size_t>(InstrumentedPrimitive::count)>;
+
+#ifdef DRAW2D_INSTRUMENT
+
+#include <chrono>
+
+InstrumentCounters& get_thread_counters();
+// Primitive of the innermost scope open on the thread,
+// InstrumentedPrimitive::count when there is none
+InstrumentedPrimitive& get_thread_scope();
+
+// Counts a call and its steady-clock duration for the enclosing scope
+class InstrumentScope {
+public:
+    explicit InstrumentScope(const InstrumentedPrimitive primitive)
+        : counters(get_thread_counters()[static_cast<std::size_t>(primitive)]),
+          outer(get_thread_scope()),
+          time_start(std::chrono::steady_clock::now())
+    {
+        counters.calls++;
+        get_thread_scope() = primitive;
+    }
+
+    ~InstrumentScope()
+    {
+        const auto time_end = std::chrono::steady_clock::now();
+        counters.time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(time_end - time_start).count();
+        get_thread_scope() = outer;
+    }
+
+    InstrumentScope(const InstrumentScope&) = delete;
+    InstrumentScope& operator=(const InstrumentScope&) = delete;
+
+private:
+    PrimitiveCounters& counters;
+    const InstrumentedPrimitive outer;
+    const std::chrono::steady_clock::time_point time_start;
+};
+
+#define INSTRUMENT_SCOPE(primitive) \
+    const InstrumentScope instrument_scope(InstrumentedPrimitive::primitive)
+#define INSTRUMENT_ADD(primitive, counter, n) \
+    do { \
+        if (get_thread_scope() == InstrumentedPrimitive::primitive) { \
+            get_thread_counters()[static_cast<std::size_t>(InstrumentedPrimitive::primitive)].counter += (n); \
+        } \
+    } while (false)
+
+#else
+
+#define INSTRUMENT_SCOPE(primitive) static_cast<void>(0)
+#define INSTRUMENT_ADD(primitive, counter, n) static_cast<void>(0)
+
+#endif
+
+constexpr bool is_instrumentation_enabled()
+{
+#ifdef DRAW2D_INSTRUMENT
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Sum of the counters of all threads, live and exited.
+// All zero when instrumentation is disabled.
+InstrumentCounters get_instrument_counters();
+
+void reset_instrument_counters();
+
+void write_instrument_json(std::ostream& os);
+void write_instrument_json(const std::string& file_path);
+
+#endif
@@ -0,0 +1,442 @@
+#include "kernels.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DRAW2D_X86 1
+#include <immintrin.h>
+#endif
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+
+static const std::array<std::string, 4> isa_level_names = {"scalar", "sse2", "avx2", "avx512"};
+
+// Scalar versions; also used for the tails of the vector versions
+
+// Alpha of a color from 0 to 256, so that blending an opaque color
+// writes it exactly and the division by 255 is a shift
+static std::uint32_t get_blend_alpha(const std::uint32_t color)
+{
+    return (color >> 24) + (color >> 31);
+}
+
+static std::uint32_t blend_pixel(const std::uint32_t dst, const std::uint32_t color)
+{
+    // Red and blue, then alpha and green, two channels per multiply
+    const std::uint32_t alpha = get_blend_alpha(color);
+    const std::uint32_t inv_alpha = 256 - alpha;
+    const std::uint32_t rb = (((color & 0x00FF00FF) * alpha) + ((dst & 0x00FF00FF) * inv_alpha)) >> 8;
+    const std::uint32_t ag = ((((color >> 8) & 0x00FF00FF) * alpha) + (((dst >> 8) & 0x00FF00FF) * inv_alpha)) >> 8;
+    return (rb & 0x00FF00FF) | ((ag & 0x00FF00FF) << 8) | 0xFF000000;
+}
+
+static void fill_u32_scalar(std::uint32_t* dst, const std::size_t n, const std::uint32_t value)
+{
+    std::fill(dst, dst + n, value);
+}
+
+static void blend_u32_scalar(std::uint32_t* dst, const std::size_t n, const std::uint32_t color)
+{
+    for (std::size_t i = 0; i < n; i++) {
+        dst[i] = blend_pixel(dst[i], color);
+    }
+}
+
+static void expand_bits_u32_scalar(std::uint32_t* dst, const std::uint64_t* bits, const std::size_t num_words, const std::uint32_t color)
+{
+    for (std::size_t w = 0; w < num_words; w++) {
+        std::uint64_t word = bits[w];
+        while (word != 0) {
+            dst[(w * 64) + __builtin_ctzll(word)] = color;
+            word &= word - 1;
+        }
+    }
+}
+
+static std::size_t find_u32_scalar(const std::uint32_t* src, const std::size_t n, const std::uint32_t value)
+{
+    return std::find(src, src + n, value) - src;
+}
+
+static std::size_t find_last_u32_scalar(const std::uint32_t* src, const std::size_t n, const std::uint32_t value)
+{
+    for (std::size_t i = n; i > 0; i--) {
+        if (src[i - 1] == value) {
+            return i - 1;
+        }
+    }
+    return n;
+}
+
+static std::size_t mismatch_u32_scalar(const std::uint32_t* a, const std::uint32_t* b, const std::size_t n)
+{
+    return std::mismatch(a, a + n, b).first - a;
+}
+
+#ifdef DRAW2D_X86
+
+// SSE2: 4 pixels per vector
+
+TARGET_SSE2 static void fill_u32_sse2(std::uint32_t* dst, const std::size_t n, const std::uint32_t value)
+{
+    const __m128i v = _mm_set1_epi32(value);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+    for (; i < n; i++) {
+        dst[i] = value;
+    }
+}
+
+TARGET_SSE2 static void blend_u32_sse2(std::uint32_t* dst, const std::size_t n, const std::uint32_t color)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi16(static_cast<short>(get_blend_alpha(color)));
+    const __m128i inv_alpha = _mm_set1_epi16(static_cast<short>(256 - get_blend_alpha(color)));
+    const __m128i src = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_set1_epi32(color), zero), alpha);
+    const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xFF000000));
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        const __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv_alpha), src), 8);
+        const __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv_alpha), src), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(_mm_packus_epi16(lo, hi), opaque));
+    }
+    blend_u32_scalar(dst + i, n - i, color);
+}
+
+TARGET_SSE2 static void expand_bits_u32_sse2(std::uint32_t* dst, const std::uint64_t* bits, const std::size_t num_words, const std::uint32_t color)
+{
+    const __m128i v = _mm_set1_epi32(color);
+    for (std::size_t w = 0; w < num_words; w++) {
+        const std::uint64_t word = bits[w];
+        if (word == 0) {
+            continue;
+        }
+        std::uint32_t* out = dst + (w * 64);
+        for (int i = 0; i < 64; i += 4) {
+            const unsigned int nibble = (word >> i) & 0xF;
+            if (nibble == 0xF) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), v);
+            } else if (nibble != 0) {
+                for (int b = 0; b < 4; b++) {
+                    if ((nibble >> b) & 1) {
+                        out[i + b] = color;
+                    }
+                }
+            }
+        }
+    }
+}
+
+TARGET_SSE2 static std::size_t find_u32_sse2(const std::uint32_t* src, const std::size_t n, const std::uint32_t value)
+{
+    const __m128i v = _mm_set1_epi32(value);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), v);
+        const int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + find_u32_scalar(src + i, n - i, value);
+}
+
+TARGET_SSE2 static std::size_t find_last_u32_sse2(const std::uint32_t* src, const std::size_t n, const std::uint32_t value)
+{
+    const __m128i v = _mm_set1_epi32(value);
+    std::size_t i = n;
+    for (; i >= 4; i -= 4) {
+        const __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i - 4)), v);
+        const int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+        if (mask != 0) {
+            return i - 4 + (31 - __builtin_clz(mask));
+        }
+    }
+    const std::size_t found = find_last_u32_scalar(src, i, value);
+    return found == i ? n : found;
+}
+
+TARGET_SSE2 static std::size_t mismatch_u32_sse2(const std::uint32_t* a, const std::uint32_t* b, const std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        const int mask = _mm_movemask_ps(_mm_castsi128_ps(eq)) ^ 0xF;
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + mismatch_u32_scalar(a + i, b + i, n - i);
+}
+
+// AVX2: 8 pixels per vector
+
+TARGET_AVX2 static void fill_u32_avx2(std::uint32_t* dst, const std::size_t n, const std::uint32_t value)
+{
+    const __m256i v = _mm256_set1_epi32(value);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+    }
+    for (; i < n; i++) {
+        dst[i] = value;
+    }
+}
+
+TARGET_AVX2 static void blend_u32_avx2(std::uint32_t* dst, const std::size_t n, const std::uint32_t color)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha = _mm256_set1_epi16(static_cast<short>(get_blend_alpha(color)));
+    const __m256i inv_alpha = _mm256_set1_epi16(static_cast<short>(256 - get_blend_alpha(color)));
+    const __m256i src = _mm256_mullo_epi16(_mm256_unpacklo_epi8(_mm256_set1_epi32(color), zero), alpha);
+    const __m256i opaque = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        const __m256i lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inv_alpha), src), 8);
+        const __m256i hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inv_alpha), src), 8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(_mm256_packus_epi16(lo, hi), opaque));
+    }
+    blend_u32_scalar(dst + i, n - i, color);
+}
+
+TARGET_AVX2 static void expand_bits_u32_avx2(std::uint32_t* dst, const std::uint64_t* bits, const std::size_t num_words, const std::uint32_t color)
+{
+    const __m256i v = _mm256_set1_epi32(color);
+    const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    for (std::size_t w = 0; w < num_words; w++) {
+        const std::uint64_t word = bits[w];
+        if (word == 0) {
+            continue;
+        }
+        std::uint32_t* out = dst + (w * 64);
+        for (int i = 0; i < 64; i += 8) {
+            const int byte = (word >> i) & 0xFF;
+            if (byte == 0xFF) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+            } else if (byte != 0) {
+                const __m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(byte), lane_bits), lane_bits);
+                _mm256_maskstore_epi32(reinterpret_cast<int*>(out + i), mask, v);
+            }
+        }
+    }
+}
+
+TARGET_AVX2 static std::size_t find_u32_avx2(const std::uint32_t* src, const std::size_t n, const std::uint32_t value)
+{
+    const __m256i v = _mm256_set1_epi32(value);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)), v);
+        const int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + find_u32_scalar(src + i, n - i, value);
+}
+
+TARGET_AVX2 static std::size_t find_last_u32_avx2(const std::uint32_t* src, const std::size_t n, const std::uint32_t value)
+{
+    const __m256i v = _mm256_set1_epi32(value);
+    std::size_t i = n;
+    for (; i >= 8; i -= 8) {
+        const __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i - 8)), v);
+        const int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        if (mask != 0) {
+            return i - 8 + (31 - __builtin_clz(mask));
+        }
+    }
+    const std::size_t found = find_last_u32_scalar(src, i, value);
+    return found == i ? n : found;
+}
+
+TARGET_AVX2 static std::size_t mismatch_u32_avx2(const std::uint32_t* a, const std::uint32_t* b, const std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        const int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq)) ^ 0xFF;
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + mismatch_u32_scalar(a + i, b + i, n - i);
+}
+
+// AVX-512: 16 pixels per vector, with masked loads and stores for the tails
+
+TARGET_AVX512 static void fill_u32_avx512(std::uint32_t* dst, const std::size_t n, const std::uint32_t value)
+{
+    const __m512i v = _mm512_set1_epi32(value);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_si512(dst + i, v);
+    }
+    if (i < n) {
+        _mm512_mask_storeu_epi32(dst + i, static_cast<__mmask16>((1u << (n - i)) - 1), v);
+    }
+}
+
+TARGET_AVX512 static void blend_u32_avx512(std::uint32_t* dst, const std::size_t n, const std::uint32_t color)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i alpha = _mm512_set1_epi16(static_cast<short>(get_blend_alpha(color)));
+    const __m512i inv_alpha = _mm512_set1_epi16(static_cast<short>(256 - get_blend_alpha(color)));
+    const __m512i src = _mm512_mullo_epi16(_mm512_unpacklo_epi8(_mm512_set1_epi32(color), zero), alpha);
+    const __m512i opaque = _mm512_set1_epi32(static_cast<int>(0xFF000000));
+    for (std::size_t i = 0; i < n; i += 16) {
+        const __mmask16 k = n - i >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1);
+        const __m512i d = _mm512_maskz_loadu_epi32(k, dst + i);
+        const __m512i lo = _mm512_srli_epi16(_mm512_add_epi16(_mm512_mullo_epi16(_mm512_unpacklo_epi8(d, zero), inv_alpha), src), 8);
+        const __m512i hi = _mm512_srli_epi16(_mm512_add_epi16(_mm512_mullo_epi16(_mm512_unpackhi_epi8(d, zero), inv_alpha), src), 8);
+        _mm512_mask_storeu_epi32(dst + i, k, _mm512_or_si512(_mm512_packus_epi16(lo, hi), opaque));
+    }
+}
+
+TARGET_AVX512 static void expand_bits_u32_avx512(std::uint32_t* dst, const std::uint64_t* bits, const std::size_t num_words, const std::uint32_t color)
+{
+    const __m512i v = _mm512_set1_epi32(color);
+    for (std::size_t w = 0; w < num_words; w++) {
+        const std::uint64_t word = bits[w];
+        if (word == 0) {
+            continue;
+        }
+        std::uint32_t* out = dst + (w * 64);
+        for (int i = 0; i < 64; i += 16) {
+            // The bits are the store mask
+            const __mmask16 k = static_cast<__mmask16>(word >> i);
+            if (k != 0) {
+                _mm512_mask_storeu_epi32(out + i, k, v);
+            }
+        }
+    }
+}
+
+TARGET_AVX512 static std::size_t find_u32_avx512(const std::uint32_t* src, const std::size_t n, const std::uint32_t value)
+{
+    const __m512i v = _mm512_set1_epi32(value);
+    for (std::size_t i = 0; i < n; i += 16) {
+        const __mmask16 k = n - i >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1);
+        const __mmask16 eq = _mm512_mask_cmpeq_epi32_mask(k, _mm512_maskz_loadu_epi32(k, src + i), v);
+        if (eq != 0) {
+            return i + __builtin_ctz(eq);
+        }
+    }
+    return n;
+}
+
+TARGET_AVX512 static std::size_t find_last_u32_avx512(const std::uint32_t* src, const std::size_t n, const std::uint32_t value)
+{
+    const __m512i v = _mm512_set1_epi32(value);
+    std::size_t i = n;
+    for (; i >= 16; i -= 16) {
+        const __mmask16 eq = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(src + i - 16), v);
+        if (eq != 0) {
+            return i - 16 + (31 - __builtin_clz(eq));
+        }
+    }
+    if (i > 0) {
+        const __mmask16 k = static_cast<__mmask16>((1u << i) - 1);
+        const __mmask16 eq = _mm512_mask_cmpeq_epi32_mask(k, _mm512_maskz_loadu_epi32(k, src), v);
+        if (eq != 0) {
+            return 31 - __builtin_clz(eq);
+        }
+    }
+    return n;
+}
+
+TARGET_AVX512 static std::size_t mismatch_u32_avx512(const std::uint32_t* a, const std::uint32_t* b, const std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i += 16) {
+        const __mmask16 k = n - i >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1);
+        const __mmask16 ne = _mm512_mask_cmpneq_epi32_mask(k, _mm512_maskz_loadu_epi32(k, a + i), _mm512_maskz_loadu_epi32(k, b + i));
+        if (ne != 0) {
+            return i + __builtin_ctz(ne);
+        }
+    }
+    return n;
+}
+
+#endif
+
+static const std::array<Kernels, 4> kernel_tables = {{
+    {fill_u32_scalar, blend_u32_scalar, expand_bits_u32_scalar, find_u32_scalar, find_last_u32_scalar, mismatch_u32_scalar},
+#ifdef DRAW2D_X86
+    {fill_u32_sse2, blend_u32_sse2, expand_bits_u32_sse2, find_u32_sse2, find_last_u32_sse2, mismatch_u32_sse2},
+    {fill_u32_avx2, blend_u32_avx2, expand_bits_u32_avx2, find_u32_avx2, find_last_u32_avx2, mismatch_u32_avx2},
+    {fill_u32_avx512, blend_u32_avx512, expand_bits_u32_avx512, find_u32_avx512, find_last_u32_avx512, mismatch_u32_avx512}
+#else
+    {fill_u32_scalar, blend_u32_scalar, expand_bits_u32_scalar, find_u32_scalar, find_last_u32_scalar, mismatch_u32_scalar},
+    {fill_u32_scalar, blend_u32_scalar, expand_bits_u32_scalar, find_u32_scalar, find_last_u32_scalar, mismatch_u32_scalar},
+    {fill_u32_scalar, blend_u32_scalar, expand_bits_u32_scalar, find_u32_scalar, find_last_u32_scalar, mismatch_u32_scalar}
+#endif
+}};
+
+IsaLevel get_supported_isa_level()
+{
+#ifdef DRAW2D_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        return IsaLevel::avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return IsaLevel::avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return IsaLevel::sse2;
+    }
+#endif
+    return IsaLevel::scalar;
+}
+
+static IsaLevel select_isa_level()
+{
+    const IsaLevel supported = get_supported_isa_level();
+    const char* forced = std::getenv("DRAW2D_ISA");
+    if (forced == nullptr) {
+        return supported;
+    }
+    const auto name = std::find(isa_level_names.begin(), isa_level_names.end(), forced);
+    if (name == isa_level_names.end()) {
+        std::cerr << "DRAW2D_ISA: unknown level \"" << forced << "\", using " << get_isa_level_name(supported) << std::endl;
+        return supported;
+    }
+    const IsaLevel level = static_cast<IsaLevel>(name - isa_level_names.begin());
+    if (level > supported) {
+        std::cerr << "DRAW2D_ISA: " << forced << " is not supported by this CPU, using " << get_isa_level_name(supported) << std::endl;
+        return supported;
+    }
+    return level;
+}
+
+IsaLevel get_isa_level()
+{
+    static const IsaLevel level = select_isa_level();
+    return level;
+}
+
+const Kernels& get_kernels()
+{
+    static const Kernels& kernels = get_kernels(get_isa_level());
+    return kernels;
+}
+
+const Kernels& get_kernels(const IsaLevel level)
+{
+    return kernel_tables.at(static_cast<std::size_t>(std::min(level, get_supported_isa_level())));
+}
+
+std::string get_isa_level_name(const IsaLevel level)
+{
+    return isa_level_names.at(static_cast<std::size_t>(level));
+}
@@ -0,0 +1,44 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Hot pixel kernels, compiled for several x86 ISA levels in one binary.
+// The best level the CPU supports is picked once, on first use.
+// Setting DRAW2D_ISA=scalar|sse2|avx2|avx512 forces a level instead,
+// capped at what the CPU supports. Other architectures use scalar code.
+
+enum class IsaLevel {
+    scalar,
+    sse2,
+    avx2,
+    avx512
+};
+
+struct Kernels {
+    // dst[0, n) = value
+    void (*fill_u32)(std::uint32_t* dst, const std::size_t n, const std::uint32_t value);
+    // Source-over blend of an ARGB color (using its alpha) onto dst[0, n)
+    void (*blend_u32)(std::uint32_t* dst, const std::size_t n, const std::uint32_t color);
+    // dst[i] = color for every set bit i of bits[0, num_words)
+    void (*expand_bits_u32)(std::uint32_t* dst, const std::uint64_t* bits, const std::size_t num_words, const std::uint32_t color);
+    // Index of the first / last element equal to value, or n if none
+    std::size_t (*find_u32)(const std::uint32_t* src, const std::size_t n, const std::uint32_t value);
+    std::size_t (*find_last_u32)(const std::uint32_t* src, const std::size_t n, const std::uint32_t value);
+    // Index of the first element where a and b differ, or n if none
+    std::size_t (*mismatch_u32)(const std::uint32_t* a, const std::uint32_t* b, const std::size_t n);
+};
+
+IsaLevel get_supported_isa_level();
+
+// Level in use: the supported level, or the one forced by DRAW2D_ISA
+IsaLevel get_isa_level();
+
+const Kernels& get_kernels();
+const Kernels& get_kernels(const IsaLevel level);
+
+std::string get_isa_level_name(const IsaLevel level);
+
+#endif
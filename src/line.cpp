@@ -1,6 +1,8 @@
 #include "line.h"
-#include <cmath>
-#include "constants.h"
+#include "line_raster.h"
+#include "pixel_sink.h"
+#include "instrument.h"
+#include "stroke.h"
 
 void draw_line_zingl(
     std::vector<std::uint32_t>& pixels,
@@ -8,32 +10,24 @@ void draw_line_zingl(
     const int ax, const int ay,
     const int bx, const int by)
 {
-    const int dx = std::abs(bx - ax);
-    const int sx = ax < bx ? 1 : -1;
-    const int dy = -std::abs(by - ay);
-    const int sy = ay < by ? 1 : - 1;
-
-    int x = ax;
-    int y = ay;
-    int err = dx + dy;
+    INSTRUMENT_SCOPE(line_zingl);
+    CheckedSink sink(pixels, color);
+    rasterize_line_zingl(sink, ax, ay, bx, by);
+}
 
-    while (true) {
-        pixels.at((y * SCREEN_WIDTH) + x) = color;
-        const int e2 = 2 * err;
-        if (e2 >= dy) {
-            if (x == bx) {
-                break;
-            }
-            err += dy;
-            x += sx;
-        }
-        if (e2 <= dx) {
-            if (y == by) {
-                break;
-            }
-            err += dx;
-            y += sy;
-        }
+void draw_line_zingl_aa(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const int ax, const int ay,
+    const int bx, const int by)
+{
+    INSTRUMENT_SCOPE(line_zingl);
+    if (is_aa_hull_on_screen(std::min(ax, bx), std::min(ay, by), std::max(ax, bx), std::max(ay, by))) {
+        UncheckedCoverageSink sink(pixels, color);
+        rasterize_line_zingl_aa(sink, ax, ay, bx, by);
+    } else {
+        CoverageSink sink(pixels, color);
+        rasterize_line_zingl_aa(sink, ax, ay, bx, by);
     }
 }
 
@@ -43,104 +37,112 @@ void draw_line_bresenham(
     int ax, int ay,
     int bx, int by)
 {
-    if (ax < 0 || bx < 0 || ay < 0 || by < 0 || ax >= SCREEN_WIDTH || bx >= SCREEN_WIDTH || ay >= SCREEN_HEIGHT || by >= SCREEN_HEIGHT) {
-        return;
-    }
-
-    const int dx = bx > ax ? bx - ax : ax - bx;
-    const int dy = by > ay ? by - ay : ay - by;
-
-    if (dx == 0) {
-        // Vertical lines
-        if (ay > by) {
-            std::swap(ay, by);
-        }
-        const int row_end = by * SCREEN_WIDTH;
-        for (int row = ay * SCREEN_WIDTH; row <= row_end; row += SCREEN_WIDTH) {
-            pixels[row + ax] = color;
-        }
-    } else if (dy == 0) {
-        // Horizontal lines
-        if (ax > bx) {
-            std::swap(ax, bx);
-        }
-        const int row = ay * SCREEN_WIDTH;
-        std::fill(pixels.begin() + (row + ax), pixels.begin() + (row + bx + 1), color);
-    } else if (dx == dy) {
-        // Slope = 1: Perfectly diagonal lines
-        if (ax > bx) {
-            std::swap(ax, bx);
-            std::swap(ay, by);
-        }
-        const int srow = ay < by ? SCREEN_WIDTH : -SCREEN_WIDTH;
-        for (int x = ax, row = ay * SCREEN_WIDTH; x <= bx; x++, row += srow) {
-            pixels[row + x] = color;
-        }
-    } else if (dx > dy) {
-        // Slope < 1: Gradual lines
-        if (ax > bx) {
-            std::swap(ax, bx);
-            std::swap(ay, by);
-        }
-        const int srow = ay < by ? SCREEN_WIDTH : -SCREEN_WIDTH;
+    INSTRUMENT_SCOPE(line_bresenham);
+    UncheckedSink sink(pixels, color);
+    rasterize_line_bresenham(sink, ax, ay, bx, by);
+}
 
-        const int two_dy = 2 * dy;
-        const int two_diff_dy_dx = 2 * (dy - dx);
-        int p = two_dy - dx;
+void draw_line_run_slice(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const int ax, const int ay,
+    const int bx, const int by)
+{
+    INSTRUMENT_SCOPE(line_run_slice);
+    UncheckedSink sink(pixels, color);
+    rasterize_line_run_slice(sink, ax, ay, bx, by);
+}
 
-        for (int x = ax, row = ay * SCREEN_WIDTH; x <= bx; x++) {
-            pixels[row + x] = color;
-            const int mask = p >> 31;
-            const int nMask = ~mask;
-            p += (two_dy & mask) + (two_diff_dy_dx & nMask);
-            row += srow & nMask;
-        }
-    } else {
-        // Slope > 1: Steep lines
-        if (ay > by) {
-            std::swap(ax, bx);
-            std::swap(ay, by);
-        }
-        const int sx = ax < bx ? 1 : -1;
-        const int row_end = by * SCREEN_WIDTH;
+void draw_line_dda(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const int ax, const int ay,
+    const int bx, const int by)
+{
+    INSTRUMENT_SCOPE(line_dda);
+    CheckedSink sink(pixels, color);
+    rasterize_line_dda(sink, ax, ay, bx, by);
+}
 
-        const int two_dx = 2 * dx;
-        const int two_diff_dx_dy = 2 * (dx - dy);
-        int p = two_dx - dy;
+void draw_line_subpixel(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const double ax, const double ay,
+    const double bx, const double by)
+{
+    INSTRUMENT_SCOPE(line_dda);
+    UncheckedSink screen(pixels, color);
+    ClipSink<UncheckedSink> sink(screen, 0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1);
+    rasterize_line_fixed(sink, to_fixed(ax), to_fixed(ay), to_fixed(bx), to_fixed(by), false);
+}
 
-        for (int x = ax, row = ay * SCREEN_WIDTH; row <= row_end; row += SCREEN_WIDTH) {
-            pixels[row + x] = color;
-            const int mask = p >> 31;
-            const int nMask = ~mask;
-            p += (two_dx & mask) + (two_diff_dx_dy & nMask);
-            x += sx & nMask;
-        }
+void draw_polyline_subpixel(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const std::vector<PointF>& points)
+{
+    INSTRUMENT_SCOPE(line_dda);
+    UncheckedSink screen(pixels, color);
+    ClipSink<UncheckedSink> sink(screen, 0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1);
+    for (std::size_t i = 0; i < points.size(); i++) {
+        const bool is_last = i + 1 == points.size();
+        const PointF& a = points[i];
+        const PointF& b = is_last ? a : points[i + 1];
+        rasterize_line_fixed(sink, to_fixed(a.x), to_fixed(a.y), to_fixed(b.x), to_fixed(b.y), is_last);
     }
 }
 
-
-void draw_line_dda(
+void draw_line(
     std::vector<std::uint32_t>& pixels,
     const std::uint32_t color,
+    const LineAlgorithm algorithm,
     const int ax, const int ay,
     const int bx, const int by)
 {
-    const int dx = bx - ax;
-    const int dy = by - ay;
-
-    const int abs_dx = std::abs(dx);
-    const int abs_dy = std::abs(dy);
-    const int steps = abs_dx > abs_dy ? abs_dx : abs_dy;
-
-    double x = static_cast<double>(ax);
-    double y = static_cast<double>(ay);
-    const double x_incr = dx / static_cast<double>(steps);
-    const double y_incr = dy / static_cast<double>(steps);
+    switch (algorithm) {
+        case LineAlgorithm::dda:
+            draw_line_dda(pixels, color, ax, ay, bx, by);
+            break;
+        case LineAlgorithm::bresenham:
+            draw_line_bresenham(pixels, color, ax, ay, bx, by);
+            break;
+        case LineAlgorithm::zingl:
+            draw_line_zingl(pixels, color, ax, ay, bx, by);
+            break;
+        case LineAlgorithm::run_slice:
+            draw_line_run_slice(pixels, color, ax, ay, bx, by);
+            break;
+    }
+}
 
-    pixels.at((std::round(y) * SCREEN_WIDTH) + std::round(x)) = color;
-    for (int k = 0; k < steps; k++) {
-        x += x_incr;
-        y += y_incr;
-        pixels.at((std::round(y) * SCREEN_WIDTH) + std::round(x)) = color;
+void draw_line(
+    TiledCanvas& canvas,
+    const std::uint32_t color,
+    const LineAlgorithm algorithm,
+    const int ax, const int ay,
+    const int bx, const int by)
+{
+    TiledCanvasSink sink(canvas, color);
+    switch (algorithm) {
+        case LineAlgorithm::dda: {
+            INSTRUMENT_SCOPE(line_dda);
+            rasterize_line_dda(sink, ax, ay, bx, by);
+            break;
+        }
+        case LineAlgorithm::bresenham: {
+            INSTRUMENT_SCOPE(line_bresenham);
+            rasterize_line_bresenham(sink, ax, ay, bx, by);
+            break;
+        }
+        case LineAlgorithm::zingl: {
+            INSTRUMENT_SCOPE(line_zingl);
+            rasterize_line_zingl(sink, ax, ay, bx, by);
+            break;
+        }
+        case LineAlgorithm::run_slice: {
+            INSTRUMENT_SCOPE(line_run_slice);
+            rasterize_line_run_slice(sink, ax, ay, bx, by);
+            break;
+        }
     }
 }
@@ -4,6 +4,16 @@
 #include <vector>
 #include <cstdint>
 
+class TiledCanvas;
+struct PointF;
+
+enum class LineAlgorithm : std::uint8_t {
+    dda,
+    bresenham,
+    zingl,
+    run_slice
+};
+
 void draw_line_zingl(
     std::vector<std::uint32_t>& pixels,
     const std::uint32_t color,
@@ -11,6 +21,15 @@ void draw_line_zingl(
     const int bx, const int by
 );
 
+// Anti-aliased: blends the color over the pixels by their coverage.
+// Pixels outside the screen are discarded.
+void draw_line_zingl_aa(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const int ax, const int ay,
+    const int bx, const int by
+);
+
 void draw_line_bresenham(
     std::vector<std::uint32_t>& pixels,
     const std::uint32_t color,
@@ -18,6 +37,16 @@ void draw_line_bresenham(
     const int bx, const int by
 );
 
+// Same pixels as draw_line_bresenham, drawn one run at a time
+void draw_line_run_slice(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const int ax, const int ay,
+    const int bx, const int by
+);
+
+// Fixed-point line (see rasterize_line_fixed in line_raster.h) with
+// both endpoints drawn
 void draw_line_dda(
     std::vector<std::uint32_t>& pixels,
     const std::uint32_t color,
@@ -25,4 +54,40 @@ void draw_line_dda(
     const int bx, const int by
 );
 
+// Line between subpixel endpoints, where (x, y) is the center of pixel
+// (x, y). Both endpoints are rounded to the nearest pixel and the end
+// pixel is left out (see rasterize_line_fixed).
+// Pixels off the screen are discarded.
+void draw_line_subpixel(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const double ax, const double ay,
+    const double bx, const double by
+);
+
+// Connected subpixel lines, e.g. flattened curves. Each point shared by
+// two lines is drawn once; the last point is drawn too.
+void draw_polyline_subpixel(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const std::vector<PointF>& points
+);
+
+void draw_line(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const LineAlgorithm algorithm,
+    const int ax, const int ay,
+    const int bx, const int by
+);
+
+// Same as above on a TiledCanvas; pixels off the canvas are discarded
+void draw_line(
+    TiledCanvas& canvas,
+    const std::uint32_t color,
+    const LineAlgorithm algorithm,
+    const int ax, const int ay,
+    const int bx, const int by
+);
+
 #endif
\ No newline at end of file
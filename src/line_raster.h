@@ -0,0 +1,422 @@
+#ifndef LINE_RASTER_H
+#define LINE_RASTER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include "constants.h"
+#include "instrument.h"
+
+// Line rasterizers templated on a pixel sink (see pixel_sink.h).
+// The functions in line.h are instantiations of these.
+
+// Size of the surface a sink draws onto: the screen, unless the sink
+// has get_width() and get_height() of its own
+template <typename Sink>
+auto get_sink_width(const Sink& sink, int) -> decltype(sink.get_width())
+{
+    return sink.get_width();
+}
+
+template <typename Sink>
+int get_sink_width(const Sink&, long)
+{
+    return SCREEN_WIDTH;
+}
+
+template <typename Sink>
+auto get_sink_height(const Sink& sink, int) -> decltype(sink.get_height())
+{
+    return sink.get_height();
+}
+
+template <typename Sink>
+int get_sink_height(const Sink&, long)
+{
+    return SCREEN_HEIGHT;
+}
+
+template <typename Sink>
+void rasterize_line_zingl(
+    Sink& sink,
+    const int ax, const int ay,
+    const int bx, const int by)
+{
+    const int dx = std::abs(bx - ax);
+    const int sx = ax < bx ? 1 : -1;
+    const int dy = -std::abs(by - ay);
+    const int sy = ay < by ? 1 : - 1;
+
+    int x = ax;
+    int y = ay;
+    int err = dx + dy;
+
+    INSTRUMENT_ADD(line_zingl, pixels, std::max(dx, -dy) + 1);
+    while (true) {
+        sink.plot(x, y);
+        const int e2 = 2 * err;
+        if (e2 >= dy) {
+            if (x == bx) {
+                break;
+            }
+            err += dy;
+            x += sx;
+        }
+        if (e2 <= dx) {
+            if (y == by) {
+                break;
+            }
+            err += dx;
+            y += sy;
+        }
+    }
+}
+
+// Coverage of a pixel for the anti-aliased rasterizers, which follow
+// Zingl: error terms grow by scale per pixel of distance from the
+// curve, so an error of d gives 255 on the curve, falling to 0 a pixel
+// or more away. The division by scale is a multiply by a 32-bit
+// fraction of its reciprocal, with large scales and errors shifted down
+// to 24 bits first.
+class AaCoverage {
+public:
+    explicit AaCoverage(const std::int64_t scale)
+        : shift(std::max(40 - __builtin_clzll(static_cast<std::uint64_t>(scale) | 1), 0)),
+          scale(scale >> shift),
+          inverse(((std::int64_t{255} << 32) + this->scale - 1) / this->scale) {}
+
+    std::uint32_t operator()(const std::int64_t d) const
+    {
+        // Clamped rather than branched on, as d is near random
+        const std::int64_t i = (std::clamp(d >> shift, std::int64_t{0}, scale) * inverse) >> 32;
+        return static_cast<std::uint32_t>(255 - std::min(i, std::int64_t{255}));
+    }
+
+private:
+    int shift;
+    std::int64_t scale;
+    std::int64_t inverse;
+};
+
+// Anti-aliased rasterize_line_zingl. The error term over the length of
+// the line is the distance of a pixel from it, so each pixel stepped on
+// is blended by that, and so is the pixel beside it wherever the line
+// passes within a pixel of it. The length is the only root, taken once.
+template <typename Sink>
+void rasterize_line_zingl_aa(
+    Sink& sink,
+    const int ax, const int ay,
+    const int bx, const int by)
+{
+    const int dx = std::abs(bx - ax);
+    const int sx = ax < bx ? 1 : -1;
+    const int dy = std::abs(by - ay);
+    const int sy = ay < by ? 1 : -1;
+    const int ed = dx + dy == 0 ? 1 : static_cast<int>(std::sqrt((static_cast<double>(dx) * dx) + (static_cast<double>(dy) * dy)));
+    const AaCoverage coverage(ed);
+
+    int x = ax;
+    int y = ay;
+    int err = dx - dy;
+
+    INSTRUMENT_ADD(line_zingl, pixels, std::max(dx, dy) + 1);
+    while (true) {
+        sink.blend(x, y, coverage(std::abs(err - dx + dy)));
+        const int e2 = err;
+        const int x2 = x;
+        if (2 * e2 >= -dx) {
+            if (x == bx) {
+                break;
+            }
+            if (e2 + dy < ed) {
+                sink.blend(x, y + sy, coverage(e2 + dy));
+            }
+            err -= dy;
+            x += sx;
+        }
+        if (2 * e2 <= dy) {
+            if (y == by) {
+                break;
+            }
+            if (dx - e2 < ed) {
+                sink.blend(x2 + sx, y, coverage(dx - e2));
+            }
+            err += dx;
+            y += sy;
+        }
+    }
+}
+
+template <typename Sink>
+void rasterize_line_bresenham(
+    Sink& sink,
+    int ax, int ay,
+    int bx, int by)
+{
+    const int width = get_sink_width(sink, 0);
+    const int height = get_sink_height(sink, 0);
+    if (ax < 0 || bx < 0 || ay < 0 || by < 0 || ax >= width || bx >= width || ay >= height || by >= height) {
+        INSTRUMENT_ADD(line_bresenham, clipped, 1);
+        return;
+    }
+
+    const int dx = bx > ax ? bx - ax : ax - bx;
+    const int dy = by > ay ? by - ay : ay - by;
+    INSTRUMENT_ADD(line_bresenham, pixels, std::max(dx, dy) + 1);
+
+    if (dx == 0) {
+        // Vertical lines
+        if (ay > by) {
+            std::swap(ay, by);
+        }
+        for (int y = ay; y <= by; y++) {
+            sink.plot(ax, y);
+        }
+    } else if (dy == 0) {
+        // Horizontal lines
+        if (ax > bx) {
+            std::swap(ax, bx);
+        }
+        sink.span(ax, bx, ay);
+    } else if (dx == dy) {
+        // Slope = 1: Perfectly diagonal lines
+        if (ax > bx) {
+            std::swap(ax, bx);
+            std::swap(ay, by);
+        }
+        const int sy = ay < by ? 1 : -1;
+        for (int x = ax, y = ay; x <= bx; x++, y += sy) {
+            sink.plot(x, y);
+        }
+    } else if (dx > dy) {
+        // Slope < 1: Gradual lines
+        if (ax > bx) {
+            std::swap(ax, bx);
+            std::swap(ay, by);
+        }
+        const int sy = ay < by ? 1 : -1;
+
+        const int two_dy = 2 * dy;
+        const int two_diff_dy_dx = 2 * (dy - dx);
+        int p = two_dy - dx;
+
+        for (int x = ax, y = ay; x <= bx; x++) {
+            sink.plot(x, y);
+            const int mask = p >> 31;
+            const int nMask = ~mask;
+            p += (two_dy & mask) + (two_diff_dy_dx & nMask);
+            y += sy & nMask;
+        }
+    } else {
+        // Slope > 1: Steep lines
+        if (ay > by) {
+            std::swap(ax, bx);
+            std::swap(ay, by);
+        }
+        const int sx = ax < bx ? 1 : -1;
+
+        const int two_dx = 2 * dx;
+        const int two_diff_dx_dy = 2 * (dx - dy);
+        int p = two_dx - dy;
+
+        for (int x = ax, y = ay; y <= by; y++) {
+            sink.plot(x, y);
+            const int mask = p >> 31;
+            const int nMask = ~mask;
+            p += (two_dx & mask) + (two_diff_dx_dy & nMask);
+            x += sx & nMask;
+        }
+    }
+}
+
+// Pixel-identical to rasterize_line_bresenham, but draws each run of
+// pixels on one row (or column, for steep lines) at once. The length of
+// every run is found with a single error-term update: pixel i of a
+// gradual line sits (2*dy*i + dx) / (2*dx) rows from the start, so the
+// run on row k starts at ceil(dx * (2k - 1) / (2*dy)), which is kept
+// as a quotient and remainder and advanced by 2*dx per row.
+template <typename Sink>
+void rasterize_line_run_slice(
+    Sink& sink,
+    int ax, int ay,
+    int bx, int by)
+{
+    const int width = get_sink_width(sink, 0);
+    const int height = get_sink_height(sink, 0);
+    if (ax < 0 || bx < 0 || ay < 0 || by < 0 || ax >= width || bx >= width || ay >= height || by >= height) {
+        INSTRUMENT_ADD(line_run_slice, clipped, 1);
+        return;
+    }
+
+    const int dx = bx > ax ? bx - ax : ax - bx;
+    const int dy = by > ay ? by - ay : ay - by;
+    INSTRUMENT_ADD(line_run_slice, pixels, std::max(dx, dy) + 1);
+
+    if (dx == 0 || dy == 0 || dx == dy) {
+        // Single runs and diagonals have nothing to gain
+        rasterize_line_bresenham(sink, ax, ay, bx, by);
+        return;
+    }
+
+    // Walk along the major axis in increasing order
+    const bool steep = dy > dx;
+    if (steep ? ay > by : ax > bx) {
+        std::swap(ax, bx);
+        std::swap(ay, by);
+    }
+    const int major = steep ? dy : dx;
+    const int minor = steep ? dx : dy;
+    const int start = steep ? ay : ax;
+    const int end = steep ? by : bx;
+    const int step = steep ? (ax < bx ? 1 : -1) : (ay < by ? 1 : -1);
+
+    const long long denominator = 2LL * minor;
+    const long long run_quotient = (2LL * major) / denominator;
+    const long long run_remainder = (2LL * major) % denominator;
+    long long quotient = major / denominator;
+    long long remainder = major % denominator;
+
+    int minor_pos = steep ? ax : ay;
+    int run_start = start;
+    for (int k = 0; k <= minor; k++) {
+        // First pixel of the next run, or one past the end for the last
+        const int run_end = k < minor ? start + static_cast<int>(quotient + (remainder > 0 ? 1 : 0)) : end + 1;
+        if (steep) {
+            for (int y = run_start; y < run_end; y++) {
+                sink.plot(minor_pos, y);
+            }
+        } else {
+            sink.span(run_start, run_end - 1, minor_pos);
+        }
+        run_start = run_end;
+        minor_pos += step;
+        quotient += run_quotient;
+        remainder += run_remainder;
+        if (remainder >= denominator) {
+            remainder -= denominator;
+            quotient++;
+        }
+    }
+}
+
+// Fixed-point coordinates with FIXED_SHIFT fractional bits. Whole
+// values fall on pixel centers: pixel (x, y) is centered on (x, y).
+constexpr int FIXED_SHIFT = 16;
+constexpr std::int64_t FIXED_ONE = std::int64_t{1} << FIXED_SHIFT;
+constexpr std::int64_t FIXED_HALF = FIXED_ONE / 2;
+// Largest coordinate, in pixels, the fixed-point rasterizer accepts,
+// which keeps its error terms within 64 bits
+constexpr std::int64_t FIXED_LIMIT = std::int64_t{1} << 23;
+
+inline std::int64_t to_fixed(const double v)
+{
+    return std::llround(v * FIXED_ONE);
+}
+
+inline std::int64_t to_fixed(const int v)
+{
+    return static_cast<std::int64_t>(v) * FIXED_ONE;
+}
+
+// Floor of a / b for b > 0
+inline std::int64_t floor_div(const std::int64_t a, const std::int64_t b)
+{
+    const std::int64_t q = a / b;
+    return (a % b) < 0 ? q - 1 : q;
+}
+
+// Line between fixed-point endpoints, stepped one pixel at a time along
+// its major axis with integer adds only. Along the major axis pixels run
+// from the start point rounded to the nearest pixel center (halves round
+// up) up to but not including the end point rounded the same way, so
+// (0.3, 0.3) to (5.3, 0.3) draws x = 0..4. This is not the diamond-exit
+// rule, which would draw x = 1..5, but like it lines joined end to start
+// draw their shared pixel once. With include_end, the end
+// pixel is drawn as well, as the integer line functions do. On the
+// minor axis each pixel is the one whose center is nearest the line at
+// the major-axis pixel center.
+//
+// Lines with an endpoint beyond FIXED_LIMIT pixels are not drawn.
+template <typename Sink>
+void rasterize_line_fixed(
+    Sink& sink,
+    const std::int64_t ax, const std::int64_t ay,
+    const std::int64_t bx, const std::int64_t by,
+    const bool include_end)
+{
+    const std::int64_t limit = FIXED_LIMIT * FIXED_ONE;
+    if (std::max({std::abs(ax), std::abs(ay), std::abs(bx), std::abs(by)}) > limit) {
+        INSTRUMENT_ADD(line_dda, clipped, 1);
+        return;
+    }
+
+    const bool x_major = std::abs(bx - ax) >= std::abs(by - ay);
+    const std::int64_t a_major = x_major ? ax : ay;
+    const std::int64_t a_minor = x_major ? ay : ax;
+    const std::int64_t d_major = x_major ? bx - ax : by - ay;
+    const std::int64_t d_minor = x_major ? by - ay : bx - ax;
+
+    // Pixels along the major axis, in the direction of travel
+    const int first = static_cast<int>((a_major + FIXED_HALF) >> FIXED_SHIFT);
+    const int last = static_cast<int>(((a_major + d_major + FIXED_HALF) >> FIXED_SHIFT));
+    const int step = d_major < 0 ? -1 : 1;
+    const int num_pixels = std::abs(last - first) + (include_end ? 1 : 0);
+    if (num_pixels == 0) {
+        return;
+    }
+    INSTRUMENT_ADD(line_dda, pixels, num_pixels);
+    if (d_major == 0) {
+        // Both endpoints on one point
+        sink.plot(first, static_cast<int>((a_minor + FIXED_HALF) >> FIXED_SHIFT));
+        return;
+    }
+
+    // The minor coordinate plus 1/2 at the first pixel center, as a whole
+    // part and a fraction error / denominator in [0, 1). Each pixel moves
+    // it by d_minor / |d_major|, which is at most one.
+    const std::int64_t abs_d_major = std::abs(d_major);
+    const std::int64_t denominator = abs_d_major * FIXED_ONE;
+    const std::int64_t t = (to_fixed(first) - a_major) * step;
+    const std::int64_t minor_whole = (a_minor + FIXED_HALF) >> FIXED_SHIFT;
+    const std::int64_t minor_rest = (a_minor + FIXED_HALF) - (minor_whole * FIXED_ONE);
+    const std::int64_t numerator = (minor_rest * abs_d_major) + (t * d_minor);
+    const std::int64_t carry = floor_div(numerator, denominator);
+    int minor = static_cast<int>(minor_whole + carry);
+    std::int64_t error = numerator - (carry * denominator);
+    const std::int64_t error_step = d_minor * FIXED_ONE;
+
+    // Stop once the line has left the sink along its major axis
+    const int major_size = x_major ? get_sink_width(sink, 0) : get_sink_height(sink, 0);
+    for (int i = 0, major = first; i < num_pixels; i++, major += step) {
+        if ((step > 0 && major >= major_size) || (step < 0 && major < 0)) {
+            break;
+        }
+        if (x_major) {
+            sink.plot(major, minor);
+        } else {
+            sink.plot(minor, major);
+        }
+        error += error_step;
+        if (error >= denominator) {
+            error -= denominator;
+            minor++;
+        } else if (error < 0) {
+            error += denominator;
+            minor--;
+        }
+    }
+}
+
+// Integer line through the fixed-point rasterizer, endpoints included
+template <typename Sink>
+void rasterize_line_dda(
+    Sink& sink,
+    const int ax, const int ay,
+    const int bx, const int by)
+{
+    rasterize_line_fixed(sink, to_fixed(ax), to_fixed(ay), to_fixed(bx), to_fixed(by), true);
+}
+
+#endif
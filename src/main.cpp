@@ -1,24 +1,60 @@
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <chrono>
 #include <functional>
+#include <string>
 #include <vector>
 #include "line.h"
 #include "circle.h"
+#include "display_list.h"
 #include "fill.h"
+#include "frame_stream.h"
+#include "stroke.h"
+#include "stroke_animation.h"
+#include "render_job.h"
+#include "scene.h"
 #include "svg.h"
 #include "graphics.h"
+#include "instrument.h"
 #include "constants.h"
 #include <SDL2/SDL.h>
 
-void run_tests();
-bool wait_for_input();
+void run_tests(const bool vsync, const double target_fps, const std::string& record_path);
+bool wait_for_input(FrameLoop& loop);
+void print_frame_stats(const FrameStats& stats);
 
-int main()
+int main(int argc, char* argv[])
 {
+    // --stats <file>: write the instrumentation counters as JSON on exit
+    // --vsync: pace animation by the display refresh
+    // --fps <n>: target animation frame rate without vsync (default 60)
+    // --record <file>: write the stroke animation as a frame stream
+    std::string stats_path;
+    std::string record_path;
+    bool vsync = false;
+    double target_fps = 60;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--stats" && i + 1 < argc) {
+            stats_path = argv[++i];
+        } else if (arg == "--vsync") {
+            vsync = true;
+        } else if (arg == "--fps" && i + 1 < argc) {
+            target_fps = std::atof(argv[++i]);
+        } else if (arg == "--record" && i + 1 < argc) {
+            record_path = argv[++i];
+        }
+    }
+
     try {
-        run_tests();
+        run_tests(vsync, vsync ? 0 : target_fps, record_path);
+        if (!stats_path.empty()) {
+            write_instrument_json(stats_path);
+        }
     } catch (std::runtime_error& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
@@ -26,24 +62,28 @@ int main()
     return 0;
 }
 
-void run_tests()
+void run_tests(const bool vsync, const double target_fps, const std::string& record_path)
 {
-    Graphics gfx;
+    Graphics gfx(vsync);
+    FrameLoop loop(gfx, target_fps);
 
-    static const std::array<std::function<void(std::vector<std::uint32_t>&, const std::uint32_t, const int, const int, const int, const int)>, 3> drawing_funcs = {
+    static const std::array<std::function<void(std::vector<std::uint32_t>&, const std::uint32_t, const int, const int, const int, const int)>, 4> drawing_funcs = {
         &draw_line_dda,
         &draw_line_bresenham,
-        &draw_line_zingl
+        &draw_line_zingl,
+        &draw_line_run_slice
     };
-    static const std::array<std::string, 3> func_names = {
+    static const std::array<std::string, 4> func_names = {
         "DDA",
         "Bresenham",
-        "Zingl"
+        "Zingl",
+        "Run-slice"
     };
-    static const std::array<std::uint32_t, 3> line_colors = {{
+    static const std::array<std::uint32_t, 4> line_colors = {{
         red,
         green,
-        blue
+        blue,
+        black
     }};
 
     static const std::array<SDL_Point, 7> line_pas = {{
@@ -87,7 +127,7 @@ void run_tests()
             std::cout << us_elapsed.count() << " us\n";
 
             gfx.render();
-            should_exit_early = wait_for_input();
+            should_exit_early = wait_for_input(loop);
             if (should_exit_early) {
                 break;
             }
@@ -104,40 +144,210 @@ void run_tests()
     draw_circle_midpoint(gfx.pixels, black, circle_center.x, circle_center.y, radius);
     flood_fill_stack(gfx.pixels, black, circle_center.x, circle_center.y);
     gfx.render();
-    if (wait_for_input()) {
+    if (wait_for_input(loop)) {
         return;
     }
 
+    std::cout << "STROKE DRAWING FUNCTIONS\n\n";
+    static const std::vector<Point> polyline = {{
+        {200, 800},
+        {500, 300},
+        {800, 800},
+        {1100, 300},
+        {1400, 800},
+        {1700, 300}
+    }};
+    static const std::array<LineJoin, 3> joins = {LineJoin::miter, LineJoin::round, LineJoin::bevel};
+    static const std::array<LineCap, 3> caps = {LineCap::butt, LineCap::round, LineCap::square};
+    for (std::size_t i = 0; i < joins.size(); i++) {
+        StrokeStyle style;
+        style.width = 48;
+        style.join = joins.at(i);
+        style.cap = caps.at(i);
+        const auto time_start = std::chrono::system_clock::now();
+        draw_stroke_polyline(gfx.pixels, line_colors.at(i), polyline, style);
+        const auto time_end = std::chrono::system_clock::now();
+        const auto us_elapsed = std::chrono::duration_cast<std::chrono::microseconds>(time_end - time_start);
+        std::cout << us_elapsed.count() << " us\n";
+        gfx.render();
+        if (wait_for_input(loop)) {
+            return;
+        }
+    }
+    std::cout << "\n";
+
     std::cout << "SVG DRAWING FUNCTION\n\n";
     draw_svg(gfx.pixels, black, "19976.svg");
     gfx.render();
-    wait_for_input();
-}
+    if (wait_for_input(loop)) {
+        return;
+    }
 
-bool wait_for_input()
-{
-    bool should_exit_early = false;
-    bool should_continue = false;
-    SDL_Event event;
-    do {
-        SDL_PollEvent(&event);
-        if (event.type == SDL_QUIT) {
-            should_continue = true;
-            should_exit_early = true;	
-        } else if (event.type == SDL_KEYDOWN) {
-            switch (event.key.keysym.sym) {
-            case SDLK_RETURN:
-            case SDLK_SPACE:
-                should_continue = true;
+    std::cout << "SVG AT TEXT SIZES\n\n";
+    // Small sizes draw simplified outlines, see transform_path_segments
+    {
+        std::vector<std::vector<PathSegment>> glyph;
+        for (const std::string& path : get_paths_from_svg("19976.svg")) {
+            glyph.push_back(parse_path(path));
+        }
+        TransformedPathFill path_fill;
+        const auto time_start = std::chrono::system_clock::now();
+        int y = 40;
+        for (const int size : {16, 24, 32, 48, 96}) {
+            for (int x = 40; x + size < SCREEN_WIDTH - 40; x += size + (size / 4)) {
+                const PathTransform transform = {size / 1024.0f, static_cast<float>(x), static_cast<float>(y)};
+                for (const std::vector<PathSegment>& path : glyph) {
+                    path_fill.fill(gfx.pixels, black, path, transform);
+                }
+            }
+            y += size + (size / 2);
+        }
+        const auto time_end = std::chrono::system_clock::now();
+        const auto us_elapsed = std::chrono::duration_cast<std::chrono::microseconds>(time_end - time_start);
+        std::cout << us_elapsed.count() << " us\n";
+    }
+    gfx.render();
+    if (wait_for_input(loop)) {
+        return;
+    }
+
+    std::cout << "STROKE ANIMATION\n\n";
+    StrokeAnimation animation("19976.svg");
+    // gfx.pixels is cleared on render, so frames build up in their own buffer
+    std::vector<std::uint32_t> frame(NUM_PIXELS, blank);
+    animation.draw_outlines(frame, 0xFFCCCCCC);
+    long long us_drawing = 0;
+    int num_frames = 0;
+    std::unique_ptr<FrameStreamWriter> recorder;
+    if (!record_path.empty()) {
+        recorder = std::make_unique<FrameStreamWriter>(record_path, SCREEN_WIDTH, SCREEN_HEIGHT);
+    }
+    loop.reset_stats();
+    const LoopControl control = loop.run([](const SDL_Event& event) {
+        // Enter and Space do not skip the animation
+        return get_default_control(event) == LoopControl::quit ? LoopControl::quit : LoopControl::keep_running;
+    }, [&](const double t) {
+        const auto time_start = std::chrono::steady_clock::now();
+        animation.render_frame(frame, black, t);
+        const auto time_end = std::chrono::steady_clock::now();
+        us_drawing += std::chrono::duration_cast<std::chrono::microseconds>(time_end - time_start).count();
+        num_frames++;
+        if (recorder) {
+            recorder->write_frame(frame);
+        }
+        gfx.pixels = frame;
+        return t < animation.get_end_time();
+    });
+    // Finished even when quitting, so the frames so far can be read
+    if (recorder) {
+        recorder->finish();
+        std::cout << "Recorded " << recorder->get_num_frames() << " frames in " << recorder->get_bytes_written() << " bytes\n";
+    }
+    if (control == LoopControl::quit) {
+        return;
+    }
+    std::cout << num_frames << " frames, " << us_drawing / num_frames << " us per frame drawing\n";
+    print_frame_stats(loop.get_stats());
+    animation.draw_medians(frame, red);
+    gfx.pixels = frame;
+    gfx.render();
+    if (wait_for_input(loop)) {
+        return;
+    }
+
+    std::cout << "\nPROGRESSIVE RENDERING\n\n";
+    // Far more than one frame's worth of drawing, so it is drawn a slice
+    // per frame while the window keeps handling events
+    DisplayList big_list;
+    for (int k = 0; k < 400000; k++) {
+        const int x = 100 + ((k * 37) % (SCREEN_WIDTH - 200));
+        const int y = 100 + ((k * 61) % (SCREEN_HEIGHT - 200));
+        const std::uint32_t color = line_colors.at(k % line_colors.size());
+        if (k % 2 == 0) {
+            big_list.record_circle(color, x, y, 10 + (k % 80));
+        } else {
+            big_list.record_line(LineAlgorithm::bresenham, color, x, y, 100 + ((k * 31) % (SCREEN_WIDTH - 200)), y);
+        }
+    }
+    big_list.record_svg(black, "19976.svg");
+    std::fill(frame.begin(), frame.end(), blank);
+    RenderJob job(big_list, frame);
+    const RenderBudget slice_budget = {std::chrono::milliseconds(10), 0};
+    int num_slices = 0;
+    loop.reset_stats();
+    const LoopControl control_job = loop.run([](const SDL_Event& event) {
+        return get_default_control(event) == LoopControl::quit ? LoopControl::quit : LoopControl::keep_running;
+    }, [&](const double) {
+        const bool done = job.advance(slice_budget);
+        num_slices++;
+        gfx.pixels = frame;
+        return !done;
+    });
+    if (control_job == LoopControl::quit) {
+        return;
+    }
+    std::cout << big_list.size() << " commands drawn over " << num_slices << " frames\n";
+    print_frame_stats(loop.get_stats());
+    if (wait_for_input(loop)) {
+        return;
+    }
+
+    std::cout << "\nSCENE PICKING (click objects, Enter to finish)\n\n";
+    Scene scene;
+    for (int k = 0; k < 60; k++) {
+        const int x = 100 + ((k % 10) * 170);
+        const int y = 100 + ((k / 10) * 160);
+        switch (k % 3) {
+            case 0:
+                scene.add_line(LineAlgorithm::zingl, black, x, y, x + 120, y + 90);
                 break;
-            case SDLK_ESCAPE:
-                should_continue = true;
-                should_exit_early = true;
+            case 1:
+                scene.add_circle(black, x + 60, y + 50, 45);
                 break;
             default:
+                scene.add_bezier_quad(black, x, y + 100, x + 60, y - 40, x + 120, y + 100);
                 break;
+        }
+    }
+    scene.render(frame);
+    gfx.pixels = frame;
+    gfx.render();
+    loop.reset_stats();
+    const LoopControl control_picking = loop.run([&](const SDL_Event& event) {
+        if (event.type == SDL_MOUSEBUTTONDOWN) {
+            SceneObjectId id;
+            const auto time_start = std::chrono::steady_clock::now();
+            const bool hit = scene.pick(event.button.x, event.button.y, id, 3);
+            const auto time_end = std::chrono::steady_clock::now();
+            const auto us_elapsed = std::chrono::duration_cast<std::chrono::microseconds>(time_end - time_start);
+            if (hit) {
+                // Toggle between black and red
+                scene.set_color(id, scene.get_object(id).color == black ? red : black);
+                scene.render(frame);
+                gfx.pixels = frame;
+                loop.request_redraw();
+                std::cout << "Picked object " << id << " in " << us_elapsed.count() << " us\n";
             }
         }
-    } while (!should_continue);
-    return should_exit_early;
+        return get_default_control(event);
+    });
+    if (control_picking != LoopControl::quit) {
+        print_frame_stats(loop.get_stats());
+    }
+}
+
+bool wait_for_input(FrameLoop& loop)
+{
+    return loop.run(&get_default_control) == LoopControl::quit;
+}
+
+void print_frame_stats(const FrameStats& stats)
+{
+    if (stats.num_frames > 0) {
+        std::cout << stats.num_frames << " frames rendered, " << static_cast<long long>(stats.us_frame_total / stats.num_frames)
+            << " us per frame, " << static_cast<long long>(stats.us_frame_max) << " us max\n";
+    }
+    if (stats.us_total > 0) {
+        std::cout << static_cast<int>(100 * stats.us_idle / stats.us_total) << "% of the time idle\n";
+    }
 }
@@ -0,0 +1,160 @@
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const std::array<std::string, NUM_PERF_EVENTS> perf_event_names = {
+    "cycles",
+    "instructions",
+    "L1d misses",
+    "LLC misses",
+    "branch misses",
+    "dTLB misses"
+};
+
+#ifdef __linux__
+
+static std::uint64_t get_cache_config(const std::uint64_t cache, const std::uint64_t op, const std::uint64_t result)
+{
+    return cache | (op << 8) | (result << 16);
+}
+
+static int open_event(const PerfEvent event)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    switch (event) {
+    case PerfEvent::cycles:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PerfEvent::instructions:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PerfEvent::l1d_misses:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = get_cache_config(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+        break;
+    case PerfEvent::llc_misses:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case PerfEvent::branch_misses:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    case PerfEvent::dtlb_misses:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = get_cache_config(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+        break;
+    default:
+        return -1;
+    }
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // This thread, on any CPU
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+PerfCounters::PerfCounters()
+{
+    int first_errno = 0;
+    for (std::size_t i = 0; i < NUM_PERF_EVENTS; i++) {
+        fds[i] = open_event(static_cast<PerfEvent>(i));
+        if (fds[i] < 0 && first_errno == 0) {
+            first_errno = errno;
+        }
+    }
+    if (!is_available()) {
+        error = std::string("perf_event_open failed: ") + std::strerror(first_errno);
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (const int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+void PerfCounters::start()
+{
+    for (const int fd : fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+PerfSample PerfCounters::stop()
+{
+    PerfSample sample{};
+    for (const int fd : fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (std::size_t i = 0; i < NUM_PERF_EVENTS; i++) {
+        // value, time enabled, time running
+        std::uint64_t data[3];
+        if (fds[i] < 0 || read(fds[i], data, sizeof(data)) != sizeof(data) || data[2] == 0) {
+            continue;
+        }
+        sample.values[i] = data[2] < data[1]
+            ? static_cast<std::uint64_t>(static_cast<double>(data[0]) * data[1] / data[2])
+            : data[0];
+        sample.valid[i] = true;
+    }
+    return sample;
+}
+
+#else
+
+PerfCounters::PerfCounters()
+    : error("perf_event_open is only available on Linux")
+{
+    fds.fill(-1);
+}
+
+PerfCounters::~PerfCounters()
+{
+}
+
+void PerfCounters::start()
+{
+}
+
+PerfSample PerfCounters::stop()
+{
+    return PerfSample{};
+}
+
+#endif
+
+bool PerfCounters::is_available() const
+{
+    for (const int fd : fds) {
+        if (fd >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string get_perf_event_name(const PerfEvent event)
+{
+    return perf_event_names.at(static_cast<std::size_t>(event));
+}
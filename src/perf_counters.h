@@ -0,0 +1,68 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Hardware performance counters of the calling thread, read through
+// Linux perf_event_open. User-space events only, so the default
+// perf_event_paranoid level of 2 allows them.
+//
+// Counters may be missing: on other systems, in containers that block
+// the system call, on virtual machines without a PMU, or for single
+// events the CPU lacks. Missing events are reported as invalid rather
+// than as errors, so callers can print what there is.
+//
+// Threads started before the counters are opened, such as those of the
+// row executor, are not counted.
+
+enum class PerfEvent : std::size_t {
+    cycles,
+    instructions,
+    l1d_misses,
+    llc_misses,
+    branch_misses,
+    dtlb_misses,
+    count
+};
+
+constexpr std::size_t NUM_PERF_EVENTS = static_cast<std::size_t>(PerfEvent::count);
+
+struct PerfSample {
+    std::array<std::uint64_t, NUM_PERF_EVENTS> values;
+    std::array<bool, NUM_PERF_EVENTS> valid;
+
+    bool has(const PerfEvent event) const { return valid[static_cast<std::size_t>(event)]; }
+    std::uint64_t get(const PerfEvent event) const { return values[static_cast<std::size_t>(event)]; }
+};
+
+class PerfCounters {
+public:
+    // Opens every event it can; never throws
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // True if at least one event could be opened
+    bool is_available() const;
+    // Why no event could be opened, empty if some could
+    const std::string& get_error() const { return error; }
+
+    // Zeroes and enables the counters
+    void start();
+    // Disables the counters and reads them. Counts are scaled up when the
+    // kernel had to multiplex the events.
+    PerfSample stop();
+
+private:
+    std::array<int, NUM_PERF_EVENTS> fds;
+    std::string error;
+};
+
+std::string get_perf_event_name(const PerfEvent event);
+
+#endif
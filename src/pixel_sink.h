@@ -0,0 +1,449 @@
+#ifndef PIXEL_SINK_H
+#define PIXEL_SINK_H
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "bitmask.h"
+#include "constants.h"
+#include "kernels.h"
+#include "tiled_canvas.h"
+
+// Pixel sinks decide what happens to the pixels a rasterizer produces.
+// The rasterizers in line_raster.h, circle_raster.h and bezier_raster.h
+// are templates over the sink type, so every sink gets its own inner loop
+// with no virtual calls. A sink provides:
+//   void plot(int x, int y);
+//   void span(int x0, int x1, int y); // inclusive, x0 <= x1
+// A sink drawing onto something other than the screen also provides
+// get_width() and get_height(), which rasterize_line_bresenham checks
+// line endpoints against. The anti-aliased rasterizers call
+//   void blend(int x, int y, std::uint32_t coverage); // 0 to 255
+// instead.
+
+// Overwrites pixels without any bounds checking
+class UncheckedSink {
+public:
+    UncheckedSink(std::vector<std::uint32_t>& pixels, const std::uint32_t color)
+        : data(pixels.data()), color(color), fill(get_kernels().fill_u32) {}
+
+    void plot(const int x, const int y)
+    {
+        data[(y * SCREEN_WIDTH) + x] = color;
+    }
+
+    void span(const int x0, const int x1, const int y)
+    {
+        fill(data + (y * SCREEN_WIDTH) + x0, x1 - x0 + 1, color);
+    }
+
+private:
+    std::uint32_t* data;
+    const std::uint32_t color;
+    void (*const fill)(std::uint32_t*, const std::size_t, const std::uint32_t);
+};
+
+// Overwrites pixels, throwing std::out_of_range for indices
+// outside the buffer
+class CheckedSink {
+public:
+    CheckedSink(std::vector<std::uint32_t>& pixels, const std::uint32_t color)
+        : pixels(pixels), color(color) {}
+
+    void plot(const int x, const int y)
+    {
+        pixels.at((y * SCREEN_WIDTH) + x) = color;
+    }
+
+    void span(const int x0, const int x1, const int y)
+    {
+        for (int x = x0; x <= x1; x++) {
+            pixels.at((y * SCREEN_WIDTH) + x) = color;
+        }
+    }
+
+private:
+    std::vector<std::uint32_t>& pixels;
+    const std::uint32_t color;
+};
+
+// Alpha blends a translucent ARGB color over the pixels (source over).
+// Pixels outside the screen are discarded.
+class BlendSink {
+public:
+    BlendSink(std::vector<std::uint32_t>& pixels, const std::uint32_t color)
+        : data(pixels.data()), color(color), alpha((color >> 24) + (color >> 31)), blend_span(get_kernels().blend_u32) {}
+
+    void plot(const int x, const int y)
+    {
+        if (x < 0 || x >= SCREEN_WIDTH || y < 0 || y >= SCREEN_HEIGHT) {
+            return;
+        }
+        std::uint32_t& dst = data[(y * SCREEN_WIDTH) + x];
+        dst = blend(dst);
+    }
+
+    void span(int x0, int x1, const int y)
+    {
+        if (y < 0 || y >= SCREEN_HEIGHT) {
+            return;
+        }
+        x0 = std::max(x0, 0);
+        x1 = std::min(x1, SCREEN_WIDTH - 1);
+        if (x0 <= x1) {
+            blend_span(data + (y * SCREEN_WIDTH) + x0, x1 - x0 + 1, color);
+        }
+    }
+
+private:
+    std::uint32_t* data;
+    const std::uint32_t color;
+    const std::uint32_t alpha;
+    void (*const blend_span)(std::uint32_t*, const std::size_t, const std::uint32_t);
+
+    // Alpha from 0 to 256, so that an opaque color is written exactly
+    std::uint32_t blend(const std::uint32_t dst) const
+    {
+        // Red and blue, then alpha and green, two channels per multiply
+        const std::uint32_t inv_alpha = 256 - alpha;
+        const std::uint32_t rb = (((color & 0x00FF00FF) * alpha) + ((dst & 0x00FF00FF) * inv_alpha)) >> 8;
+        const std::uint32_t ag = ((((color >> 8) & 0x00FF00FF) * alpha) + (((dst >> 8) & 0x00FF00FF) * inv_alpha)) >> 8;
+        return (rb & 0x00FF00FF) | ((ag & 0x00FF00FF) << 8) | 0xFF000000;
+    }
+};
+
+// Blends the color over the pixels by the coverage the anti-aliased
+// rasterizers give, scaling its alpha, without any bounds checking. For
+// primitives that is_aa_hull_on_screen puts wholly on the screen.
+class UncheckedCoverageSink {
+public:
+    UncheckedCoverageSink(std::vector<std::uint32_t>& pixels, const std::uint32_t color)
+        : data(pixels.data()), color(color), alpha((color >> 24) + (color >> 31)) {}
+
+    void blend(const int x, const int y, const std::uint32_t coverage)
+    {
+        // Alpha and coverage from 0 to 256, so that full coverage of an
+        // opaque color writes it exactly. Each channel moves towards the
+        // color by alpha, red and blue in one multiply, green in another.
+        const std::uint32_t a = (alpha * (coverage + (coverage >> 7))) >> 8;
+        std::uint32_t& dst = data[(y * SCREEN_WIDTH) + x];
+        const std::uint32_t rb = dst & 0x00FF00FF;
+        const std::uint32_t g = dst & 0x0000FF00;
+        dst = ((rb + ((((color & 0x00FF00FF) - rb) * a) >> 8)) & 0x00FF00FF)
+            | ((g + ((((color & 0x0000FF00) - g) * a) >> 8)) & 0x0000FF00)
+            | 0xFF000000;
+    }
+
+private:
+    std::uint32_t* data;
+    const std::uint32_t color;
+    const std::uint32_t alpha;
+};
+
+// Same as above, with pixels outside the screen discarded
+class CoverageSink {
+public:
+    CoverageSink(std::vector<std::uint32_t>& pixels, const std::uint32_t color)
+        : sink(pixels, color) {}
+
+    void blend(const int x, const int y, const std::uint32_t coverage)
+    {
+        if (x >= 0 && x < SCREEN_WIDTH && y >= 0 && y < SCREEN_HEIGHT) {
+            sink.blend(x, y, coverage);
+        }
+    }
+
+private:
+    UncheckedCoverageSink sink;
+};
+
+// True when the box from (x_min, y_min) to (x_max, y_max) is on the
+// screen. The anti-aliased line, circle and quadratic Bezier blend only
+// within the box around their points (the square around a circle), and
+// the cubic up to a pixel beyond its control points, so a primitive
+// whose box passes can be drawn with UncheckedCoverageSink.
+inline bool is_aa_hull_on_screen(const float x_min, const float y_min, const float x_max, const float y_max)
+{
+    return x_min >= 0 && y_min >= 0 && x_max < SCREEN_WIDTH && y_max < SCREEN_HEIGHT;
+}
+
+// Marks covered pixels in an 8-bit coverage mask of screen size.
+// Pixels outside the screen are discarded.
+class MaskSink {
+public:
+    MaskSink(std::vector<std::uint8_t>& mask, const std::uint8_t coverage = 0xFF)
+        : data(mask.data()), coverage(coverage) {}
+
+    void plot(const int x, const int y)
+    {
+        if (x >= 0 && x < SCREEN_WIDTH && y >= 0 && y < SCREEN_HEIGHT) {
+            data[(y * SCREEN_WIDTH) + x] = coverage;
+        }
+    }
+
+    void span(int x0, int x1, const int y)
+    {
+        if (y < 0 || y >= SCREEN_HEIGHT) {
+            return;
+        }
+        x0 = std::max(x0, 0);
+        x1 = std::min(x1, SCREEN_WIDTH - 1);
+        if (x0 <= x1) {
+            std::uint8_t* row = data + (y * SCREEN_WIDTH);
+            std::fill(row + x0, row + x1 + 1, coverage);
+        }
+    }
+
+private:
+    std::uint8_t* data;
+    const std::uint8_t coverage;
+};
+
+// Sets bits in a screen-sized bit mask. Coordinates outside the screen
+// behave as with CheckedSink: they wrap to the adjacent row, and throw
+// std::out_of_range past either end of the buffer.
+class BitMaskSink {
+public:
+    explicit BitMaskSink(BitMask& mask) : mask(mask) {}
+
+    void plot(int x, int y)
+    {
+        if (x < 0 || x >= SCREEN_WIDTH || y < 0 || y >= SCREEN_HEIGHT) {
+            const long i = (static_cast<long>(y) * SCREEN_WIDTH) + x;
+            if (i < 0 || i >= NUM_PIXELS) {
+                throw std::out_of_range("BitMaskSink: pixel outside of mask");
+            }
+            x = i % SCREEN_WIDTH;
+            y = i / SCREEN_WIDTH;
+        }
+        mask.set(x, y);
+    }
+
+    void span(const int x0, const int x1, const int y)
+    {
+        if (x0 >= 0 && x1 < SCREEN_WIDTH && y >= 0 && y < SCREEN_HEIGHT) {
+            mask.set_span(x0, x1, y);
+            return;
+        }
+        for (int x = x0; x <= x1; x++) {
+            plot(x, y);
+        }
+    }
+
+private:
+    BitMask& mask;
+};
+
+// Sets bits of a mask covering the rect of a (width x height) surface
+// whose top left corner is (x_min, y_min). Pixels outside the rect
+// are discarded.
+class OffsetMaskSink {
+public:
+    OffsetMaskSink(BitMask& mask, const int width, const int height, const int x_min, const int y_min)
+        : mask(mask), width(width), height(height), x_min(x_min), y_min(y_min) {}
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+
+    void plot(int x, int y)
+    {
+        x -= x_min;
+        y -= y_min;
+        if (x >= 0 && x < mask.get_width() && y >= 0 && y < mask.get_height()) {
+            mask.set(x, y);
+        }
+    }
+
+    void span(int x0, int x1, int y)
+    {
+        y -= y_min;
+        if (y < 0 || y >= mask.get_height()) {
+            return;
+        }
+        x0 = std::max(x0 - x_min, 0);
+        x1 = std::min(x1 - x_min, mask.get_width() - 1);
+        if (x0 <= x1) {
+            mask.set_span(x0, x1, y);
+        }
+    }
+
+private:
+    BitMask& mask;
+    const int width;
+    const int height;
+    const int x_min;
+    const int y_min;
+};
+
+// Overwrites pixels of a TiledCanvas, allocating tiles as they are
+// first drawn on. Pixels outside the canvas are discarded.
+class TiledCanvasSink {
+public:
+    TiledCanvasSink(TiledCanvas& canvas, const std::uint32_t color)
+        : canvas(canvas),
+          width(canvas.get_width()),
+          height(canvas.get_height()),
+          color(color),
+          fill(get_kernels().fill_u32),
+          tile_x(-1),
+          tile_y(-1),
+          tile(nullptr) {}
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+
+    void plot(const int x, const int y)
+    {
+        if (x < 0 || x >= width || y < 0 || y >= height) {
+            return;
+        }
+        // Rasterizers step to neighbouring pixels, so the last tile
+        // is usually the right one
+        if ((x >> TiledCanvas::TILE_SHIFT) != tile_x || (y >> TiledCanvas::TILE_SHIFT) != tile_y) {
+            tile_x = x >> TiledCanvas::TILE_SHIFT;
+            tile_y = y >> TiledCanvas::TILE_SHIFT;
+            tile = canvas.get_tile(tile_x, tile_y);
+        }
+        tile[((y & TiledCanvas::TILE_MASK) << TiledCanvas::TILE_SHIFT) + (x & TiledCanvas::TILE_MASK)] = color;
+    }
+
+    void span(int x0, int x1, const int y)
+    {
+        if (y < 0 || y >= height) {
+            return;
+        }
+        x0 = std::max(x0, 0);
+        x1 = std::min(x1, width - 1);
+        const int ty = y >> TiledCanvas::TILE_SHIFT;
+        const int row = (y & TiledCanvas::TILE_MASK) << TiledCanvas::TILE_SHIFT;
+        for (int x = x0; x <= x1; x = (x | TiledCanvas::TILE_MASK) + 1) {
+            const int run_end = std::min(x | TiledCanvas::TILE_MASK, x1);
+            std::uint32_t* const dst = canvas.get_tile(x >> TiledCanvas::TILE_SHIFT, ty);
+            fill(dst + row + (x & TiledCanvas::TILE_MASK), run_end - x + 1, color);
+        }
+    }
+
+private:
+    TiledCanvas& canvas;
+    const int width;
+    const int height;
+    const std::uint32_t color;
+    void (*const fill)(std::uint32_t*, const std::size_t, const std::uint32_t);
+    // Tile of the last plot
+    int tile_x;
+    int tile_y;
+    std::uint32_t* tile;
+};
+
+// Only records whether any pixel was produced; wrapped in a ClipSink,
+// tests whether a primitive covers a region
+class HitSink {
+public:
+    bool hit = false;
+
+    void plot(const int, const int)
+    {
+        hit = true;
+    }
+
+    void span(const int, const int, const int)
+    {
+        hit = true;
+    }
+};
+
+// Inclusive run of pixels on one row
+struct Span {
+    int y;
+    int x0;
+    int x1;
+};
+
+// Records spans instead of writing pixels.
+// Consecutive plots on the same row are merged into one span.
+class SpanCollector {
+public:
+    std::vector<Span> spans;
+
+    void plot(const int x, const int y)
+    {
+        span(x, x, y);
+    }
+
+    void span(const int x0, const int x1, const int y)
+    {
+        if (!spans.empty()) {
+            Span& last = spans.back();
+            if (last.y == y && x0 == last.x1 + 1) {
+                last.x1 = x1;
+                return;
+            }
+            if (last.y == y && x1 == last.x0 - 1) {
+                last.x0 = x0;
+                return;
+            }
+        }
+        spans.push_back({y, x0, x1});
+    }
+};
+
+// Counts the pixels passed on to another sink
+template <typename Sink>
+class CountingSink {
+public:
+    std::uint64_t count = 0;
+
+    explicit CountingSink(Sink& sink) : sink(sink) {}
+
+    void plot(const int x, const int y)
+    {
+        count++;
+        sink.plot(x, y);
+    }
+
+    void span(const int x0, const int x1, const int y)
+    {
+        count += x1 - x0 + 1;
+        sink.span(x0, x1, y);
+    }
+
+private:
+    Sink& sink;
+};
+
+// Passes on only the pixels inside an inclusive clip rectangle
+template <typename Sink>
+class ClipSink {
+public:
+    ClipSink(Sink& sink, const int x_min, const int y_min, const int x_max, const int y_max)
+        : sink(sink), x_min(x_min), y_min(y_min), x_max(x_max), y_max(y_max) {}
+
+    void plot(const int x, const int y)
+    {
+        if (x >= x_min && x <= x_max && y >= y_min && y <= y_max) {
+            sink.plot(x, y);
+        }
+    }
+
+    void span(int x0, int x1, const int y)
+    {
+        if (y < y_min || y > y_max) {
+            return;
+        }
+        x0 = std::max(x0, x_min);
+        x1 = std::min(x1, x_max);
+        if (x0 <= x1) {
+            sink.span(x0, x1, y);
+        }
+    }
+
+private:
+    Sink& sink;
+    const int x_min;
+    const int y_min;
+    const int x_max;
+    const int y_max;
+};
+
+#endif
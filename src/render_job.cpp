@@ -0,0 +1,58 @@
+#include "render_job.h"
+#include "constants.h"
+
+RenderJob::RenderJob(const DisplayList& list, std::vector<std::uint32_t>& pixels)
+    : list(list), pixels(pixels), next_command(0), num_steps(0)
+{
+}
+
+double RenderJob::get_progress() const
+{
+    return list.size() > 0 ? static_cast<double>(next_command) / list.size() : 1.0;
+}
+
+void RenderJob::restart()
+{
+    next_command = 0;
+    num_steps = 0;
+    path_fill.reset();
+}
+
+std::size_t RenderJob::step()
+{
+    const DrawCommand& cmd = list.get_command(next_command);
+    num_steps++;
+    if (!path_fill) {
+        if (cmd.type != DrawCommandType::path) {
+            list.replay_command(pixels, cmd);
+            next_command++;
+            if (cmd.type == DrawCommandType::scanline_fill || cmd.type == DrawCommandType::flood_fill) {
+                return NUM_PIXELS;
+            }
+            return static_cast<std::size_t>(cmd.bounds.x_max - cmd.bounds.x_min) + (cmd.bounds.y_max - cmd.bounds.y_min) + 1;
+        }
+        path_fill = std::make_unique<PathFill>(list.get_path(cmd));
+    }
+    const std::size_t work = path_fill->is_done() ? 0 : path_fill->step(pixels, cmd.color);
+    if (path_fill->is_done()) {
+        path_fill.reset();
+        next_command++;
+    }
+    return work;
+}
+
+bool RenderJob::advance(const RenderBudget& budget)
+{
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t pixels_drawn = 0;
+    while (!is_done()) {
+        pixels_drawn += step();
+        if (budget.pixels > 0 && pixels_drawn >= budget.pixels) {
+            break;
+        }
+        if (budget.time.count() > 0 && std::chrono::steady_clock::now() - start >= budget.time) {
+            break;
+        }
+    }
+    return is_done();
+}
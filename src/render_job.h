@@ -0,0 +1,57 @@
+#ifndef RENDER_JOB_H
+#define RENDER_JOB_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "display_list.h"
+#include "svg.h"
+
+// How much a RenderJob may draw in one call; zero means no limit
+struct RenderBudget {
+    std::chrono::microseconds time;
+    // Estimated pixels touched: the width plus height of a primitive or
+    // path segment, the width of a filled row, the screen for a fill
+    std::size_t pixels;
+};
+
+// Replays a display list over several calls, so a scene too large to
+// draw within a frame can be shown while it completes. The job keeps its
+// position between calls: the next command and, inside a filled path,
+// the next segment of the outline or row of the fill. Paths are the only
+// commands split up; everything else is drawn whole. The pixels show the
+// commands drawn so far, and hold the same frame as replay once done.
+//
+// The list and pixels must outlive the job, and the list must not change
+// while it runs.
+class RenderJob {
+public:
+    RenderJob(const DisplayList& list, std::vector<std::uint32_t>& pixels);
+
+    // Draws until the budget is spent or the list is done, always taking
+    // at least one step. True once the whole list is drawn.
+    bool advance(const RenderBudget& budget);
+
+    bool is_done() const { return next_command >= list.size(); }
+    // Fraction of the commands drawn
+    double get_progress() const;
+    std::size_t get_num_steps() const { return num_steps; }
+
+    // Starts over from the first command; the pixels are left as they are
+    void restart();
+
+private:
+    const DisplayList& list;
+    std::vector<std::uint32_t>& pixels;
+    std::size_t next_command;
+    std::size_t num_steps;
+    // The path being drawn, if any
+    std::unique_ptr<PathFill> path_fill;
+
+    // Returns the estimated pixels touched
+    std::size_t step();
+};
+
+#endif
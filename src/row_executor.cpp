@@ -0,0 +1,171 @@
+#include "row_executor.h"
+#include <cstdlib>
+#include <string>
+
+// Set on pool threads, so bands that use the executor run serially
+static thread_local bool is_pool_thread = false;
+
+RowExecutor::RowExecutor(const int num_threads)
+    : job(nullptr),
+      job_bands(0),
+      job_workers(0),
+      job_scope(InstrumentedPrimitive::count),
+      generation(0),
+      busy_workers(0),
+      stopping(false),
+      next_band(0)
+{
+    start(num_threads);
+}
+
+RowExecutor::~RowExecutor()
+{
+    stop();
+}
+
+void RowExecutor::set_num_threads(const int num_threads)
+{
+    stop();
+    start(num_threads);
+}
+
+void RowExecutor::start(const int num_threads)
+{
+    stopping = false;
+    for (int i = 1; i < num_threads; i++) {
+        workers.emplace_back(&RowExecutor::work, this, i - 1);
+    }
+}
+
+void RowExecutor::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start_cv.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+int RowExecutor::get_rows_per_band(const int y_begin, const int y_end, const std::size_t row_bytes) const
+{
+    if (y_end <= y_begin) {
+        return 0;
+    }
+    const int num_rows = y_end - y_begin;
+    if (workers.empty() || row_bytes * num_rows < MIN_PARALLEL_BYTES) {
+        return num_rows;
+    }
+    return static_cast<int>(std::clamp<std::size_t>(BAND_BYTES / std::max<std::size_t>(row_bytes, 1), 1, num_rows));
+}
+
+void RowExecutor::run_bands(const std::function<void(int)>& band_func)
+{
+    int band;
+    while ((band = next_band.fetch_add(1, std::memory_order_relaxed)) < job_bands) {
+        band_func(band);
+    }
+}
+
+void RowExecutor::run(const int num_bands, const std::function<void(int)>& band_func)
+{
+    std::unique_lock<std::mutex> submit_lock(submit_mutex, std::defer_lock);
+    if (num_bands <= 1 || workers.empty() || is_pool_thread || !submit_lock.try_lock()) {
+        for (int band = 0; band < num_bands; band++) {
+            band_func(band);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &band_func;
+        job_bands = num_bands;
+        // No more threads than bands beyond the caller's own
+        job_workers = std::min(static_cast<int>(workers.size()), num_bands - 1);
+        busy_workers = job_workers;
+#ifdef DRAW2D_INSTRUMENT
+        job_scope = get_thread_scope();
+#endif
+        next_band.store(0, std::memory_order_relaxed);
+        error = nullptr;
+        generation++;
+    }
+    start_cv.notify_all();
+    std::exception_ptr caller_error;
+    try {
+        run_bands(band_func);
+    } catch (...) {
+        // The pool threads still use band_func, so wait for them first
+        caller_error = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [this]() { return busy_workers == 0; });
+    job = nullptr;
+    if (caller_error) {
+        std::rethrow_exception(caller_error);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void RowExecutor::work(const int index)
+{
+    is_pool_thread = true;
+    std::uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        start_cv.wait(lock, [&]() { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        if (index >= job_workers) {
+            continue;
+        }
+        const std::function<void(int)>& band_func = *job;
+#ifdef DRAW2D_INSTRUMENT
+        get_thread_scope() = job_scope;
+#endif
+        lock.unlock();
+        try {
+            run_bands(band_func);
+        } catch (...) {
+            std::lock_guard<std::mutex> error_lock(mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+        lock.lock();
+#ifdef DRAW2D_INSTRUMENT
+        get_thread_scope() = InstrumentedPrimitive::count;
+#endif
+        if (--busy_workers == 0) {
+            done_cv.notify_one();
+        }
+    }
+}
+
+static int get_default_num_threads()
+{
+    const char* env = std::getenv("DRAW2D_THREADS");
+    if (env != nullptr) {
+        try {
+            return std::max(1, std::stoi(env));
+        } catch (const std::exception&) {
+            // Fall back to the hardware
+        }
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+RowExecutor& get_row_executor()
+{
+    static RowExecutor executor(get_default_num_threads());
+    return executor;
+}
@@ -0,0 +1,123 @@
+#ifndef ROW_EXECUTOR_H
+#define ROW_EXECUTOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "instrument.h"
+
+// Persistent thread pool for whole-frame pixel operations. A range of
+// rows is cut into bands of about BAND_BYTES, which the pool threads
+// and the calling thread take in turn until all are done. Lists of
+// independent tasks are shared out the same way.
+//
+// Ranges under MIN_PARALLEL_BYTES, calls made from inside a band or
+// task and calls while another thread is using the pool run serially on
+// the calling thread, so callers need no special cases. Bands count
+// under the instrument scope of the calling thread, wherever they run.
+class RowExecutor {
+public:
+    // Rows per band are chosen to keep a band within the L2 cache
+    static constexpr std::size_t BAND_BYTES = 128 * 1024;
+    static constexpr std::size_t MIN_PARALLEL_BYTES = 256 * 1024;
+
+    // num_threads counts the calling thread, so 1 runs everything serially
+    explicit RowExecutor(const int num_threads);
+    ~RowExecutor();
+
+    RowExecutor(const RowExecutor&) = delete;
+    RowExecutor& operator=(const RowExecutor&) = delete;
+
+    int get_num_threads() const { return static_cast<int>(workers.size()) + 1; }
+    // Restarts the pool; must not be called while it is in use
+    void set_num_threads(const int num_threads);
+
+    // Calls func(y0, y1) for bands [y0, y1) covering [y_begin, y_end),
+    // where each row is row_bytes long. Returns when every band is done.
+    template <typename Func>
+    void for_each_band(const int y_begin, const int y_end, const std::size_t row_bytes, Func&& func)
+    {
+        const int rows_per_band = get_rows_per_band(y_begin, y_end, row_bytes);
+        if (rows_per_band == 0) {
+            return;
+        }
+        const int num_bands = (y_end - y_begin + rows_per_band - 1) / rows_per_band;
+        run(num_bands, [&](const int band) {
+            const int y0 = y_begin + (band * rows_per_band);
+            func(y0, std::min(y0 + rows_per_band, y_end));
+        });
+    }
+
+    // Maps each band to a T with func(y0, y1) and folds the results in
+    // band order, starting from init, so the result does not depend on
+    // the number of threads
+    template <typename T, typename Func, typename Combine>
+    T reduce_bands(const int y_begin, const int y_end, const std::size_t row_bytes, T init, Func&& func, Combine&& combine)
+    {
+        const int rows_per_band = get_rows_per_band(y_begin, y_end, row_bytes);
+        if (rows_per_band == 0) {
+            return init;
+        }
+        const int num_bands = (y_end - y_begin + rows_per_band - 1) / rows_per_band;
+        std::vector<T> results(num_bands, init);
+        run(num_bands, [&](const int band) {
+            const int y0 = y_begin + (band * rows_per_band);
+            results[band] = func(y0, std::min(y0 + rows_per_band, y_end));
+        });
+        for (const T& result : results) {
+            init = combine(init, result);
+        }
+        return init;
+    }
+
+    // Calls func(i) for every i in [0, count), for independent tasks such
+    // as the paths of an SVG. Returns when every task is done.
+    template <typename Func>
+    void for_each_task(const int count, Func&& func)
+    {
+        run(count, [&](const int i) { func(i); });
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    // Held by the thread running a job
+    std::mutex submit_mutex;
+    // Current job, guarded by mutex except for next_band
+    const std::function<void(int)>* job;
+    int job_bands;
+    int job_workers;
+    // Instrument scope of the caller, which the pool threads count under
+    InstrumentedPrimitive job_scope;
+    std::uint64_t generation;
+    int busy_workers;
+    bool stopping;
+    // First exception thrown by a band on a pool thread
+    std::exception_ptr error;
+    std::atomic<int> next_band;
+
+    // 0 when the range is empty; the whole range when it is too small
+    // to split
+    int get_rows_per_band(const int y_begin, const int y_end, const std::size_t row_bytes) const;
+    void run(const int num_bands, const std::function<void(int)>& band_func);
+    void run_bands(const std::function<void(int)>& band_func);
+    void work(const int index);
+    void start(const int num_threads);
+    void stop();
+};
+
+// Shared pool used by the drawing functions. Its size is the number of
+// hardware threads, or DRAW2D_THREADS if that is set.
+RowExecutor& get_row_executor();
+
+#endif
@@ -0,0 +1,390 @@
+#include "scene.h"
+#include <algorithm>
+#include <stdexcept>
+#include "bezier_raster.h"
+#include "circle_raster.h"
+#include "kernels.h"
+#include "line_raster.h"
+#include "svg.h"
+
+// Beyond this many separate regions, or this share of the screen,
+// one full redraw is cheaper
+constexpr std::size_t MAX_DIRTY_RECTS = 64;
+constexpr long MAX_DIRTY_AREA = NUM_PIXELS / 2;
+// Unmerged rects kept before giving up on partial redraws; a move adds
+// two that usually overlap, so this is looser than MAX_DIRTY_RECTS
+constexpr std::size_t MAX_PENDING_RECTS = 4 * MAX_DIRTY_RECTS;
+
+static bool intersects(const DrawBounds& a, const DrawBounds& b)
+{
+    return a.x_min <= b.x_max && b.x_min <= a.x_max && a.y_min <= b.y_max && b.y_min <= a.y_max;
+}
+
+static long get_area(const DrawBounds& rect)
+{
+    return static_cast<long>(rect.x_max - rect.x_min + 1) * (rect.y_max - rect.y_min + 1);
+}
+
+static bool touches(const DrawBounds& a, const DrawBounds& b)
+{
+    return intersects({a.x_min - 1, a.y_min - 1, a.x_max + 1, a.y_max + 1}, b);
+}
+
+// Merges rects that overlap or touch until none do. Each pass sweeps the
+// rects in x order against the ones still open at the sweep line, and a
+// grown rect can reach new neighbours, so passes repeat until none merge
+static void merge_rects(std::vector<DrawBounds>& rects)
+{
+    std::vector<DrawBounds> merged;
+    std::vector<std::size_t> open;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        std::sort(rects.begin(), rects.end(), [](const DrawBounds& a, const DrawBounds& b) { return a.x_min < b.x_min; });
+        merged.clear();
+        open.clear();
+        for (const DrawBounds& rect : rects) {
+            open.erase(std::remove_if(open.begin(), open.end(), [&](const std::size_t k) {
+                return merged[k].x_max + 1 < rect.x_min;
+            }), open.end());
+            const auto hit = std::find_if(open.begin(), open.end(), [&](const std::size_t k) { return touches(merged[k], rect); });
+            if (hit == open.end()) {
+                open.push_back(merged.size());
+                merged.push_back(rect);
+                continue;
+            }
+            DrawBounds& into = merged[*hit];
+            into = {
+                std::min(into.x_min, rect.x_min),
+                std::min(into.y_min, rect.y_min),
+                std::max(into.x_max, rect.x_max),
+                std::max(into.y_max, rect.y_max)
+            };
+            changed = true;
+        }
+        rects.swap(merged);
+    }
+}
+
+Scene::Scene(const std::uint32_t background)
+    : background(background), num_alive(0), dirty_area(0), all_dirty(true)
+{
+}
+
+SceneObjectId Scene::add(const DrawCommand& cmd)
+{
+    objects.push_back(cmd);
+    alive.push_back(true);
+    num_alive++;
+    grid.insert(static_cast<SceneObjectId>(objects.size() - 1), cmd.bounds);
+    invalidate(cmd.bounds);
+    return static_cast<SceneObjectId>(objects.size() - 1);
+}
+
+SceneObjectId Scene::add_line(
+    const LineAlgorithm algorithm,
+    const std::uint32_t color,
+    const int ax, const int ay,
+    const int bx, const int by)
+{
+    return add(make_line_command(algorithm, color, ax, ay, bx, by));
+}
+
+SceneObjectId Scene::add_circle(const std::uint32_t color, const int cx, const int cy, const int radius)
+{
+    return add(make_circle_command(color, cx, cy, radius));
+}
+
+SceneObjectId Scene::add_bezier_quad(
+    const std::uint32_t color,
+    const int x0, const int y0,
+    const int x1, const int y1,
+    const int x2, const int y2)
+{
+    return add(make_bezier_quad_command(color, x0, y0, x1, y1, x2, y2));
+}
+
+SceneObjectId Scene::add_bezier_cubic(
+    const std::uint32_t color,
+    const int x0, const int y0,
+    const float x1, const float y1,
+    const float x2, const float y2,
+    const int x3, const int y3)
+{
+    return add(make_bezier_cubic_command(color, x0, y0, x1, y1, x2, y2, x3, y3));
+}
+
+SceneObjectId Scene::add_path(const std::uint32_t color, const std::string& path)
+{
+    ScenePath scene_path = {parse_path(path), {}};
+    if (scene_path.segments.empty()) {
+        throw std::runtime_error("Scene: empty path \"" + path + "\".");
+    }
+    DrawCommand cmd{};
+    cmd.type = DrawCommandType::path;
+    cmd.color = color;
+    cmd.i = {static_cast<int>(paths.size())};
+    update_path(scene_path, cmd.bounds);
+    paths.push_back(std::move(scene_path));
+    return add(cmd);
+}
+
+std::vector<SceneObjectId> Scene::add_svg(const std::uint32_t color, const std::string& file_path)
+{
+    std::vector<SceneObjectId> ids;
+    for (const std::string& path : get_paths_from_svg(file_path)) {
+        ids.push_back(add_path(color, path));
+    }
+    return ids;
+}
+
+void Scene::update_path(ScenePath& path, DrawBounds& bounds)
+{
+    // Filled once here, so redraws only copy spans. The path is filled in
+    // a mask of its own bounds and only the spans are clipped to the
+    // screen, so a path moved partly off the screen stays closed.
+    path.spans = get_path_spans(path.segments);
+    bounds = get_path_bounds(path.segments);
+    if (path.spans.empty()) {
+        return;
+    }
+    bounds = {path.spans.front().x0, path.spans.front().y, path.spans.front().x1, path.spans.back().y};
+    for (const Span& span : path.spans) {
+        bounds.x_min = std::min(bounds.x_min, span.x0);
+        bounds.x_max = std::max(bounds.x_max, span.x1);
+    }
+}
+
+DrawCommand& Scene::get_alive(const SceneObjectId id)
+{
+    if (!contains(id)) {
+        throw std::out_of_range("Scene: no object with id " + std::to_string(id));
+    }
+    return objects[id];
+}
+
+const DrawCommand& Scene::get_object(const SceneObjectId id) const
+{
+    if (!contains(id)) {
+        throw std::out_of_range("Scene: no object with id " + std::to_string(id));
+    }
+    return objects[id];
+}
+
+void Scene::move(const SceneObjectId id, const int dx, const int dy)
+{
+    DrawCommand& cmd = get_alive(id);
+    invalidate(cmd.bounds);
+    std::array<int, 6>& i = cmd.i;
+    switch (cmd.type) {
+        case DrawCommandType::line:
+            i = {i[0] + dx, i[1] + dy, i[2] + dx, i[3] + dy};
+            break;
+        case DrawCommandType::circle:
+            i[0] += dx;
+            i[1] += dy;
+            break;
+        case DrawCommandType::bezier_quad:
+            i = {i[0] + dx, i[1] + dy, i[2] + dx, i[3] + dy, i[4] + dx, i[5] + dy};
+            break;
+        case DrawCommandType::bezier_cubic:
+            i = {i[0] + dx, i[1] + dy, i[2] + dx, i[3] + dy};
+            cmd.f = {cmd.f[0] + dx, cmd.f[1] + dy, cmd.f[2] + dx, cmd.f[3] + dy};
+            break;
+        case DrawCommandType::path: {
+            ScenePath& path = paths[i[0]];
+            for (PathSegment& seg : path.segments) {
+                for (std::size_t c = 0; c < seg.c.size(); c += 2) {
+                    seg.c[c] += dx;
+                    seg.c[c + 1] += dy;
+                }
+            }
+            // Refilled rather than shifted: the spans are clipped to the
+            // screen, so part of the path may have come into view
+            update_path(path, cmd.bounds);
+            grid.update(id, cmd.bounds);
+            invalidate(cmd.bounds);
+            return;
+        }
+        case DrawCommandType::scanline_fill:
+        case DrawCommandType::flood_fill:
+            break;
+    }
+    cmd.bounds = {cmd.bounds.x_min + dx, cmd.bounds.y_min + dy, cmd.bounds.x_max + dx, cmd.bounds.y_max + dy};
+    grid.update(id, cmd.bounds);
+    invalidate(cmd.bounds);
+}
+
+void Scene::set_color(const SceneObjectId id, const std::uint32_t color)
+{
+    DrawCommand& cmd = get_alive(id);
+    cmd.color = color;
+    invalidate(cmd.bounds);
+}
+
+void Scene::remove(const SceneObjectId id)
+{
+    invalidate(get_alive(id).bounds);
+    alive[id] = false;
+    num_alive--;
+    grid.remove(id);
+    if (objects[id].type == DrawCommandType::path) {
+        ScenePath& path = paths[objects[id].i[0]];
+        path.segments = {};
+        path.spans = {};
+    }
+}
+
+bool Scene::contains(const SceneObjectId id) const
+{
+    return id < objects.size() && alive[id];
+}
+
+std::size_t Scene::size() const
+{
+    return num_alive;
+}
+
+void Scene::invalidate(const DrawBounds& rect)
+{
+    // One pixel of margin for rasterizers that round past the hull
+    const DrawBounds clipped = {
+        std::max(rect.x_min - 1, 0),
+        std::max(rect.y_min - 1, 0),
+        std::min(rect.x_max + 1, SCREEN_WIDTH - 1),
+        std::min(rect.y_max + 1, SCREEN_HEIGHT - 1)
+    };
+    if (all_dirty || clipped.x_min > clipped.x_max || clipped.y_min > clipped.y_max) {
+        return;
+    }
+    dirty.push_back(clipped);
+    // The summed area only overestimates the merged one
+    dirty_area += get_area(clipped);
+    if (dirty.size() > MAX_PENDING_RECTS || dirty_area > MAX_DIRTY_AREA) {
+        invalidate_all();
+    }
+}
+
+void Scene::invalidate_all()
+{
+    all_dirty = true;
+    dirty.clear();
+    dirty_area = 0;
+}
+
+void Scene::query(const DrawBounds& rect, std::vector<SceneObjectId>& ids) const
+{
+    grid.query(rect, ids);
+}
+
+bool Scene::pick(const int x, const int y, SceneObjectId& id, const int tolerance) const
+{
+    const DrawBounds area = {x - tolerance, y - tolerance, x + tolerance, y + tolerance};
+    std::vector<SceneObjectId> hits;
+    grid.query(area, hits);
+    // Topmost first
+    for (auto it = hits.rbegin(); it != hits.rend(); it++) {
+        HitSink hit;
+        ClipSink<HitSink> sink(hit, area.x_min, area.y_min, area.x_max, area.y_max);
+        rasterize_object(sink, objects[*it], area);
+        if (hit.hit) {
+            id = *it;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Rasterizes an object into a sink that clips to clip; paths only
+// pass on the rows of clip
+template <typename Sink>
+void Scene::rasterize_object(Sink& sink, const DrawCommand& cmd, const DrawBounds& clip) const
+{
+    const std::array<int, 6>& i = cmd.i;
+    switch (cmd.type) {
+        case DrawCommandType::line:
+            switch (cmd.algorithm) {
+                case LineAlgorithm::dda:
+                    rasterize_line_dda(sink, i[0], i[1], i[2], i[3]);
+                    break;
+                case LineAlgorithm::bresenham:
+                    rasterize_line_bresenham(sink, i[0], i[1], i[2], i[3]);
+                    break;
+                case LineAlgorithm::zingl:
+                    rasterize_line_zingl(sink, i[0], i[1], i[2], i[3]);
+                    break;
+                case LineAlgorithm::run_slice:
+                    rasterize_line_run_slice(sink, i[0], i[1], i[2], i[3]);
+                    break;
+            }
+            break;
+        case DrawCommandType::circle:
+            rasterize_circle_midpoint(sink, i[0], i[1], i[2]);
+            break;
+        case DrawCommandType::bezier_quad:
+            rasterize_bezier_quad(sink, i[0], i[1], i[2], i[3], i[4], i[5]);
+            break;
+        case DrawCommandType::bezier_cubic:
+            rasterize_bezier_cubic(sink, i[0], i[1], cmd.f[0], cmd.f[1], cmd.f[2], cmd.f[3], i[2], i[3]);
+            break;
+        case DrawCommandType::path: {
+            const std::vector<Span>& spans = paths[i[0]].spans;
+            auto span = std::lower_bound(spans.begin(), spans.end(), clip.y_min, [](const Span& s, const int y) {
+                return s.y < y;
+            });
+            for (; span != spans.end() && span->y <= clip.y_max; span++) {
+                sink.span(span->x0, span->x1, span->y);
+            }
+            break;
+        }
+        case DrawCommandType::scanline_fill:
+        case DrawCommandType::flood_fill:
+            break;
+    }
+}
+
+void Scene::redraw(std::vector<std::uint32_t>& pixels, const DrawBounds& rect)
+{
+    const Kernels& kernels = get_kernels();
+    for (int y = rect.y_min; y <= rect.y_max; y++) {
+        kernels.fill_u32(pixels.data() + (y * SCREEN_WIDTH) + rect.x_min, rect.x_max - rect.x_min + 1, background);
+    }
+    candidates.clear();
+    if (rect.x_min == 0 && rect.y_min == 0 && rect.x_max == SCREEN_WIDTH - 1 && rect.y_max == SCREEN_HEIGHT - 1) {
+        for (std::size_t id = 0; id < objects.size(); id++) {
+            if (alive[id]) {
+                candidates.push_back(static_cast<SceneObjectId>(id));
+            }
+        }
+    } else {
+        grid.query(rect, candidates);
+    }
+    for (const SceneObjectId id : candidates) {
+        const DrawCommand& cmd = objects[id];
+        UncheckedSink unchecked(pixels, cmd.color);
+        ClipSink<UncheckedSink> sink(unchecked, rect.x_min, rect.y_min, rect.x_max, rect.y_max);
+        rasterize_object(sink, cmd, rect);
+    }
+}
+
+void Scene::render(std::vector<std::uint32_t>& pixels)
+{
+    if (!all_dirty) {
+        merge_rects(dirty);
+        long area = 0;
+        for (const DrawBounds& rect : dirty) {
+            area += get_area(rect);
+        }
+        all_dirty = dirty.size() > MAX_DIRTY_RECTS || area > MAX_DIRTY_AREA;
+    }
+    if (all_dirty) {
+        redraw(pixels, {0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1});
+    } else {
+        for (const DrawBounds& rect : dirty) {
+            redraw(pixels, rect);
+        }
+    }
+    dirty.clear();
+    dirty_area = 0;
+    all_dirty = false;
+}
@@ -0,0 +1,101 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "constants.h"
+#include "display_list.h"
+#include "pixel_sink.h"
+#include "spatial_grid.h"
+
+// Stable handle to an object of a Scene. Ids are never reused, and the
+// objects are drawn in id order.
+using SceneObjectId = std::uint32_t;
+
+// Retained-mode counterpart of DisplayList: objects stay in the scene
+// and can be moved, recolored or removed. Each change invalidates the
+// object's old and new bounds, and render() then re-rasterizes only the
+// objects overlapping the invalidated regions, clipped to them, over
+// the previous frame.
+class Scene {
+public:
+    explicit Scene(const std::uint32_t background = blank);
+
+    SceneObjectId add_line(
+        const LineAlgorithm algorithm,
+        const std::uint32_t color,
+        const int ax, const int ay,
+        const int bx, const int by
+    );
+    SceneObjectId add_circle(const std::uint32_t color, const int cx, const int cy, const int radius);
+    SceneObjectId add_bezier_quad(
+        const std::uint32_t color,
+        const int x0, const int y0,
+        const int x1, const int y1,
+        const int x2, const int y2
+    );
+    SceneObjectId add_bezier_cubic(
+        const std::uint32_t color,
+        const int x0, const int y0,
+        const float x1, const float y1,
+        const float x2, const float y2,
+        const int x3, const int y3
+    );
+    // Filled path, as drawn by draw_svg
+    SceneObjectId add_path(const std::uint32_t color, const std::string& path);
+    std::vector<SceneObjectId> add_svg(const std::uint32_t color, const std::string& file_path);
+
+    void move(const SceneObjectId id, const int dx, const int dy);
+    void set_color(const SceneObjectId id, const std::uint32_t color);
+    void remove(const SceneObjectId id);
+
+    bool contains(const SceneObjectId id) const;
+    // Number of objects in the scene
+    std::size_t size() const;
+    // Throws std::out_of_range for ids not in the scene
+    const DrawCommand& get_object(const SceneObjectId id) const;
+
+    // Appends the ids of the objects whose bounds intersect rect,
+    // in drawing order
+    void query(const DrawBounds& rect, std::vector<SceneObjectId>& ids) const;
+
+    // Finds the topmost object with a pixel within tolerance pixels of
+    // (x, y), rasterizing the candidates exactly as render() draws them
+    bool pick(const int x, const int y, SceneObjectId& id, const int tolerance = 2) const;
+
+    void invalidate(const DrawBounds& rect);
+    void invalidate_all();
+
+    // Brings pixels up to date. pixels must hold the frame this scene
+    // rendered last; the first render redraws the whole frame.
+    void render(std::vector<std::uint32_t>& pixels);
+
+private:
+    // Pixels of a filled path, computed when it is added or moved
+    struct ScenePath {
+        std::vector<PathSegment> segments;
+        std::vector<Span> spans;
+    };
+
+    std::uint32_t background;
+    std::vector<DrawCommand> objects;
+    std::vector<bool> alive;
+    std::vector<ScenePath> paths;
+    std::size_t num_alive;
+    std::vector<DrawBounds> dirty;
+    long dirty_area;
+    bool all_dirty;
+    SpatialGrid grid;
+    // Reused by render() for the objects of each region
+    std::vector<SceneObjectId> candidates;
+
+    SceneObjectId add(const DrawCommand& cmd);
+    DrawCommand& get_alive(const SceneObjectId id);
+    void update_path(ScenePath& path, DrawBounds& bounds);
+    template <typename Sink>
+    void rasterize_object(Sink& sink, const DrawCommand& cmd, const DrawBounds& clip) const;
+    void redraw(std::vector<std::uint32_t>& pixels, const DrawBounds& rect);
+};
+
+#endif
@@ -0,0 +1,325 @@
+#include "span_shape.h"
+#include <algorithm>
+#include <climits>
+#include <stack>
+#include <utility>
+#include "bitmask.h"
+#include "circle_raster.h"
+#include "constants.h"
+#include "fill.h"
+#include "kernels.h"
+#include "row_executor.h"
+
+void normalize_spans(std::vector<Span>& spans)
+{
+    std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) {
+        return a.y != b.y ? a.y < b.y : a.x0 < b.x0;
+    });
+    std::size_t n = 0;
+    for (const Span& span : spans) {
+        if (n > 0 && spans[n - 1].y == span.y && span.x0 <= spans[n - 1].x1 + 1) {
+            spans[n - 1].x1 = std::max(spans[n - 1].x1, span.x1);
+        } else {
+            spans[n++] = span;
+        }
+    }
+    spans.resize(n);
+}
+
+SpanShape::SpanShape(std::vector<Span> spans)
+    : spans(std::move(spans))
+{
+    normalize_spans(this->spans);
+}
+
+std::size_t SpanShape::get_num_pixels() const
+{
+    std::size_t num_pixels = 0;
+    for (const Span& span : spans) {
+        num_pixels += span.x1 - span.x0 + 1;
+    }
+    return num_pixels;
+}
+
+DrawBounds SpanShape::get_bounds() const
+{
+    if (spans.empty()) {
+        return {0, 0, -1, -1};
+    }
+    DrawBounds bounds = {spans.front().x0, spans.front().y, spans.front().x1, spans.back().y};
+    for (const Span& span : spans) {
+        bounds.x_min = std::min(bounds.x_min, span.x0);
+        bounds.x_max = std::max(bounds.x_max, span.x1);
+    }
+    return bounds;
+}
+
+bool SpanShape::contains(const int x, const int y) const
+{
+    // First span at or after (x, y)
+    const auto found = std::lower_bound(spans.begin(), spans.end(), std::make_pair(x, y), [](const Span& span, const std::pair<int, int>& p) {
+        return span.y != p.second ? span.y < p.second : span.x1 < p.first;
+    });
+    return found != spans.end() && found->y == y && found->x0 <= x;
+}
+
+void SpanShape::translate(const int dx, const int dy)
+{
+    for (Span& span : spans) {
+        span.y += dy;
+        span.x0 += dx;
+        span.x1 += dx;
+    }
+}
+
+template <typename RowOp>
+SpanShape SpanShape::combine(const SpanShape& other, RowOp&& row_op) const
+{
+    const std::vector<Span>& a = spans;
+    const std::vector<Span>& b = other.spans;
+    SpanShape result;
+    result.spans.reserve(a.size() + b.size());
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while (i < a.size() || j < b.size()) {
+        const int y = (j == b.size() || (i < a.size() && a[i].y < b[j].y)) ? a[i].y : b[j].y;
+        std::size_t i_end = i;
+        while (i_end < a.size() && a[i_end].y == y) {
+            i_end++;
+        }
+        std::size_t j_end = j;
+        while (j_end < b.size() && b[j_end].y == y) {
+            j_end++;
+        }
+        row_op(a.data() + i, a.data() + i_end, b.data() + j, b.data() + j_end, y, result.spans);
+        i = i_end;
+        j = j_end;
+    }
+    return result;
+}
+
+SpanShape SpanShape::get_union(const SpanShape& other) const
+{
+    return combine(other, [](const Span* a, const Span* a_end, const Span* b, const Span* b_end, const int y, std::vector<Span>& out) {
+        const std::size_t row_begin = out.size();
+        while (a != a_end || b != b_end) {
+            const Span& next = (b == b_end || (a != a_end && a->x0 < b->x0)) ? *a++ : *b++;
+            if (out.size() > row_begin && next.x0 <= out.back().x1 + 1) {
+                out.back().x1 = std::max(out.back().x1, next.x1);
+            } else {
+                out.push_back({y, next.x0, next.x1});
+            }
+        }
+    });
+}
+
+SpanShape SpanShape::get_intersection(const SpanShape& other) const
+{
+    return combine(other, [](const Span* a, const Span* a_end, const Span* b, const Span* b_end, const int y, std::vector<Span>& out) {
+        while (a != a_end && b != b_end) {
+            const int x0 = std::max(a->x0, b->x0);
+            const int x1 = std::min(a->x1, b->x1);
+            if (x0 <= x1) {
+                out.push_back({y, x0, x1});
+            }
+            // The span ending first cannot overlap anything further on
+            if (a->x1 < b->x1) {
+                a++;
+            } else {
+                b++;
+            }
+        }
+    });
+}
+
+SpanShape SpanShape::get_difference(const SpanShape& other) const
+{
+    return combine(other, [](const Span* a, const Span* a_end, const Span* b, const Span* b_end, const int y, std::vector<Span>& out) {
+        for (; a != a_end; a++) {
+            int x = a->x0;
+            while (b != b_end && b->x1 < x) {
+                b++;
+            }
+            // Cut out every span of b over a; one running past a's end
+            // may cover the next span of a too, so it is kept
+            const Span* cut = b;
+            while (cut != b_end && cut->x0 <= a->x1) {
+                if (cut->x0 > x) {
+                    out.push_back({y, x, cut->x0 - 1});
+                }
+                x = std::max(x, cut->x1 + 1);
+                if (cut->x1 > a->x1) {
+                    break;
+                }
+                cut++;
+            }
+            b = cut;
+            if (x <= a->x1) {
+                out.push_back({y, x, a->x1});
+            }
+        }
+    });
+}
+
+// Keeps the leftmost and rightmost pixel plotted on each row
+class RowExtentSink {
+public:
+    std::vector<int> x_min;
+    std::vector<int> x_max;
+
+    RowExtentSink(const int y_min, const int num_rows)
+        : x_min(num_rows, INT_MAX), x_max(num_rows, INT_MIN), y_min(y_min) {}
+
+    void plot(const int x, const int y)
+    {
+        const int row = y - y_min;
+        x_min[row] = std::min(x_min[row], x);
+        x_max[row] = std::max(x_max[row], x);
+    }
+
+    void span(const int x0, const int x1, const int y)
+    {
+        plot(x0, y);
+        plot(x1, y);
+    }
+
+private:
+    const int y_min;
+};
+
+SpanShape get_circle_shape(const int cx, const int cy, const int radius)
+{
+    SpanShape shape;
+    if (radius < 0) {
+        return shape;
+    }
+    // The outline is 8-connected, so a 4-connected fill from the center
+    // takes every pixel between the two ends of each row
+    RowExtentSink sink(cy - radius, (2 * radius) + 1);
+    rasterize_circle_midpoint(sink, cx, cy, radius);
+    std::vector<Span> spans;
+    spans.reserve(sink.x_min.size());
+    for (std::size_t row = 0; row < sink.x_min.size(); row++) {
+        spans.push_back({cy - radius + static_cast<int>(row), sink.x_min[row], sink.x_max[row]});
+    }
+    return SpanShape(std::move(spans));
+}
+
+SpanShape get_path_shape(const std::vector<PathSegment>& segments)
+{
+    return SpanShape(get_path_spans(segments));
+}
+
+SpanShape get_svg_shape(const std::string& file_path)
+{
+    SpanShape shape;
+    for (const std::string& path : get_paths_from_svg(file_path)) {
+        shape = shape.get_union(get_path_shape(parse_path(path)));
+    }
+    return shape;
+}
+
+SpanShape get_scanline_fill_shape(const std::vector<std::uint32_t>& pixels, const std::uint32_t color)
+{
+    const BoundingRect br = get_bounding_rect(pixels, color);
+    if (br.x_min > br.x_max) {
+        return SpanShape();
+    }
+    // As scanline_fill: each row but the last of the rect, from its first
+    // pixel in color to its last. Bands of rows are scanned in parallel.
+    const Kernels& kernels = get_kernels();
+    const unsigned int width = br.x_max - br.x_min + 1;
+    const auto scan_rows = [&](const int y0, const int y1) {
+        std::vector<Span> spans;
+        for (int y = y0; y < y1; y++) {
+            const std::uint32_t* row = pixels.data() + (y * SCREEN_WIDTH) + br.x_min;
+            const unsigned int first = kernels.find_u32(row, width, color);
+            if (first == width) {
+                continue;
+            }
+            const unsigned int last = kernels.find_last_u32(row, width, color);
+            spans.push_back({y, static_cast<int>(br.x_min + first), static_cast<int>(br.x_min + last)});
+        }
+        return spans;
+    };
+    const auto merge = [](std::vector<Span> a, const std::vector<Span>& b) {
+        a.insert(a.end(), b.begin(), b.end());
+        return a;
+    };
+    return SpanShape(get_row_executor().reduce_bands(br.y_min, br.y_max, sizeof(std::uint32_t) * width, std::vector<Span>(), scan_rows, merge));
+}
+
+SpanShape get_flood_fill_shape(
+    const std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const int x, const int y)
+{
+    if ((x < 0) || (x >= SCREEN_WIDTH) || (y < 0) || (y >= SCREEN_HEIGHT)) {
+        return SpanShape();
+    }
+    // A row span at a time, as the TiledCanvas flood fill, with a mask
+    // of the pixels taken so far in place of writing them
+    BitMask taken(SCREEN_WIDTH, SCREEN_HEIGHT);
+    const auto is_open = [&](const int px, const int py) {
+        return pixels[(py * SCREEN_WIDTH) + px] != color && !taken.test(px, py);
+    };
+    std::vector<Span> spans;
+    std::stack<std::pair<int, int>> seeds;
+    seeds.push({x, y});
+    while (!seeds.empty()) {
+        const auto [sx, sy] = seeds.top();
+        seeds.pop();
+        if (!is_open(sx, sy)) {
+            continue;
+        }
+        int x0 = sx;
+        while (x0 > 0 && is_open(x0 - 1, sy)) {
+            x0--;
+        }
+        int x1 = sx;
+        while (x1 < SCREEN_WIDTH - 1 && is_open(x1 + 1, sy)) {
+            x1++;
+        }
+        taken.set_span(x0, x1, sy);
+        spans.push_back({sy, x0, x1});
+
+        // One seed for each open run above and below
+        for (const int ny : {sy - 1, sy + 1}) {
+            if (ny < 0 || ny >= SCREEN_HEIGHT) {
+                continue;
+            }
+            bool in_run = false;
+            for (int nx = x0; nx <= x1; nx++) {
+                const bool open = is_open(nx, ny);
+                if (open && !in_run) {
+                    seeds.push({nx, ny});
+                }
+                in_run = open;
+            }
+        }
+    }
+    return SpanShape(std::move(spans));
+}
+
+void draw_shape(std::vector<std::uint32_t>& pixels, const std::uint32_t color, const SpanShape& shape)
+{
+    const std::vector<Span>& spans = shape.get_spans();
+    if (spans.empty()) {
+        return;
+    }
+    const int y_begin = std::max(spans.front().y, 0);
+    const int y_end = std::min(spans.back().y + 1, SCREEN_HEIGHT);
+    get_row_executor().for_each_band(y_begin, y_end, TEXTURE_PITCH, [&](const int y0, const int y1) {
+        UncheckedSink sink(pixels, color);
+        auto span = std::lower_bound(spans.begin(), spans.end(), y0, [](const Span& s, const int row) {
+            return s.y < row;
+        });
+        for (; span != spans.end() && span->y < y1; span++) {
+            const int x0 = std::max(span->x0, 0);
+            const int x1 = std::min(span->x1, SCREEN_WIDTH - 1);
+            if (x0 <= x1) {
+                sink.span(x0, x1, span->y);
+            }
+        }
+    });
+}
@@ -0,0 +1,78 @@
+#ifndef SPAN_SHAPE_H
+#define SPAN_SHAPE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "display_list.h"
+#include "pixel_sink.h"
+#include "svg.h"
+
+// Sorts spans by row then x and merges those that overlap or touch
+void normalize_spans(std::vector<Span>& spans);
+
+// A set of pixels kept as runs instead of written to a frame: spans
+// sorted by row then x, none overlapping or touching. A filled shape
+// takes a span or two per row, so memory grows with its edges rather
+// than its area, and shapes can be combined, moved and drawn again
+// without rasterizing them again. Shapes are not limited to the screen;
+// drawing clips them to it.
+class SpanShape {
+public:
+    SpanShape() = default;
+    // Spans in any order, possibly overlapping
+    explicit SpanShape(std::vector<Span> spans);
+
+    bool is_empty() const { return spans.empty(); }
+    const std::vector<Span>& get_spans() const { return spans; }
+    std::size_t get_num_pixels() const;
+    // {0, 0, -1, -1} for an empty shape
+    DrawBounds get_bounds() const;
+    bool contains(const int x, const int y) const;
+
+    void translate(const int dx, const int dy);
+
+    // Boolean operations, merging the spans of the two shapes row by row
+    SpanShape get_union(const SpanShape& other) const;
+    SpanShape get_intersection(const SpanShape& other) const;
+    // Pixels of this shape not in other
+    SpanShape get_difference(const SpanShape& other) const;
+
+private:
+    std::vector<Span> spans;
+
+    // Calls row_op(a, a_end, b, b_end, y, spans) for every row in either
+    // shape, with the spans of that row of each shape, possibly none
+    template <typename RowOp>
+    SpanShape combine(const SpanShape& other, RowOp&& row_op) const;
+};
+
+// Shapes of what the fill routines would write. Drawing one in the same
+// color has the same effect as the call named.
+
+// draw_circle_midpoint, then flood_fill_stack from the center
+SpanShape get_circle_shape(const int cx, const int cy, const int radius);
+
+// fill_path_segments_clipped
+SpanShape get_path_shape(const std::vector<PathSegment>& segments);
+
+// draw_svg
+SpanShape get_svg_shape(const std::string& file_path);
+
+// scanline_fill(pixels, color)
+SpanShape get_scanline_fill_shape(const std::vector<std::uint32_t>& pixels, const std::uint32_t color);
+
+// flood_fill_stack(pixels, color, x, y), except that the fill does not
+// wrap around from one edge of the screen to the other
+SpanShape get_flood_fill_shape(
+    const std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const int x, const int y
+);
+
+// Writes the pixels of a shape that are on the screen, in row bands on
+// the row executor
+void draw_shape(std::vector<std::uint32_t>& pixels, const std::uint32_t color, const SpanShape& shape);
+
+#endif
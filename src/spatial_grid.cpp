@@ -0,0 +1,177 @@
+#include "spatial_grid.h"
+#include <algorithm>
+#include "constants.h"
+
+// Results up to this many are ordered with a sort
+constexpr std::size_t SORTED_QUERY_LIMIT = 64;
+
+SpatialGrid::SpatialGrid(const int cell_size)
+    : cell_size(cell_size),
+      columns((SCREEN_WIDTH + cell_size - 1) / cell_size),
+      rows((SCREEN_HEIGHT + cell_size - 1) / cell_size),
+      cells(static_cast<std::size_t>(columns) * rows)
+{
+}
+
+// Cells covered by bounds, as inclusive column and row ranges
+DrawBounds SpatialGrid::get_cell_range(const DrawBounds& bounds) const
+{
+    return {
+        std::clamp(bounds.x_min / cell_size, 0, columns - 1),
+        std::clamp(bounds.y_min / cell_size, 0, rows - 1),
+        std::clamp(bounds.x_max / cell_size, 0, columns - 1),
+        std::clamp(bounds.y_max / cell_size, 0, rows - 1)
+    };
+}
+
+void SpatialGrid::build(const std::vector<DrawBounds>& bounds)
+{
+    clear();
+    std::vector<std::size_t> counts(cells.size(), 0);
+    for (const DrawBounds& b : bounds) {
+        const DrawBounds range = get_cell_range(b);
+        for (int row = range.y_min; row <= range.y_max; row++) {
+            for (int column = range.x_min; column <= range.x_max; column++) {
+                counts[(row * columns) + column]++;
+            }
+        }
+    }
+    for (std::size_t c = 0; c < cells.size(); c++) {
+        cells[c].reserve(counts[c]);
+    }
+    item_bounds = bounds;
+    present.assign(bounds.size(), true);
+    for (std::size_t id = 0; id < bounds.size(); id++) {
+        const DrawBounds range = get_cell_range(bounds[id]);
+        for (int row = range.y_min; row <= range.y_max; row++) {
+            for (int column = range.x_min; column <= range.x_max; column++) {
+                cells[(row * columns) + column].push_back({bounds[id], static_cast<std::uint32_t>(id)});
+            }
+        }
+    }
+}
+
+void SpatialGrid::clear()
+{
+    for (std::vector<GridEntry>& cell : cells) {
+        cell.clear();
+    }
+    item_bounds.clear();
+    present.clear();
+}
+
+void SpatialGrid::insert(const std::uint32_t id, const DrawBounds& bounds)
+{
+    if (id >= item_bounds.size()) {
+        item_bounds.resize(id + 1);
+        present.resize(id + 1, false);
+    }
+    if (present[id]) {
+        remove(id);
+    }
+    item_bounds[id] = bounds;
+    present[id] = true;
+    const DrawBounds range = get_cell_range(bounds);
+    for (int row = range.y_min; row <= range.y_max; row++) {
+        for (int column = range.x_min; column <= range.x_max; column++) {
+            cells[(row * columns) + column].push_back({bounds, id});
+        }
+    }
+}
+
+void SpatialGrid::remove(const std::uint32_t id)
+{
+    if (!contains(id)) {
+        return;
+    }
+    const DrawBounds range = get_cell_range(item_bounds[id]);
+    for (int row = range.y_min; row <= range.y_max; row++) {
+        for (int column = range.x_min; column <= range.x_max; column++) {
+            std::vector<GridEntry>& cell = cells[(row * columns) + column];
+            const auto it = std::find_if(cell.begin(), cell.end(), [id](const GridEntry& entry) {
+                return entry.id == id;
+            });
+            if (it != cell.end()) {
+                *it = cell.back();
+                cell.pop_back();
+            }
+        }
+    }
+    present[id] = false;
+}
+
+void SpatialGrid::update(const std::uint32_t id, const DrawBounds& bounds)
+{
+    if (contains(id)) {
+        const DrawBounds old_range = get_cell_range(item_bounds[id]);
+        const DrawBounds new_range = get_cell_range(bounds);
+        if (old_range.x_min == new_range.x_min && old_range.y_min == new_range.y_min
+            && old_range.x_max == new_range.x_max && old_range.y_max == new_range.y_max) {
+            // Same cells: only the stored bounds change
+            item_bounds[id] = bounds;
+            for (int row = new_range.y_min; row <= new_range.y_max; row++) {
+                for (int column = new_range.x_min; column <= new_range.x_max; column++) {
+                    for (GridEntry& entry : cells[(row * columns) + column]) {
+                        if (entry.id == id) {
+                            entry.bounds = bounds;
+                            break;
+                        }
+                    }
+                }
+            }
+            return;
+        }
+    }
+    insert(id, bounds);
+}
+
+bool SpatialGrid::contains(const std::uint32_t id) const
+{
+    return id < present.size() && present[id];
+}
+
+void SpatialGrid::query(const DrawBounds& rect, std::vector<std::uint32_t>& ids) const
+{
+    const std::size_t first = ids.size();
+    const DrawBounds range = get_cell_range(rect);
+    for (int row = range.y_min; row <= range.y_max; row++) {
+        for (int column = range.x_min; column <= range.x_max; column++) {
+            for (const GridEntry& entry : cells[(row * columns) + column]) {
+                const DrawBounds& b = entry.bounds;
+                if (b.x_min > rect.x_max || rect.x_min > b.x_max || b.y_min > rect.y_max || rect.y_min > b.y_max) {
+                    continue;
+                }
+                // An item in several of the cells is only reported from
+                // the first of them the query covers
+                if ((column == range.x_min || b.x_min >= column * cell_size)
+                    && (row == range.y_min || b.y_min >= row * cell_size)) {
+                    ids.push_back(entry.id);
+                }
+            }
+        }
+    }
+
+    if (ids.size() - first <= SORTED_QUERY_LIMIT) {
+        std::sort(ids.begin() + first, ids.end());
+        return;
+    }
+    // Many results: put them in order by marking them in a bitmap of all
+    // ids and reading it back, which is linear rather than n log n
+    std::vector<std::uint64_t> marks((item_bounds.size() + 63) / 64, 0);
+    for (std::size_t i = first; i < ids.size(); i++) {
+        marks[ids[i] >> 6] |= std::uint64_t{1} << (ids[i] & 63);
+    }
+    ids.resize(first);
+    for (std::size_t w = 0; w < marks.size(); w++) {
+        std::uint64_t bits = marks[w];
+        while (bits != 0) {
+            ids.push_back(static_cast<std::uint32_t>((w * 64) + __builtin_ctzll(bits)));
+            bits &= bits - 1;
+        }
+    }
+}
+
+void SpatialGrid::query_point(const int x, const int y, std::vector<std::uint32_t>& ids) const
+{
+    query({x, y, x, y}, ids);
+}
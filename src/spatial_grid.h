@@ -0,0 +1,46 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <cstdint>
+#include <vector>
+#include "display_list.h"
+
+// Uniform grid of square cells over the screen, each listing the ids
+// whose bounds overlap it. Bounds reaching past the screen are kept in
+// the border cells. Ids index a dense table, so they should be small.
+class SpatialGrid {
+public:
+    explicit SpatialGrid(const int cell_size = 64);
+
+    // Replaces the contents with id i for bounds[i], sizing every cell
+    // once up front
+    void build(const std::vector<DrawBounds>& bounds);
+    void clear();
+
+    void insert(const std::uint32_t id, const DrawBounds& bounds);
+    void remove(const std::uint32_t id);
+    void update(const std::uint32_t id, const DrawBounds& bounds);
+    bool contains(const std::uint32_t id) const;
+
+    // Appends the ids whose bounds intersect rect, in increasing order
+    void query(const DrawBounds& rect, std::vector<std::uint32_t>& ids) const;
+    void query_point(const int x, const int y, std::vector<std::uint32_t>& ids) const;
+
+private:
+    // Bounds are stored with the id so queries read cells sequentially
+    struct GridEntry {
+        DrawBounds bounds;
+        std::uint32_t id;
+    };
+
+    int cell_size;
+    int columns;
+    int rows;
+    std::vector<std::vector<GridEntry>> cells;
+    std::vector<DrawBounds> item_bounds;
+    std::vector<bool> present;
+
+    DrawBounds get_cell_range(const DrawBounds& bounds) const;
+};
+
+#endif
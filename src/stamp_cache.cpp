@@ -0,0 +1,208 @@
+#include "stamp_cache.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include "bezier_raster.h"
+#include "circle_raster.h"
+#include "constants.h"
+#include "span_shape.h"
+
+// Collects the pixels of a shape drawn around (ox, oy), relative to
+// that point. It has no edges, so no part of the shape is clipped.
+class StampSink {
+public:
+    SpanCollector collector;
+
+    StampSink(const int ox, const int oy) : ox(ox), oy(oy) {}
+
+    int get_width() const { return INT_MAX; }
+    int get_height() const { return INT_MAX; }
+
+    void plot(const int x, const int y)
+    {
+        collector.plot(x - ox, y - oy);
+    }
+
+    void span(const int x0, const int x1, const int y)
+    {
+        collector.span(x0 - ox, x1 - ox, y - oy);
+    }
+
+private:
+    const int ox;
+    const int oy;
+};
+
+constexpr int SHORT_SPAN = 16;
+
+static void blit_spans(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const std::vector<Span>& spans,
+    const DrawBounds& bounds,
+    const int x, const int y)
+{
+    if (x + bounds.x_max < 0 || y + bounds.y_max < 0 || x + bounds.x_min >= SCREEN_WIDTH || y + bounds.y_min >= SCREEN_HEIGHT) {
+        return;
+    }
+    UncheckedSink sink(pixels, color);
+    std::uint32_t* const data = pixels.data();
+    for (const Span& span : spans) {
+        const int sy = y + span.y;
+        if (sy < 0 || sy >= SCREEN_HEIGHT) {
+            continue;
+        }
+        const int x0 = std::max(x + span.x0, 0);
+        const int x1 = std::min(x + span.x1, SCREEN_WIDTH - 1);
+        // Marker spans are mostly a few pixels, too short to be worth
+        // the call to the fill kernel
+        if (x1 - x0 < SHORT_SPAN) {
+            for (int sx = x0; sx <= x1; sx++) {
+                data[(sy * SCREEN_WIDTH) + sx] = color;
+            }
+        } else {
+            sink.span(x0, x1, sy);
+        }
+    }
+}
+
+std::size_t StampCache::StampKeyHash::operator()(const StampKey& key) const
+{
+    std::size_t h = static_cast<std::size_t>(key.shape);
+    const auto combine = [&h](const std::uint32_t v) {
+        h ^= v + 0x9E3779B9 + (h << 6) + (h >> 2);
+    };
+    for (const int v : key.i) {
+        combine(static_cast<std::uint32_t>(v));
+    }
+    for (const float v : key.f) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        combine(bits);
+    }
+    return h;
+}
+
+StampCache::StampCache(const std::size_t max_spans)
+    : max_spans(max_spans), num_spans(0), stats{0, 0, 0}
+{
+}
+
+double StampCache::get_hit_rate() const
+{
+    const std::uint64_t draws = stats.hits + stats.misses;
+    return draws > 0 ? static_cast<double>(stats.hits) / draws : 0.0;
+}
+
+void StampCache::clear()
+{
+    stamps.clear();
+    stamp_list.clear();
+    num_spans = 0;
+}
+
+void StampCache::reset_stats()
+{
+    stats = {0, 0, 0};
+}
+
+// rasterize(sink) draws the shape into a StampSink
+template <typename Rasterize>
+void StampCache::draw(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const StampKey& key,
+    const int x, const int y,
+    Rasterize&& rasterize)
+{
+    const auto found = stamps.find(key);
+    if (found != stamps.end()) {
+        stats.hits++;
+        stamp_list.splice(stamp_list.begin(), stamp_list, found->second);
+        const Stamp& stamp = *found->second;
+        blit_spans(pixels, color, stamp.spans, stamp.bounds, x, y);
+        return;
+    }
+
+    stats.misses++;
+    Stamp stamp{key, {}, {0, 0, -1, -1}};
+    rasterize(stamp.spans);
+    normalize_spans(stamp.spans);
+    if (!stamp.spans.empty()) {
+        stamp.bounds = {stamp.spans.front().x0, stamp.spans.front().y, stamp.spans.front().x1, stamp.spans.back().y};
+        for (const Span& span : stamp.spans) {
+            stamp.bounds.x_min = std::min(stamp.bounds.x_min, span.x0);
+            stamp.bounds.x_max = std::max(stamp.bounds.x_max, span.x1);
+        }
+    }
+    blit_spans(pixels, color, stamp.spans, stamp.bounds, x, y);
+    if (stamp.spans.size() > max_spans) {
+        return;
+    }
+
+    while (num_spans + stamp.spans.size() > max_spans) {
+        const Stamp& oldest = stamp_list.back();
+        num_spans -= oldest.spans.size();
+        stamps.erase(oldest.key);
+        stamp_list.pop_back();
+        stats.evictions++;
+    }
+    num_spans += stamp.spans.size();
+    stamp_list.push_front(std::move(stamp));
+    stamps.emplace(key, stamp_list.begin());
+}
+
+void StampCache::draw_circle(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const int cx, const int cy,
+    const int radius)
+{
+    const StampKey key = {StampShape::circle, {radius}, {}};
+    draw(pixels, color, key, cx, cy, [&](std::vector<Span>& spans) {
+        StampSink sink(0, 0);
+        rasterize_circle_midpoint(sink, 0, 0, radius);
+        spans = std::move(sink.collector.spans);
+    });
+}
+
+void StampCache::draw_bezier_quad(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const int x0, const int y0,
+    const int x1, const int y1,
+    const int x2, const int y2)
+{
+    const StampKey key = {StampShape::bezier_quad, {x1 - x0, y1 - y0, x2 - x0, y2 - y0}, {}};
+    draw(pixels, color, key, x0, y0, [&](std::vector<Span>& spans) {
+        // Drawn with the hull of the control points at the origin
+        const int ox = -std::min({0, key.i[0], key.i[2]});
+        const int oy = -std::min({0, key.i[1], key.i[3]});
+        StampSink sink(ox, oy);
+        rasterize_bezier_quad(sink, ox, oy, ox + key.i[0], oy + key.i[1], ox + key.i[2], oy + key.i[3]);
+        spans = std::move(sink.collector.spans);
+    });
+}
+
+void StampCache::draw_bezier_cubic(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const int x0, const int y0,
+    const float x1, const float y1,
+    const float x2, const float y2,
+    const int x3, const int y3)
+{
+    if (!std::isfinite(x1) || !std::isfinite(y1) || !std::isfinite(x2) || !std::isfinite(y2)) {
+        return;
+    }
+    // Adding zero turns -0.0f into 0.0f, so equal offsets have one key
+    const StampKey key = {StampShape::bezier_cubic, {x3 - x0, y3 - y0}, {(x1 - x0) + 0.0f, (y1 - y0) + 0.0f, (x2 - x0) + 0.0f, (y2 - y0) + 0.0f}};
+    draw(pixels, color, key, x0, y0, [&](std::vector<Span>& spans) {
+        const int ox = -static_cast<int>(std::floor(std::min({0.0f, key.f[0], key.f[2], static_cast<float>(key.i[0])})));
+        const int oy = -static_cast<int>(std::floor(std::min({0.0f, key.f[1], key.f[3], static_cast<float>(key.i[1])})));
+        StampSink sink(ox, oy);
+        rasterize_bezier_cubic(sink, ox, oy, ox + key.f[0], oy + key.f[1], ox + key.f[2], oy + key.f[3], ox + key.i[0], oy + key.i[1]);
+        spans = std::move(sink.collector.spans);
+    });
+}
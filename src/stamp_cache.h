@@ -0,0 +1,120 @@
+#ifndef STAMP_CACHE_H
+#define STAMP_CACHE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "display_list.h"
+#include "pixel_sink.h"
+
+struct StampCacheStats {
+    std::uint64_t hits;
+    std::uint64_t misses;
+    std::uint64_t evictions;
+};
+
+// Caches the pixels of small primitives drawn over and over at different
+// positions, such as plot markers. The first draw of a shape rasterizes
+// it into spans relative to its anchor (the center of a circle, the
+// first point of a Bezier), sorted by row and merged so each pixel is
+// written once; later draws only copy the spans, translated and clipped
+// to the screen.
+//
+// Shapes are keyed by their parameters relative to the anchor. Anchors
+// are whole pixels, so every draw of a shape has the same subpixel phase
+// and one stamp serves all positions. Circles match draw_circle_midpoint
+// exactly. Beziers are rasterized with their control points' hull at the
+// origin, so float rounding can move a few pixels compared to drawing
+// them in place. Cubics with a control point that is not finite are
+// not drawn.
+//
+// The stamps take up to max_spans spans in all. The least recently used
+// ones are evicted to make room, and a shape too large for the cache is
+// drawn without being kept.
+class StampCache {
+public:
+    static constexpr std::size_t DEFAULT_MAX_SPANS = std::size_t{1} << 20;
+
+    explicit StampCache(const std::size_t max_spans = DEFAULT_MAX_SPANS);
+
+    void draw_circle(
+        std::vector<std::uint32_t>& pixels,
+        const std::uint32_t color,
+        const int cx, const int cy,
+        const int radius
+    );
+
+    void draw_bezier_quad(
+        std::vector<std::uint32_t>& pixels,
+        const std::uint32_t color,
+        const int x0, const int y0,
+        const int x1, const int y1,
+        const int x2, const int y2
+    );
+
+    void draw_bezier_cubic(
+        std::vector<std::uint32_t>& pixels,
+        const std::uint32_t color,
+        const int x0, const int y0,
+        const float x1, const float y1,
+        const float x2, const float y2,
+        const int x3, const int y3
+    );
+
+    std::size_t get_num_stamps() const { return stamps.size(); }
+    std::size_t get_num_spans() const { return num_spans; }
+    const StampCacheStats& get_stats() const { return stats; }
+    // Fraction of draws served from the cache
+    double get_hit_rate() const;
+
+    // Drops all stamps; the stats are kept
+    void clear();
+    void reset_stats();
+
+private:
+    enum class StampShape : std::uint8_t {
+        circle,
+        bezier_quad,
+        bezier_cubic
+    };
+
+    struct StampKey {
+        StampShape shape;
+        std::array<int, 6> i;
+        std::array<float, 4> f;
+
+        // Floats are compared by bit pattern, as they are hashed, so
+        // that every key equals itself; keys hold no -0.0f
+        bool operator==(const StampKey& other) const
+        {
+            return shape == other.shape && i == other.i && std::memcmp(f.data(), other.f.data(), sizeof(f)) == 0;
+        }
+    };
+
+    struct StampKeyHash {
+        std::size_t operator()(const StampKey& key) const;
+    };
+
+    struct Stamp {
+        StampKey key;
+        // Relative to the anchor
+        std::vector<Span> spans;
+        DrawBounds bounds;
+    };
+
+    std::size_t max_spans;
+    std::size_t num_spans;
+    StampCacheStats stats;
+    // Most recently used first
+    std::list<Stamp> stamp_list;
+    std::unordered_map<StampKey, std::list<Stamp>::iterator, StampKeyHash> stamps;
+
+    template <typename Rasterize>
+    void draw(std::vector<std::uint32_t>& pixels, const std::uint32_t color, const StampKey& key, const int x, const int y, Rasterize&& rasterize);
+};
+
+#endif
@@ -0,0 +1,387 @@
+#include "stroke.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <initializer_list>
+#include "constants.h"
+#include "instrument.h"
+
+struct Vec2 {
+    double x;
+    double y;
+};
+
+// Non-horizontal polygon edge with precomputed inverse slope
+struct StrokeEdge {
+    double y0;
+    double y1;
+    double x0;
+    double dxdy;
+};
+
+// A convex polygon when num_edges > 0, otherwise a disc. A disc with a
+// non-zero facing direction is cut to the half ahead of its center.
+struct StrokePiece {
+    std::array<StrokeEdge, 4> edges;
+    int num_edges;
+    Vec2 center;
+    double radius;
+    Vec2 facing;
+    double y_min;
+    double y_max;
+};
+
+// Inclusive pixel range on one scanline
+struct StrokeSpan {
+    int x0;
+    int x1;
+};
+
+static StrokePiece make_polygon(std::initializer_list<Vec2> verts)
+{
+    StrokePiece piece{};
+    piece.y_min = verts.begin()->y;
+    piece.y_max = verts.begin()->y;
+    const Vec2* prev = verts.end() - 1;
+    for (const Vec2* v = verts.begin(); v != verts.end(); prev = v++) {
+        piece.y_min = std::min(piece.y_min, v->y);
+        piece.y_max = std::max(piece.y_max, v->y);
+        if (prev->y == v->y) {
+            continue;
+        }
+        const Vec2* top = prev->y < v->y ? prev : v;
+        const Vec2* bottom = prev->y < v->y ? v : prev;
+        piece.edges.at(piece.num_edges++) = {
+            top->y,
+            bottom->y,
+            top->x,
+            (bottom->x - top->x) / (bottom->y - top->y)
+        };
+    }
+    return piece;
+}
+
+static StrokePiece make_disc(const Vec2 center, const double radius, const Vec2 facing = {0, 0})
+{
+    StrokePiece piece{};
+    piece.center = center;
+    piece.radius = radius;
+    piece.facing = facing;
+    piece.y_min = center.y - radius;
+    piece.y_max = center.y + radius;
+    return piece;
+}
+
+// Horizontal extent of a piece along the scanline through yc.
+static bool get_piece_extent(const StrokePiece& piece, const double yc, double& xl, double& xr)
+{
+    if (piece.num_edges == 0) {
+        const double dy = yc - piece.center.y;
+        const double d = (piece.radius * piece.radius) - (dy * dy);
+        if (d < 0) {
+            return false;
+        }
+        const double half = std::sqrt(d);
+        xl = piece.center.x - half;
+        xr = piece.center.x + half;
+        if (piece.facing.x == 0 && piece.facing.y == 0) {
+            return true;
+        }
+        // Keep facing . (p - center) >= -1; the pixel of slack behind the
+        // center avoids cracks against the segment body
+        const double along = (piece.facing.y * dy) + 1.0;
+        if (std::fabs(piece.facing.x) < 1e-9) {
+            return along >= 0;
+        }
+        const double bound = piece.center.x - (along / piece.facing.x);
+        if (piece.facing.x > 0) {
+            xl = std::max(xl, bound);
+        } else {
+            xr = std::min(xr, bound);
+        }
+        return xl <= xr;
+    }
+
+    bool found = false;
+    for (int i = 0; i < piece.num_edges; i++) {
+        const StrokeEdge& e = piece.edges[i];
+        // Half-open on y so that shared vertices are only counted once
+        if (e.y0 <= yc && yc < e.y1) {
+            const double x = e.x0 + ((yc - e.y0) * e.dxdy);
+            if (!found) {
+                xl = x;
+                xr = x;
+                found = true;
+            } else {
+                xl = std::min(xl, x);
+                xr = std::max(xr, x);
+            }
+        }
+    }
+    return found;
+}
+
+// Sink gets the merged spans of each row, in row order
+template <typename Sink>
+static void rasterize_pieces(Sink& sink, std::vector<StrokePiece>& pieces)
+{
+    if (pieces.empty()) {
+        return;
+    }
+
+    std::sort(pieces.begin(), pieces.end(), [](const StrokePiece& a, const StrokePiece& b) {
+        return a.y_min < b.y_min;
+    });
+    double y_max = pieces.front().y_max;
+    for (const StrokePiece& piece : pieces) {
+        y_max = std::max(y_max, piece.y_max);
+    }
+
+    // Pixel rows whose centers lie within [y_min, y_max)
+    const int y_start = std::ceil(std::clamp(pieces.front().y_min, -1.0, static_cast<double>(SCREEN_HEIGHT)) - 0.5);
+    const int y_end = std::ceil(std::clamp(y_max, -1.0, static_cast<double>(SCREEN_HEIGHT)) - 0.5);
+
+    std::vector<const StrokePiece*> active;
+    std::vector<StrokeSpan> spans;
+    std::size_t next = 0;
+    for (int y = std::max(y_start, 0); y < y_end; y++) {
+        const double yc = y + 0.5;
+        while (next < pieces.size() && pieces[next].y_min <= yc) {
+            active.push_back(&pieces[next++]);
+        }
+        active.erase(std::remove_if(active.begin(), active.end(), [yc](const StrokePiece* p) {
+            return p->y_max < yc;
+        }), active.end());
+
+        spans.clear();
+        for (const StrokePiece* piece : active) {
+            double xl;
+            double xr;
+            if (!get_piece_extent(*piece, yc, xl, xr)) {
+                continue;
+            }
+            // Pixel columns whose centers lie within [xl, xr)
+            const int x0 = std::max(0, static_cast<int>(std::ceil(std::clamp(xl, -1.0, static_cast<double>(SCREEN_WIDTH)) - 0.5)));
+            const int x1 = std::min(SCREEN_WIDTH, static_cast<int>(std::ceil(std::clamp(xr, -1.0, static_cast<double>(SCREEN_WIDTH)) - 0.5))) - 1;
+            if (x0 <= x1) {
+                spans.push_back({x0, x1});
+            }
+            if (xl < 0 || xr > SCREEN_WIDTH) {
+                INSTRUMENT_ADD(stroke, clipped, 1);
+            }
+        }
+        if (spans.empty()) {
+            continue;
+        }
+
+        // Merge overlapping and adjacent spans so each pixel is written once
+        if (spans.size() > 1) {
+            std::sort(spans.begin(), spans.end(), [](const StrokeSpan& a, const StrokeSpan& b) {
+                return a.x0 < b.x0;
+            });
+        }
+        StrokeSpan current = spans.front();
+        for (std::size_t i = 1; i < spans.size(); i++) {
+            if (spans[i].x0 <= current.x1 + 1) {
+                current.x1 = std::max(current.x1, spans[i].x1);
+            } else {
+                sink.span(current.x0, current.x1, y);
+                INSTRUMENT_ADD(stroke, pixels, current.x1 - current.x0 + 1);
+                current = spans[i];
+            }
+        }
+        sink.span(current.x0, current.x1, y);
+        INSTRUMENT_ADD(stroke, pixels, current.x1 - current.x0 + 1);
+    }
+}
+
+static Vec2 get_unit_vector(const Vec2 a, const Vec2 b)
+{
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    const double len = std::sqrt((dx * dx) + (dy * dy));
+    return {dx / len, dy / len};
+}
+
+static void add_join(
+    std::vector<StrokePiece>& pieces,
+    const Vec2 prev, const Vec2 p, const Vec2 next,
+    const double half_width,
+    const StrokeStyle& style)
+{
+    if (style.join == LineJoin::round) {
+        pieces.push_back(make_disc(p, half_width));
+        return;
+    }
+
+    const Vec2 d0 = get_unit_vector(prev, p);
+    const Vec2 d1 = get_unit_vector(p, next);
+    const double cross = (d0.x * d1.y) - (d0.y * d1.x);
+    const double dot = (d0.x * d1.x) + (d0.y * d1.y);
+    if (std::fabs(cross) < 1e-9) {
+        // Collinear or fully reversed: the segment ends already meet
+        return;
+    }
+
+    // Offsets to the outer side of the turn
+    const double s = cross > 0 ? -half_width : half_width;
+    const Vec2 o0 = {p.x - (s * d0.y), p.y + (s * d0.x)};
+    const Vec2 o1 = {p.x - (s * d1.y), p.y + (s * d1.x)};
+
+    // Miter length / stroke width = 1 / cos(a / 2),
+    // where a is the angle between the segment normals
+    const double miter_ratio = std::sqrt(2.0 / (1.0 + dot));
+    if (style.join == LineJoin::miter && miter_ratio <= style.miter_limit) {
+        const Vec2 m = {
+            p.x + ((o0.x - p.x + o1.x - p.x) / (1.0 + dot)),
+            p.y + ((o0.y - p.y + o1.y - p.y) / (1.0 + dot))
+        };
+        pieces.push_back(make_polygon({p, o0, m, o1}));
+    } else {
+        pieces.push_back(make_polygon({p, o0, o1}));
+    }
+}
+
+void draw_stroke_line(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const int ax, const int ay,
+    const int bx, const int by,
+    const StrokeStyle& style)
+{
+    draw_stroke_polyline(pixels, color, {{ax, ay}, {bx, by}}, style);
+}
+
+void draw_stroke_polyline(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const std::vector<Point>& points,
+    const StrokeStyle& style)
+{
+    INSTRUMENT_SCOPE(stroke);
+    const double half_width = style.width / 2.0;
+    if (half_width <= 0) {
+        return;
+    }
+
+    // Work with pixel centers and drop repeated points
+    std::vector<Vec2> pts;
+    pts.reserve(points.size());
+    for (const Point& point : points) {
+        const Vec2 v = {point.x + 0.5, point.y + 0.5};
+        if (pts.empty() || pts.back().x != v.x || pts.back().y != v.y) {
+            pts.push_back(v);
+        }
+    }
+    if (pts.empty()) {
+        return;
+    }
+
+    std::vector<StrokePiece> pieces;
+    if (pts.size() == 1) {
+        // Zero-length stroke: only the caps are visible
+        const Vec2 c = pts.front();
+        if (style.cap == LineCap::round) {
+            pieces.push_back(make_disc(c, half_width));
+        } else if (style.cap == LineCap::square) {
+            pieces.push_back(make_polygon({
+                {c.x - half_width, c.y - half_width},
+                {c.x + half_width, c.y - half_width},
+                {c.x + half_width, c.y + half_width},
+                {c.x - half_width, c.y + half_width}
+            }));
+        }
+        UncheckedSink sink(pixels, color);
+        rasterize_pieces(sink, pieces);
+        return;
+    }
+
+    const std::size_t num_segs = pts.size() - 1;
+    pieces.reserve((2 * num_segs) + 1);
+    for (std::size_t i = 0; i < num_segs; i++) {
+        Vec2 a = pts[i];
+        Vec2 b = pts[i + 1];
+        const Vec2 d = get_unit_vector(a, b);
+        if (style.cap == LineCap::square) {
+            if (i == 0) {
+                a = {a.x - (d.x * half_width), a.y - (d.y * half_width)};
+            }
+            if (i == num_segs - 1) {
+                b = {b.x + (d.x * half_width), b.y + (d.y * half_width)};
+            }
+        }
+        const double nx = -d.y * half_width;
+        const double ny = d.x * half_width;
+        pieces.push_back(make_polygon({
+            {a.x + nx, a.y + ny},
+            {b.x + nx, b.y + ny},
+            {b.x - nx, b.y - ny},
+            {a.x - nx, a.y - ny}
+        }));
+    }
+
+    if (style.cap == LineCap::round) {
+        pieces.push_back(make_disc(pts.front(), half_width));
+        pieces.push_back(make_disc(pts.back(), half_width));
+    }
+
+    for (std::size_t i = 1; i < num_segs; i++) {
+        add_join(pieces, pts[i - 1], pts[i], pts[i + 1], half_width, style);
+    }
+
+    UncheckedSink sink(pixels, color);
+    rasterize_pieces(sink, pieces);
+}
+
+void get_stroke_extension_spans(
+    std::vector<Span>& spans,
+    const std::vector<PointF>& points,
+    const double width,
+    const bool start_cap)
+{
+    INSTRUMENT_SCOPE(stroke);
+    const double half_width = width / 2.0;
+    if (half_width <= 0) {
+        return;
+    }
+
+    std::vector<Vec2> pts;
+    pts.reserve(points.size());
+    for (const PointF& point : points) {
+        const Vec2 v = {point.x + 0.5, point.y + 0.5};
+        if (pts.empty() || pts.back().x != v.x || pts.back().y != v.y) {
+            pts.push_back(v);
+        }
+    }
+    if (pts.empty()) {
+        return;
+    }
+
+    std::vector<StrokePiece> pieces;
+    if (start_cap) {
+        pieces.push_back(make_disc(pts.front(), half_width));
+    }
+    for (std::size_t i = 0; i + 1 < pts.size(); i++) {
+        const Vec2 a = pts[i];
+        const Vec2 b = pts[i + 1];
+        const Vec2 d = get_unit_vector(a, b);
+        const double nx = -d.y * half_width;
+        const double ny = d.x * half_width;
+        pieces.push_back(make_polygon({
+            {a.x + nx, a.y + ny},
+            {b.x + nx, b.y + ny},
+            {b.x - nx, b.y - ny},
+            {a.x - nx, a.y - ny}
+        }));
+        if (i + 2 < pts.size()) {
+            pieces.push_back(make_disc(b, half_width));
+        } else {
+            pieces.push_back(make_disc(b, half_width, d));
+        }
+    }
+
+    SpanCollector collector;
+    collector.spans.swap(spans);
+    rasterize_pieces(collector, pieces);
+    collector.spans.swap(spans);
+}
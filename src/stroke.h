@@ -0,0 +1,76 @@
+#ifndef STROKE_H
+#define STROKE_H
+
+#include <cstdint>
+#include <vector>
+#include "pixel_sink.h"
+
+struct Point {
+    int x;
+    int y;
+};
+
+// Point with fractional coordinates; (x, y) is the center of pixel (x, y)
+// as for Point
+struct PointF {
+    double x;
+    double y;
+};
+
+enum class LineCap {
+    butt,
+    square,
+    round
+};
+
+enum class LineJoin {
+    miter,
+    round,
+    bevel
+};
+
+struct StrokeStyle {
+    double width = 1.0;
+    LineCap cap = LineCap::butt;
+    LineJoin join = LineJoin::miter;
+    // Ratio of miter length to stroke width beyond which
+    // a miter join falls back to a bevel join.
+    double miter_limit = 4.0;
+};
+
+// The stroke outline is decomposed into convex pieces (segment bodies,
+// caps and joins) which are rasterized together one scanline at a time.
+// The spans of all pieces on a scanline are merged before being written,
+// so every covered pixel is written exactly once.
+// Pixel (x, y) is covered when its center (x + 0.5, y + 0.5) lies inside
+// the outline.
+
+void draw_stroke_line(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const int ax, const int ay,
+    const int bx, const int by,
+    const StrokeStyle& style
+);
+
+void draw_stroke_polyline(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const std::vector<Point>& points,
+    const StrokeStyle& style
+);
+
+// Appends the spans, clipped to the screen and in row order, that grow a
+// round-capped, round-joined stroke ending at points.front() so that it
+// ends at points.back(): the segment bodies, the joins and the half of the
+// new end cap ahead of the stroke. The old end cap already covers the rest.
+// With start_cap, the stroke starts at points.front() instead and its
+// start cap is included.
+void get_stroke_extension_spans(
+    std::vector<Span>& spans,
+    const std::vector<PointF>& points,
+    const double width,
+    const bool start_cap
+);
+
+#endif
@@ -0,0 +1,229 @@
+#include "stroke_animation.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include "constants.h"
+#include "line.h"
+#include "svg.h"
+
+// AnimCJK files declare the animation in a style sheet rule for the
+// medians, the stroke outlines as <path id=...> and the medians as
+// <path clip-path=...>
+const std::regex anim_rule_regex("path\\[clip-path\\]\\s*\\{([^}]*)\\}");
+const std::regex anim_duration_regex("--t:\\s*([\\d.]+)s");
+const std::regex anim_dash_array_regex("stroke-dasharray:\\s*([\\d.]+)");
+const std::regex anim_dash_offset_regex("stroke-dashoffset:\\s*([\\d.]+)");
+const std::regex anim_width_regex("stroke-width:\\s*([\\d.]+)");
+const std::regex anim_outline_regex("<path id=\"([^\"]+)\" d=\"([^\"]+)\"/>");
+const std::regex anim_clip_regex("<clipPath id=\"([^\"]+)\"><use xlink:href=\"#([^\"]+)\"/></clipPath>");
+const std::regex anim_median_regex(
+    "<path style=\"--d:\\s*([\\d.]+)s;\" pathLength=\"([\\d.]+)\" clip-path=\"url\\(#([^)]+)\\)\" d=\"([^\"]+)\"/>");
+
+// Straight pieces each quadratic or cubic median segment is split into
+constexpr int CURVE_STEPS = 16;
+
+static double find_style_value(const std::string& svg, const std::regex& regex, const double fallback)
+{
+    std::smatch match;
+    if (std::regex_search(svg, match, regex)) {
+        return std::stod(match[1]);
+    }
+    return fallback;
+}
+
+static std::vector<PointF> flatten_path(const std::vector<PathSegment>& segments)
+{
+    std::vector<PointF> points;
+    for (const PathSegment& seg : segments) {
+        const std::array<int, 8>& c = seg.c;
+        if (points.empty()) {
+            points.push_back({static_cast<double>(c[0]), static_cast<double>(c[1])});
+        }
+        switch (seg.type) {
+            case PathSegmentType::line:
+                points.push_back({static_cast<double>(c[2]), static_cast<double>(c[3])});
+                break;
+            case PathSegmentType::quad:
+                for (int i = 1; i <= CURVE_STEPS; i++) {
+                    const double t = static_cast<double>(i) / CURVE_STEPS;
+                    const double u = 1 - t;
+                    points.push_back({
+                        (u * u * c[0]) + (2 * u * t * c[2]) + (t * t * c[4]),
+                        (u * u * c[1]) + (2 * u * t * c[3]) + (t * t * c[5])
+                    });
+                }
+                break;
+            case PathSegmentType::cubic:
+                for (int i = 1; i <= CURVE_STEPS; i++) {
+                    const double t = static_cast<double>(i) / CURVE_STEPS;
+                    const double u = 1 - t;
+                    points.push_back({
+                        (u * u * u * c[0]) + (3 * u * u * t * c[2]) + (3 * u * t * t * c[4]) + (t * t * t * c[6]),
+                        (u * u * u * c[1]) + (3 * u * u * t * c[3]) + (3 * u * t * t * c[5]) + (t * t * t * c[7])
+                    });
+                }
+                break;
+        }
+    }
+    return points;
+}
+
+// Point at arc length s along a median
+static PointF get_point_at(const AnimatedStroke& stroke, const double s)
+{
+    const std::vector<double>& arc = stroke.arc_lengths;
+    const std::size_t i = std::clamp<std::size_t>(
+        std::upper_bound(arc.begin(), arc.end(), s) - arc.begin(), 1, arc.size() - 1);
+    const double seg_length = arc[i] - arc[i - 1];
+    const double f = seg_length > 0 ? std::clamp((s - arc[i - 1]) / seg_length, 0.0, 1.0) : 0.0;
+    const PointF& a = stroke.median[i - 1];
+    const PointF& b = stroke.median[i];
+    return {a.x + ((b.x - a.x) * f), a.y + ((b.y - a.y) * f)};
+}
+
+StrokeAnimation::StrokeAnimation(const std::string& file_path)
+{
+    std::ifstream svg_file(file_path);
+    if (!svg_file.is_open()) {
+        throw std::runtime_error("Unable to open \"" + file_path + "\".");
+    }
+    std::stringstream ss;
+    ss << svg_file.rdbuf();
+    const std::string svg = ss.str();
+
+    // Defaults are those of AnimCJK
+    std::smatch rule_match;
+    const std::string rule = std::regex_search(svg, rule_match, anim_rule_regex) ? rule_match[1].str() : "";
+    duration = find_style_value(rule, anim_duration_regex, 0.8);
+    dash_array = find_style_value(rule, anim_dash_array_regex, 3337);
+    dash_offset = find_style_value(rule, anim_dash_offset_regex, 3339);
+    stroke_width = find_style_value(rule, anim_width_regex, 128);
+    time = 0;
+
+    std::map<std::string, std::string> outlines;
+    for (auto i = std::sregex_iterator(svg.begin(), svg.end(), anim_outline_regex); i != std::sregex_iterator(); i++) {
+        outlines[(*i)[1]] = (*i)[2];
+    }
+    std::map<std::string, std::string> clips;
+    for (auto i = std::sregex_iterator(svg.begin(), svg.end(), anim_clip_regex); i != std::sregex_iterator(); i++) {
+        clips[(*i)[1]] = (*i)[2];
+    }
+
+    for (auto i = std::sregex_iterator(svg.begin(), svg.end(), anim_median_regex); i != std::sregex_iterator(); i++) {
+        const std::smatch& match = *i;
+        const auto clip = clips.find(match[3]);
+        if (clip == clips.end() || outlines.count(clip->second) == 0) {
+            throw std::runtime_error("Missing clip path \"" + match[3].str() + "\" in \"" + file_path + "\".");
+        }
+
+        AnimatedStroke stroke{
+            flatten_path(parse_path(match[4])),
+            {},
+            std::stod(match[1]),
+            std::stod(match[2]),
+            BitMask(SCREEN_WIDTH, SCREEN_HEIGHT),
+            {},
+            -1
+        };
+        if (stroke.median.empty()) {
+            continue;
+        }
+        stroke.arc_lengths.reserve(stroke.median.size());
+        stroke.arc_lengths.push_back(0);
+        for (std::size_t j = 1; j < stroke.median.size(); j++) {
+            const double dx = stroke.median[j].x - stroke.median[j - 1].x;
+            const double dy = stroke.median[j].y - stroke.median[j - 1].y;
+            stroke.arc_lengths.push_back(stroke.arc_lengths.back() + std::sqrt((dx * dx) + (dy * dy)));
+        }
+        if (stroke.arc_lengths.size() == 1) {
+            // A single point still gets its round caps
+            stroke.median.push_back(stroke.median.front());
+            stroke.arc_lengths.push_back(0);
+        }
+        stroke.clip_rect = fill_path_mask(stroke.clip, parse_path(outlines[clip->second]));
+        strokes.push_back(std::move(stroke));
+    }
+    if (strokes.empty()) {
+        throw std::runtime_error("No animated strokes in \"" + file_path + "\".");
+    }
+}
+
+double StrokeAnimation::get_end_time() const
+{
+    double end_time = 0;
+    for (const AnimatedStroke& stroke : strokes) {
+        end_time = std::max(end_time, stroke.delay + duration);
+    }
+    return end_time;
+}
+
+void StrokeAnimation::draw_outlines(std::vector<std::uint32_t>& pixels, const std::uint32_t color) const
+{
+    for (const AnimatedStroke& stroke : strokes) {
+        expand_bitmask(pixels, stroke.clip, stroke.clip_rect, color);
+    }
+}
+
+void StrokeAnimation::draw_medians(std::vector<std::uint32_t>& pixels, const std::uint32_t color) const
+{
+    for (const AnimatedStroke& stroke : strokes) {
+        draw_polyline_subpixel(pixels, color, stroke.median);
+    }
+}
+
+double StrokeAnimation::get_visible_length(const AnimatedStroke& stroke, const double t) const
+{
+    // The dash offset runs linearly from its start value to 0 over the
+    // stroke's duration; the dash covers [0, dash_array - offset] of the
+    // path, in path_length units
+    const double progress = std::clamp((t - stroke.delay) / duration, 0.0, 1.0);
+    const double offset = dash_offset * (1 - progress);
+    const double visible = std::clamp(dash_array - offset, 0.0, stroke.path_length);
+    return stroke.arc_lengths.back() * (visible / stroke.path_length);
+}
+
+void StrokeAnimation::render_frame(std::vector<std::uint32_t>& pixels, const std::uint32_t color, const double t)
+{
+    if (t < time) {
+        throw std::runtime_error("StrokeAnimation: frames must be rendered in time order.");
+    }
+    time = t;
+
+    for (AnimatedStroke& stroke : strokes) {
+        const double visible = get_visible_length(stroke, t);
+        const bool started = stroke.drawn_length >= 0;
+        if (visible <= stroke.drawn_length || (!started && visible <= 0)) {
+            continue;
+        }
+
+        // The median from the end drawn so far to the newly revealed end
+        const double start = std::max(stroke.drawn_length, 0.0);
+        piece.clear();
+        piece.push_back(get_point_at(stroke, start));
+        for (std::size_t i = 0; i < stroke.median.size(); i++) {
+            if (stroke.arc_lengths[i] > start && stroke.arc_lengths[i] < visible) {
+                piece.push_back(stroke.median[i]);
+            }
+        }
+        piece.push_back(get_point_at(stroke, visible));
+        stroke.drawn_length = visible;
+
+        spans.clear();
+        get_stroke_extension_spans(spans, piece, stroke_width, !started);
+        for (const Span& span : spans) {
+            expand_bitmask_span(pixels, stroke.clip, span.x0, span.x1, span.y, color);
+        }
+    }
+}
+
+void StrokeAnimation::rewind()
+{
+    time = 0;
+    for (AnimatedStroke& stroke : strokes) {
+        stroke.drawn_length = -1;
+    }
+}
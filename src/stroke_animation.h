@@ -0,0 +1,67 @@
+#ifndef STROKE_ANIMATION_H
+#define STROKE_ANIMATION_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "bitmask.h"
+#include "fill.h"
+#include "pixel_sink.h"
+#include "stroke.h"
+
+// One stroke of an AnimCJK glyph: a median line drawn with a wide
+// round-capped pen, clipped to the stroke's outline.
+struct AnimatedStroke {
+    std::vector<PointF> median;
+    // Arc length from the start of the median to each of its points
+    std::vector<double> arc_lengths;
+    // Start of the stroke's animation, in seconds
+    double delay;
+    // Length the dash values are relative to (pathLength)
+    double path_length;
+    BitMask clip;
+    BoundingRect clip_rect;
+    // Arc length drawn so far, < 0 before the stroke has started
+    double drawn_length;
+};
+
+// Renders the stroke-dashoffset animation of an AnimCJK SVG as a frame
+// sequence. The file is parsed once; each frame then only rasterizes the
+// part of each stroke revealed since the previous frame and draws it over
+// that frame, so a frame costs about as much as its new pixels.
+class StrokeAnimation {
+public:
+    explicit StrokeAnimation(const std::string& file_path);
+
+    std::size_t get_num_strokes() const { return strokes.size(); }
+
+    // Time at which the last stroke is complete, in seconds
+    double get_end_time() const;
+
+    // Fills the outlines of all strokes (the #ccc background of AnimCJK)
+    void draw_outlines(std::vector<std::uint32_t>& pixels, const std::uint32_t color) const;
+
+    // Draws the flattened medians as one-pixel subpixel polylines
+    void draw_medians(std::vector<std::uint32_t>& pixels, const std::uint32_t color) const;
+
+    // Draws what is revealed between the previous frame and time t.
+    // pixels must still hold the previous frame, and t must not go back.
+    void render_frame(std::vector<std::uint32_t>& pixels, const std::uint32_t color, const double t);
+
+    // Starts over at time 0 with nothing drawn
+    void rewind();
+
+private:
+    std::vector<AnimatedStroke> strokes;
+    double stroke_width;
+    double duration;
+    double dash_array;
+    double dash_offset;
+    double time;
+    std::vector<PointF> piece;
+    std::vector<Span> spans;
+
+    double get_visible_length(const AnimatedStroke& stroke, const double t) const;
+};
+
+#endif
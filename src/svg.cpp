@@ -1,13 +1,26 @@
 #include "svg.h"
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstring>
 #include <fstream>
+#include <functional>
+#include <limits>
 #include <regex>
 #include <sstream>
 #include <exception>
 #include "line.h"
 #include "bezier.h"
+#include "bezier_raster.h"
+#include "bitmask.h"
 #include "fill.h"
 #include "constants.h"
+#include "display_list.h"
+#include "instrument.h"
+#include "line_raster.h"
+#include "pixel_sink.h"
+#include "row_executor.h"
+#include "tiled_canvas.h"
 
 const std::regex path_regex("^<path .* d=\"(.*)\"/>$");
 const std::regex path_cmd_regex("(?:[A-Za-z](?: ?\\d+ ?)*)");
@@ -24,11 +37,9 @@ std::vector<int> get_path_coords(const std::string& coords_str)
     return coords;
 }
 
-void draw_path(
-    std::vector<std::uint32_t>& pixels,
-    const std::uint32_t color,
-    const std::string& path)
+std::vector<PathSegment> parse_path(const std::string& path)
 {
+    std::vector<PathSegment> segments;
     int sx = 0;
     int sy = 0;
     int cx = 0;
@@ -44,7 +55,7 @@ void draw_path(
         const char type = match_str.at(0);
 
         if (type == 'Z') {
-            draw_line_bresenham(pixels, color, cx, cy, sx, sy);
+            segments.push_back({PathSegmentType::line, {cx, cy, sx, sy}});
             n++;
             continue;
         }
@@ -60,19 +71,577 @@ void draw_path(
                     sy = cy;	
                 }
                 break;
+            case 'L':
+                segments.push_back({PathSegmentType::line, {cx, cy, coords.at(0), coords.at(1)}});
+                cx = coords.at(0);
+                cy = coords.at(1);
+                break;
             case 'C':
-                draw_bezier_cubic(pixels, color, cx, cy, coords.at(0), coords.at(1), coords.at(2), coords.at(3), coords.at(4), coords.at(5));
+                segments.push_back({PathSegmentType::cubic, {cx, cy, coords.at(0), coords.at(1), coords.at(2), coords.at(3), coords.at(4), coords.at(5)}});
                 cx = coords.at(4);
                 cy = coords.at(5);
                 break;
             case 'Q':
-                draw_bezier_quad(pixels, color, cx, cy, coords.at(0), coords.at(1), coords.at(2), coords.at(3));
+                segments.push_back({PathSegmentType::quad, {cx, cy, coords.at(0), coords.at(1), coords.at(2), coords.at(3)}});
                 cx = coords.at(2);
                 cy = coords.at(3);
                 break;
         }
         n++;
     }
+    return segments;
+}
+
+void draw_path_segments(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const std::vector<PathSegment>& segments)
+{
+    for (const PathSegment& seg : segments) {
+        const std::array<int, 8>& c = seg.c;
+        switch (seg.type) {
+            case PathSegmentType::line:
+                draw_line_bresenham(pixels, color, c[0], c[1], c[2], c[3]);
+                break;
+            case PathSegmentType::quad:
+                draw_bezier_quad(pixels, color, c[0], c[1], c[2], c[3], c[4], c[5]);
+                break;
+            case PathSegmentType::cubic:
+                draw_bezier_cubic(pixels, color, c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7]);
+                break;
+        }
+    }
+}
+
+template <typename Sink>
+static void rasterize_path_segment(Sink& sink, const PathSegment& seg)
+{
+    const std::array<int, 8>& c = seg.c;
+    switch (seg.type) {
+        case PathSegmentType::line:
+            rasterize_line_bresenham(sink, c[0], c[1], c[2], c[3]);
+            break;
+        case PathSegmentType::quad:
+            rasterize_bezier_quad(sink, c[0], c[1], c[2], c[3], c[4], c[5]);
+            break;
+        case PathSegmentType::cubic:
+            rasterize_bezier_cubic(sink, c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7]);
+            break;
+    }
+}
+
+template <typename Sink>
+static void rasterize_path_segments(Sink& sink, const std::vector<PathSegment>& segments)
+{
+    for (const PathSegment& seg : segments) {
+        rasterize_path_segment(sink, seg);
+    }
+}
+
+BoundingRect fill_path_mask(BitMask& mask, const std::vector<PathSegment>& segments)
+{
+    BitMaskSink sink(mask);
+    rasterize_path_segments(sink, segments);
+    const BoundingRect br = get_bounding_rect(mask);
+    scanline_fill_area(mask, br.x_min, br.y_min, br.x_max, br.y_max);
+    return br;
+}
+
+void fill_path_segments(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const std::vector<PathSegment>& segments)
+{
+    INSTRUMENT_SCOPE(path);
+    // The scratch only ever holds "outline/filled" or not,
+    // so it is kept as one bit per pixel
+    BitMask path_mask(SCREEN_WIDTH, SCREEN_HEIGHT);
+    const BoundingRect br = fill_path_mask(path_mask, segments);
+    expand_bitmask(pixels, path_mask, br, color);
+}
+
+// A path filled into a mask covering only its bounds on a surface,
+// with mask pixel (0, 0) at (bounds.x_min, bounds.y_min)
+struct PathMask {
+    BitMask mask{0, 0};
+    DrawBounds bounds{0, 0, -1, -1};
+    // Filled area within the mask
+    BoundingRect filled{1, 1, 0, 0};
+};
+
+// Bounds of a path, unclipped so that a mask of these bounds holds its
+// whole outline, and the scanline fill has the outer edge of a path
+// crossing a surface edge to close against. Control points bound the
+// curves. False if the path is empty or off the width x height surface.
+static bool get_visible_path_bounds(const std::vector<PathSegment>& segments, const int width, const int height, DrawBounds& bounds)
+{
+    if (segments.empty()) {
+        return false;
+    }
+    bounds = get_path_bounds(segments);
+    return bounds.x_max >= 0 && bounds.y_max >= 0 && bounds.x_min < width && bounds.y_min < height;
+}
+
+// Rasterizes a segment into a mask whose pixel (0, 0) is at (x_min,
+// y_min). The segment is moved rather than the sink offset, as the
+// rasterizers skip lines with endpoints at negative coordinates.
+static void rasterize_path_segment_to_mask(BitMask& mask, const PathSegment& seg, const int x_min, const int y_min)
+{
+    PathSegment local = seg;
+    for (std::size_t i = 0; i < local.c.size(); i += 2) {
+        local.c[i] -= x_min;
+        local.c[i + 1] -= y_min;
+    }
+    OffsetMaskSink mask_sink(mask, mask.get_width(), mask.get_height(), 0, 0);
+    rasterize_path_segment(mask_sink, local);
+}
+
+static void fill_bounded_path_mask(
+    PathMask& path_mask,
+    const std::vector<PathSegment>& segments,
+    const int width, const int height)
+{
+    DrawBounds bounds;
+    if (!get_visible_path_bounds(segments, width, height, bounds)) {
+        return;
+    }
+
+    path_mask.mask = BitMask(bounds.x_max - bounds.x_min + 1, bounds.y_max - bounds.y_min + 1);
+    path_mask.bounds = bounds;
+    for (const PathSegment& seg : segments) {
+        rasterize_path_segment_to_mask(path_mask.mask, seg, bounds.x_min, bounds.y_min);
+    }
+    const BoundingRect br = get_bounding_rect(path_mask.mask);
+    scanline_fill_area(path_mask.mask, br.x_min, br.y_min, br.x_max, br.y_max);
+    path_mask.filled = br;
+}
+
+// Copies each run of set bits of the filled area br in rows [y0, y1) and
+// columns [0, width) of the surface as one span; mask pixel (0, 0) is at
+// (x_min, y_min), which may be off the surface
+template <typename Sink>
+static void composite_path_mask(
+    Sink& sink,
+    const BitMask& mask, const BoundingRect& br,
+    const int x_min, const int y_min,
+    const int width, const int y0, const int y1)
+{
+    const int y_begin = std::max(static_cast<int>(br.y_min), y0 - y_min);
+    const int y_end = std::min(static_cast<int>(br.y_max) + 1, y1 - y_min);
+    const int begin = std::max(static_cast<int>(br.x_min), -x_min);
+    const int end = std::min(static_cast<int>(br.x_max) + 1, width - x_min);
+    for (int y = y_begin; y < y_end; y++) {
+        int x = mask.find_next_bit(y, begin, end, true);
+        while (x < end) {
+            const int run_end = mask.find_next_bit(y, x, end, false);
+            sink.span(x + x_min, run_end - 1 + x_min, y + y_min);
+            x = mask.find_next_bit(y, run_end, end, true);
+        }
+    }
+}
+
+void fill_path_segments(
+    TiledCanvas& canvas,
+    const std::uint32_t color,
+    const std::vector<PathSegment>& segments)
+{
+    INSTRUMENT_SCOPE(path);
+    PathMask path_mask;
+    fill_bounded_path_mask(path_mask, segments, canvas.get_width(), canvas.get_height());
+    TiledCanvasSink sink(canvas, color);
+    composite_path_mask(sink, path_mask.mask, path_mask.filled, path_mask.bounds.x_min, path_mask.bounds.y_min, canvas.get_width(), 0, canvas.get_height());
+}
+
+void fill_path_segments_clipped(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const std::vector<PathSegment>& segments)
+{
+    INSTRUMENT_SCOPE(path);
+    PathMask path_mask;
+    fill_bounded_path_mask(path_mask, segments, SCREEN_WIDTH, SCREEN_HEIGHT);
+    UncheckedSink sink(pixels, color);
+    composite_path_mask(sink, path_mask.mask, path_mask.filled, path_mask.bounds.x_min, path_mask.bounds.y_min, SCREEN_WIDTH, 0, SCREEN_HEIGHT);
+}
+
+std::vector<Span> get_path_spans(const std::vector<PathSegment>& segments)
+{
+    INSTRUMENT_SCOPE(path);
+    PathMask path_mask;
+    fill_bounded_path_mask(path_mask, segments, SCREEN_WIDTH, SCREEN_HEIGHT);
+    SpanCollector collector;
+    composite_path_mask(collector, path_mask.mask, path_mask.filled, path_mask.bounds.x_min, path_mask.bounds.y_min, SCREEN_WIDTH, 0, SCREEN_HEIGHT);
+    return std::move(collector.spans);
+}
+
+// Most joints a line merged from several may have
+constexpr int MAX_LINE_RUN = 16;
+
+static int round_to_pixel(const float v)
+{
+    // Truncation, corrected for negatives, is much cheaper than a call
+    const int i = static_cast<int>(v + 0.5f);
+    return i - (static_cast<float>(i) > v + 0.5f ? 1 : 0);
+}
+
+// Whether (px, py) is within distance of the line through (ax, ay) and
+// (bx, by), or of (ax, ay) if the two are the same point. Compared
+// squared, as this runs for every joint of every merged line.
+static bool is_near_chord(const float px, const float py, const float ax, const float ay, const float bx, const float by, const float distance)
+{
+    const float ux = bx - ax;
+    const float uy = by - ay;
+    const float vx = px - ax;
+    const float vy = py - ay;
+    const float length_sq = (ux * ux) + (uy * uy);
+    if (length_sq < 1e-12f) {
+        return (vx * vx) + (vy * vy) <= distance * distance;
+    }
+    const float cross = (vx * uy) - (vy * ux);
+    return cross * cross <= distance * distance * length_sq;
+}
+
+// transform_path_segments before rounding: the pen and every point kept
+// stay in subpixels, so segments still join exactly
+static void transform_path_points(
+    const std::vector<PathSegment>& segments,
+    const PathTransform& transform,
+    const float tolerance,
+    std::vector<ScreenPathSegment>& result)
+{
+    result.clear();
+    // The pen is where the last segment kept ends, on the screen, and
+    // the next segment of the contour starts there
+    float pen_x = 0;
+    float pen_y = 0;
+    int end_x = 0;
+    int end_y = 0;
+    // Consecutive lines are merged while the joints between them, where
+    // the path really is, stay within tolerance of the merged line.
+    // These are the joints of the last line kept and where it ends.
+    std::array<float, 2 * MAX_LINE_RUN> joints;
+    int num_joints = 0;
+    bool can_merge = false;
+    float line_end_x = 0;
+    float line_end_y = 0;
+    for (std::size_t k = 0; k < segments.size(); k++) {
+        const PathSegment& seg = segments[k];
+        const int num_coords = seg.type == PathSegmentType::line ? 4 : seg.type == PathSegmentType::quad ? 6 : 8;
+        std::array<float, 8> p{};
+        for (int i = 0; i < num_coords; i += 2) {
+            p[i] = (seg.c[i] * transform.scale) + transform.dx;
+            p[i + 1] = (seg.c[i + 1] * transform.scale) + transform.dy;
+        }
+        if (k == 0 || seg.c[0] != end_x || seg.c[1] != end_y) {
+            pen_x = p[0];
+            pen_y = p[1];
+            can_merge = false;
+        }
+        end_x = seg.c[num_coords - 2];
+        end_y = seg.c[num_coords - 1];
+
+        ScreenPathSegment out{seg.type, p};
+        if (tolerance > 0) {
+            // A curve strays from its chord by at most half the control
+            // point's distance for a quad, three quarters for a cubic
+            const float ax = p[0];
+            const float ay = p[1];
+            const float bx = p[num_coords - 2];
+            const float by = p[num_coords - 1];
+            bool is_flat = true;
+            if (seg.type == PathSegmentType::quad) {
+                is_flat = is_near_chord(p[2], p[3], ax, ay, bx, by, tolerance / 0.5f);
+            } else if (seg.type == PathSegmentType::cubic) {
+                is_flat = is_near_chord(p[2], p[3], ax, ay, bx, by, tolerance / 0.75f)
+                    && is_near_chord(p[4], p[5], ax, ay, bx, by, tolerance / 0.75f);
+            }
+            if (is_flat) {
+                out.type = PathSegmentType::line;
+                out.p[2] = bx;
+                out.p[3] = by;
+            }
+        }
+        const int out_coords = out.type == PathSegmentType::line ? 4 : out.type == PathSegmentType::quad ? 6 : 8;
+        out.p[0] = pen_x;
+        out.p[1] = pen_y;
+        const float out_x = out.p[out_coords - 2];
+        const float out_y = out.p[out_coords - 1];
+        if (tolerance > 0 && out.type == PathSegmentType::line
+            && round_to_pixel(out_x) == round_to_pixel(pen_x) && round_to_pixel(out_y) == round_to_pixel(pen_y)) {
+            continue;
+        }
+        pen_x = out_x;
+        pen_y = out_y;
+        if (out.type != PathSegmentType::line || tolerance <= 0) {
+            result.push_back(out);
+            can_merge = false;
+            continue;
+        }
+
+        if (can_merge && num_joints < MAX_LINE_RUN) {
+            ScreenPathSegment& last = result.back();
+            joints[2 * num_joints] = line_end_x;
+            joints[(2 * num_joints) + 1] = line_end_y;
+            bool fits = true;
+            for (int i = 0; i <= num_joints && fits; i++) {
+                fits = is_near_chord(joints[2 * i], joints[(2 * i) + 1], last.p[0], last.p[1], out_x, out_y, tolerance);
+            }
+            if (fits) {
+                num_joints++;
+                last.p[2] = out_x;
+                last.p[3] = out_y;
+                line_end_x = p[num_coords - 2];
+                line_end_y = p[num_coords - 1];
+                continue;
+            }
+        }
+        result.push_back(out);
+        can_merge = true;
+        num_joints = 0;
+        line_end_x = p[num_coords - 2];
+        line_end_y = p[num_coords - 1];
+    }
+}
+
+static PathSegment round_path_segment(const ScreenPathSegment& seg, const int dx, const int dy)
+{
+    PathSegment out{seg.type, {}};
+    const int num_coords = seg.type == PathSegmentType::line ? 4 : seg.type == PathSegmentType::quad ? 6 : 8;
+    for (int i = 0; i < num_coords; i += 2) {
+        out.c[i] = round_to_pixel(seg.p[i]) + dx;
+        out.c[i + 1] = round_to_pixel(seg.p[i + 1]) + dy;
+    }
+    return out;
+}
+
+std::vector<PathSegment> transform_path_segments(
+    const std::vector<PathSegment>& segments,
+    const PathTransform& transform,
+    const float tolerance)
+{
+    std::vector<ScreenPathSegment> screen_segments;
+    transform_path_points(segments, transform, tolerance, screen_segments);
+    std::vector<PathSegment> result;
+    result.reserve(screen_segments.size());
+    for (const ScreenPathSegment& seg : screen_segments) {
+        result.push_back(round_path_segment(seg, 0, 0));
+    }
+    return result;
+}
+
+// Pixels of the points bound the outline, as for get_path_bounds
+static DrawBounds get_screen_path_bounds(const std::vector<ScreenPathSegment>& segments)
+{
+    constexpr int int_max = std::numeric_limits<int>::max();
+    constexpr int int_min = std::numeric_limits<int>::min();
+    DrawBounds bounds = {int_max, int_max, int_min, int_min};
+    for (const ScreenPathSegment& seg : segments) {
+        const int num_coords = seg.type == PathSegmentType::line ? 4 : seg.type == PathSegmentType::quad ? 6 : 8;
+        for (int i = 0; i < num_coords; i += 2) {
+            const int x = round_to_pixel(seg.p[i]);
+            const int y = round_to_pixel(seg.p[i + 1]);
+            bounds.x_min = std::min(bounds.x_min, x);
+            bounds.y_min = std::min(bounds.y_min, y);
+            bounds.x_max = std::max(bounds.x_max, x);
+            bounds.y_max = std::max(bounds.y_max, y);
+        }
+    }
+    return bounds;
+}
+
+// Draws the outline into a mask of the bounds, in mask coordinates as
+// rasterize_path_segment_to_mask, fills it and returns the filled area
+static BoundingRect fill_screen_path_mask(BitMask& mask, const std::vector<ScreenPathSegment>& segments, const DrawBounds& bounds)
+{
+    mask.reset(bounds.x_max - bounds.x_min + 1, bounds.y_max - bounds.y_min + 1);
+    OffsetMaskSink mask_sink(mask, mask.get_width(), mask.get_height(), 0, 0);
+    for (const ScreenPathSegment& seg : segments) {
+        if (seg.type == PathSegmentType::line) {
+            rasterize_line_fixed(
+                mask_sink,
+                to_fixed(static_cast<double>(seg.p[0] - bounds.x_min)), to_fixed(static_cast<double>(seg.p[1] - bounds.y_min)),
+                to_fixed(static_cast<double>(seg.p[2] - bounds.x_min)), to_fixed(static_cast<double>(seg.p[3] - bounds.y_min)),
+                true);
+        } else {
+            rasterize_path_segment(mask_sink, round_path_segment(seg, -bounds.x_min, -bounds.y_min));
+        }
+    }
+    const BoundingRect br = get_bounding_rect(mask);
+    if (br.x_min <= br.x_max) {
+        scanline_fill_area(mask, br.x_min, br.y_min, br.x_max, br.y_max);
+    }
+    return br;
+}
+
+static bool is_on_screen(const DrawBounds& bounds, const int dx, const int dy)
+{
+    return bounds.x_max + dx >= 0 && bounds.y_max + dy >= 0 && bounds.x_min + dx < SCREEN_WIDTH && bounds.y_min + dy < SCREEN_HEIGHT;
+}
+
+TransformedPathFill::TransformedPathFill()
+    : mask(0, 0)
+{
+}
+
+std::size_t TransformedPathFill::SimplifiedKeyHash::operator()(const SimplifiedKey& key) const
+{
+    std::size_t h = std::hash<const void*>()(key.path);
+    const auto combine = [&h](const std::uint32_t v) {
+        h ^= v + 0x9E3779B9 + (h << 6) + (h >> 2);
+    };
+    combine(key.scale);
+    combine(key.tolerance);
+    combine(static_cast<std::uint32_t>(key.phase_x));
+    combine(static_cast<std::uint32_t>(key.phase_y));
+    return h;
+}
+
+const TransformedPathFill::SimplifiedPath& TransformedPathFill::get_simplified(
+    const std::vector<PathSegment>& segments,
+    const PathTransform& transform,
+    const float tolerance,
+    int& offset_x, int& offset_y)
+{
+    static_assert((PATH_SUBPIXELS & (PATH_SUBPIXELS - 1)) == 0, "PATH_SUBPIXELS must be a power of two");
+    // The offset in subpixels, split into whole pixels and the phase
+    const int subpixel_x = round_to_pixel(transform.dx * PATH_SUBPIXELS);
+    const int subpixel_y = round_to_pixel(transform.dy * PATH_SUBPIXELS);
+    offset_x = (subpixel_x - (subpixel_x & (PATH_SUBPIXELS - 1))) / PATH_SUBPIXELS;
+    offset_y = (subpixel_y - (subpixel_y & (PATH_SUBPIXELS - 1))) / PATH_SUBPIXELS;
+
+    SimplifiedKey key = {&segments, 0, 0, subpixel_x & (PATH_SUBPIXELS - 1), subpixel_y & (PATH_SUBPIXELS - 1)};
+    const float scale = transform.scale + 0.0f;
+    std::memcpy(&key.scale, &scale, sizeof(key.scale));
+    std::memcpy(&key.tolerance, &tolerance, sizeof(key.tolerance));
+    auto it = simplified.find(key);
+    if (it == simplified.end()) {
+        // Started over when full; a page of text reuses far fewer
+        if (simplified.size() >= MAX_SIMPLIFIED_PATHS) {
+            simplified.clear();
+        }
+        it = simplified.emplace(key, SimplifiedPath{}).first;
+    } else if (it->second.source == segments) {
+        return it->second;
+    }
+
+    SimplifiedPath& path = it->second;
+    path.source = segments;
+    const PathTransform phase = {
+        transform.scale,
+        static_cast<float>(key.phase_x) / PATH_SUBPIXELS,
+        static_cast<float>(key.phase_y) / PATH_SUBPIXELS
+    };
+    transform_path_points(segments, phase, tolerance, path.segments);
+    path.has_mask = false;
+    if (!path.segments.empty()) {
+        const DrawBounds bounds = get_screen_path_bounds(path.segments);
+        const long area = static_cast<long>(bounds.x_max - bounds.x_min + 1) * (bounds.y_max - bounds.y_min + 1);
+        if (area <= MAX_CACHED_MASK_PIXELS) {
+            path.has_mask = true;
+            path.filled = fill_screen_path_mask(path.mask, path.segments, bounds);
+            path.x_min = bounds.x_min;
+            path.y_min = bounds.y_min;
+        }
+    }
+    return path;
+}
+
+std::size_t TransformedPathFill::fill(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const std::vector<PathSegment>& segments,
+    const PathTransform& transform,
+    const float tolerance)
+{
+    INSTRUMENT_SCOPE(path);
+    // Whole pixels the segments are moved by when drawn
+    int offset_x = 0;
+    int offset_y = 0;
+    const std::vector<ScreenPathSegment>* path_segments = &screen_segments;
+    if (tolerance > 0) {
+        const SimplifiedPath& path = get_simplified(segments, transform, tolerance, offset_x, offset_y);
+        if (path.has_mask) {
+            UncheckedSink sink(pixels, color);
+            composite_path_mask(sink, path.mask, path.filled, path.x_min + offset_x, path.y_min + offset_y, SCREEN_WIDTH, 0, SCREEN_HEIGHT);
+            return path.segments.size();
+        }
+        path_segments = &path.segments;
+    } else {
+        transform_path_points(segments, transform, tolerance, screen_segments);
+    }
+    if (path_segments->empty()) {
+        return 0;
+    }
+
+    const DrawBounds bounds = get_screen_path_bounds(*path_segments);
+    if (is_on_screen(bounds, offset_x, offset_y)) {
+        const BoundingRect br = fill_screen_path_mask(mask, *path_segments, bounds);
+        UncheckedSink sink(pixels, color);
+        composite_path_mask(sink, mask, br, bounds.x_min + offset_x, bounds.y_min + offset_y, SCREEN_WIDTH, 0, SCREEN_HEIGHT);
+    }
+    return path_segments->size();
+}
+
+PathFill::PathFill(const std::vector<PathSegment>& segments)
+    : segments(segments),
+      stage(Stage::done),
+      next_segment(0),
+      next_row(0),
+      mask(0, 0),
+      x_min(0),
+      y_min(0),
+      filled{1, 1, 0, 0}
+{
+    DrawBounds bounds;
+    if (get_visible_path_bounds(segments, SCREEN_WIDTH, SCREEN_HEIGHT, bounds)) {
+        mask = BitMask(bounds.x_max - bounds.x_min + 1, bounds.y_max - bounds.y_min + 1);
+        x_min = bounds.x_min;
+        y_min = bounds.y_min;
+        stage = Stage::outline;
+    }
+}
+
+std::size_t PathFill::step(std::vector<std::uint32_t>& pixels, const std::uint32_t color)
+{
+    switch (stage) {
+        case Stage::outline: {
+            const PathSegment& seg = segments[next_segment++];
+            rasterize_path_segment_to_mask(mask, seg, x_min, y_min);
+            if (next_segment == segments.size()) {
+                // Rows above the screen are not filled, as nothing shows them
+                filled = get_bounding_rect(mask);
+                next_row = std::max(static_cast<int>(filled.y_min), -y_min);
+                const bool is_visible = filled.x_min <= filled.x_max && next_row + y_min < SCREEN_HEIGHT;
+                stage = is_visible ? Stage::fill : Stage::done;
+            }
+            const DrawBounds hull = get_path_bounds({seg});
+            return static_cast<std::size_t>(hull.x_max - hull.x_min) + (hull.y_max - hull.y_min) + 1;
+        }
+        case Stage::fill: {
+            // scanline_fill_area leaves the last row of the area as it is
+            const int y = next_row++;
+            if (y < static_cast<int>(filled.y_max)) {
+                scanline_fill_area(mask, filled.x_min, y, filled.x_max, y + 1);
+            }
+            UncheckedSink sink(pixels, color);
+            composite_path_mask(sink, mask, filled, x_min, y_min, SCREEN_WIDTH, y + y_min, y + y_min + 1);
+            if (next_row > static_cast<int>(filled.y_max) || next_row + y_min >= SCREEN_HEIGHT) {
+                stage = Stage::done;
+            }
+            return filled.x_max - filled.x_min + 1;
+        }
+        case Stage::done:
+            break;
+    }
+    return 0;
+}
+
+void draw_path(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const std::string& path)
+{
+    draw_path_segments(pixels, color, parse_path(path));
 }
 
 std::vector<std::string> get_paths_from_svg(const std::string& file_path)
@@ -104,24 +673,69 @@ void draw_svg(
     const std::uint32_t color,
     const std::string& file_path)
 {
-    std::vector<std::string> paths = get_paths_from_svg(file_path);
+    INSTRUMENT_SCOPE(svg);
+    const std::vector<std::string> paths = get_paths_from_svg(file_path);
     if (paths.empty()) {
         return;
     }
 
-    for (const std::string& path : paths) {
-        std::vector<std::uint32_t> path_pixels(pixels.size());
-        draw_path(path_pixels, color, path);
-        const BoundingRect br = get_bounding_rect(path_pixels, color);
-        scanline_fill_area(path_pixels, br.x_min, br.y_min, br.x_max, br.y_max, color);
-        for (unsigned int y = br.y_min; y <= br.y_max; y++) {
-            const unsigned int row = y * SCREEN_WIDTH;
-            for (unsigned int x = br.x_min; x <= br.x_max; x++) {
-                const unsigned int i = row + x;
-                if (path_pixels.at(i) == color) {
-                    pixels.at(i) = color;
-                }
+    // Paths are parsed and filled concurrently, each into a mask of its
+    // own bounds, then composited in document order one row band at a
+    // time, so the result does not depend on the number of threads
+    RowExecutor& executor = get_row_executor();
+    std::vector<PathMask> path_masks(paths.size());
+    executor.for_each_task(static_cast<int>(paths.size()), [&](const int i) {
+        INSTRUMENT_SCOPE(path);
+        fill_bounded_path_mask(path_masks[i], parse_path(paths[i]), SCREEN_WIDTH, SCREEN_HEIGHT);
+    });
+
+    int y_begin = SCREEN_HEIGHT;
+    int y_end = 0;
+    for (const PathMask& path_mask : path_masks) {
+        if (path_mask.filled.x_min <= path_mask.filled.x_max) {
+            y_begin = std::min(y_begin, path_mask.bounds.y_min + static_cast<int>(path_mask.filled.y_min));
+            y_end = std::max(y_end, path_mask.bounds.y_min + static_cast<int>(path_mask.filled.y_max) + 1);
+        }
+    }
+    y_begin = std::max(y_begin, 0);
+    y_end = std::min(y_end, SCREEN_HEIGHT);
+    executor.for_each_band(y_begin, y_end, TEXTURE_PITCH, [&](const int y0, const int y1) {
+        UncheckedSink sink(pixels, color);
+        for (const PathMask& path_mask : path_masks) {
+            composite_path_mask(sink, path_mask.mask, path_mask.filled, path_mask.bounds.x_min, path_mask.bounds.y_min, SCREEN_WIDTH, y0, y1);
+        }
+    });
+}
+
+void draw_svg(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const std::string& file_path,
+    const PathTransform& transform,
+    const float tolerance)
+{
+    INSTRUMENT_SCOPE(svg);
+    TransformedPathFill path_fill;
+    for (const std::string& path : get_paths_from_svg(file_path)) {
+        path_fill.fill(pixels, color, parse_path(path), transform, tolerance);
+    }
+}
+
+void draw_svg(
+    TiledCanvas& canvas,
+    const std::uint32_t color,
+    const std::string& file_path,
+    const int dx, const int dy)
+{
+    INSTRUMENT_SCOPE(svg);
+    for (const std::string& path : get_paths_from_svg(file_path)) {
+        std::vector<PathSegment> segments = parse_path(path);
+        for (PathSegment& seg : segments) {
+            for (std::size_t i = 0; i < seg.c.size(); i += 2) {
+                seg.c[i] += dx;
+                seg.c[i + 1] += dy;
             }
         }
+        fill_path_segments(canvas, color, segments);
     }
 }
@@ -1,12 +1,232 @@
 #ifndef SVG_H
 #define SVG_H
 
+#include <array>
+#include <cstddef>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <cstdint>
+#include "bitmask.h"
+#include "fill.h"
+#include "pixel_sink.h"
+
+class TiledCanvas;
+
+enum class PathSegmentType : std::uint8_t {
+    line,
+    quad,
+    cubic
+};
+
+// One drawable piece of a path in absolute coordinates,
+// starting at (c[0], c[1]) and ending at the last point used by its type:
+// line: (c[2], c[3]); quad: (c[4], c[5]); cubic: (c[6], c[7]).
+struct PathSegment {
+    PathSegmentType type;
+    std::array<int, 8> c;
+
+    bool operator==(const PathSegment& other) const
+    {
+        return type == other.type && c == other.c;
+    }
+};
 
 std::vector<int> get_path_coords(const std::string& coords_str);
 
+std::vector<PathSegment> parse_path(const std::string& path);
+
+void draw_path_segments(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const std::vector<PathSegment>& segments
+);
+
+// Draws the outline of a closed path into a screen-sized mask and fills it.
+// Returns the bounding rect of the filled area.
+BoundingRect fill_path_mask(BitMask& mask, const std::vector<PathSegment>& segments);
+
+// Draws the outline of a closed path into a 1-bit scratch mask,
+// fills it, and merges the filled area into pixels.
+void fill_path_segments(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const std::vector<PathSegment>& segments
+);
+
+// Same as above on a TiledCanvas. The scratch mask only covers the
+// path's bounds, so paths anywhere on a large canvas stay cheap.
+void fill_path_segments(
+    TiledCanvas& canvas,
+    const std::uint32_t color,
+    const std::vector<PathSegment>& segments
+);
+
+// Same as above with a scratch mask covering only the path's bounds,
+// which is much cheaper for small paths. The path is filled whole and
+// only the fill is clipped, so a path crossing a screen edge keeps its
+// outline closed.
+void fill_path_segments_clipped(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const std::vector<PathSegment>& segments
+);
+
+// The pixels fill_path_segments_clipped would write, as maximal runs
+// sorted by row then x, for callers that keep the fill (see SpanShape)
+std::vector<Span> get_path_spans(const std::vector<PathSegment>& segments);
+
+// Maps path coordinates to the screen: (x * scale + dx, y * scale + dy)
+struct PathTransform {
+    float scale;
+    float dx;
+    float dy;
+};
+
+// Half a pixel: curves stay within the pixels they would have covered
+constexpr float DEFAULT_PATH_TOLERANCE = 0.5f;
+
+// Transforms a path to the screen, rounding its points to whole pixels.
+// Scaled down, most segments of a detailed outline cover a pixel or two,
+// so with a tolerance above zero the path is simplified to the detail
+// the scale can show, moving no point by more than about tolerance
+// pixels: curves that stay that close to their chord become lines, runs
+// of lines merge while their joints stay that close to the merged line,
+// segments that start and end on the same pixel are dropped, and so are
+// contours left with no segments. A tolerance of zero keeps every
+// segment.
+std::vector<PathSegment> transform_path_segments(
+    const std::vector<PathSegment>& segments,
+    const PathTransform& transform,
+    const float tolerance = DEFAULT_PATH_TOLERANCE
+);
+
+// A segment transformed to the screen, in subpixels: (x, y) is the center
+// of pixel (x, y). Points are used as in PathSegment.
+struct ScreenPathSegment {
+    PathSegmentType type;
+    std::array<float, 8> p;
+};
+
+// Fills paths transformed and simplified as by transform_path_segments,
+// but keeps the endpoints of lines, including curves simplified to
+// lines, to the subpixel and draws them with rasterize_line_fixed.
+// Curves left are drawn from control points rounded to whole pixels.
+// The mask and segments are kept from one path to the next, so filling
+// many small paths, e.g. a page of glyphs, allocates only when a path
+// needs a larger mask than any before.
+//
+// With a tolerance above zero, the offset is snapped to 1/PATH_SUBPIXELS
+// of a pixel and the simplified segments are kept per path, scale,
+// tolerance and subpixel phase of the offset, along with the filled mask
+// of paths up to MAX_CACHED_MASK_PIXELS. Drawing the same path again,
+// anywhere on the screen, then skips the transform and simplification,
+// and at text sizes the fill as well. Paths are looked up by address and
+// checked by value, so a path that changed or was freed since is
+// simplified again.
+class TransformedPathFill {
+public:
+    static constexpr int PATH_SUBPIXELS = 16;
+    // Simplified paths kept before starting over
+    static constexpr std::size_t MAX_SIMPLIFIED_PATHS = 4096;
+    static constexpr long MAX_CACHED_MASK_PIXELS = 128 * 128;
+
+    TransformedPathFill();
+
+    // Returns the number of segments drawn
+    std::size_t fill(
+        std::vector<std::uint32_t>& pixels,
+        const std::uint32_t color,
+        const std::vector<PathSegment>& segments,
+        const PathTransform& transform,
+        const float tolerance = DEFAULT_PATH_TOLERANCE
+    );
+
+    std::size_t get_num_simplified() const { return simplified.size(); }
+
+private:
+    struct SimplifiedKey {
+        const std::vector<PathSegment>* path;
+        // Bit patterns, so that every key equals itself
+        std::uint32_t scale;
+        std::uint32_t tolerance;
+        // Offset modulo a pixel, in 1/PATH_SUBPIXELS
+        int phase_x;
+        int phase_y;
+
+        bool operator==(const SimplifiedKey& other) const
+        {
+            return path == other.path && scale == other.scale && tolerance == other.tolerance
+                && phase_x == other.phase_x && phase_y == other.phase_y;
+        }
+    };
+
+    struct SimplifiedKeyHash {
+        std::size_t operator()(const SimplifiedKey& key) const;
+    };
+
+    // At the phase of the key, without the whole pixels of the offset
+    struct SimplifiedPath {
+        // The path the segments were simplified from
+        std::vector<PathSegment> source;
+        std::vector<ScreenPathSegment> segments;
+        // The filled outline, if it is small enough to keep, with mask
+        // pixel (0, 0) at (x_min, y_min)
+        bool has_mask = false;
+        BitMask mask{0, 0};
+        int x_min = 0;
+        int y_min = 0;
+        BoundingRect filled{1, 1, 0, 0};
+    };
+
+    std::vector<ScreenPathSegment> screen_segments;
+    BitMask mask;
+    std::unordered_map<SimplifiedKey, SimplifiedPath, SimplifiedKeyHash> simplified;
+
+    // The simplified path, from the cache or added to it, and the whole
+    // pixels of the offset to draw it at
+    const SimplifiedPath& get_simplified(
+        const std::vector<PathSegment>& segments,
+        const PathTransform& transform,
+        const float tolerance,
+        int& offset_x, int& offset_y
+    );
+};
+
+// fill_path_segments on the screen, split into steps so a large path can
+// be drawn over several calls: the outline one segment per step, then
+// the fill one row per step, each row shown as soon as it is filled.
+// The segments must outlive the PathFill.
+class PathFill {
+public:
+    explicit PathFill(const std::vector<PathSegment>& segments);
+
+    bool is_done() const { return stage == Stage::done; }
+
+    // Does the next step and returns roughly how many pixels it covered:
+    // the width plus height of a segment's hull, or a row's width
+    std::size_t step(std::vector<std::uint32_t>& pixels, const std::uint32_t color);
+
+private:
+    enum class Stage {
+        outline,
+        fill,
+        done
+    };
+
+    const std::vector<PathSegment>& segments;
+    Stage stage;
+    // Next segment, then next row of the mask
+    std::size_t next_segment;
+    int next_row;
+    // Mask pixel (0, 0) is at (x_min, y_min) on the screen
+    BitMask mask;
+    int x_min;
+    int y_min;
+    // Filled area within the mask
+    BoundingRect filled;
+};
+
 void draw_path(
     std::vector<std::uint32_t>& pixels,
     const std::uint32_t color,
@@ -21,4 +241,22 @@ void draw_svg(
     const std::string& file_path
 );
 
-#endif
\ No newline at end of file
+// Fills the paths of an SVG file transformed by a TransformedPathFill,
+// e.g. a glyph at text size
+void draw_svg(
+    std::vector<std::uint32_t>& pixels,
+    const std::uint32_t color,
+    const std::string& file_path,
+    const PathTransform& transform,
+    const float tolerance = DEFAULT_PATH_TOLERANCE
+);
+
+// Fills the paths of an SVG file on a TiledCanvas, offset by (dx, dy)
+void draw_svg(
+    TiledCanvas& canvas,
+    const std::uint32_t color,
+    const std::string& file_path,
+    const int dx = 0, const int dy = 0
+);
+
+#endif
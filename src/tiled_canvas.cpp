@@ -0,0 +1,145 @@
+#include "tiled_canvas.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "kernels.h"
+
+TiledCanvas::TiledCanvas(const int width, const int height, const std::uint32_t background)
+    : width(width),
+      height(height),
+      columns((width + TILE_MASK) >> TILE_SHIFT),
+      rows((height + TILE_MASK) >> TILE_SHIFT),
+      background(background),
+      num_allocated(0),
+      mapping(nullptr),
+      mapping_size(0)
+{
+    if (width <= 0 || height <= 0) {
+        throw std::runtime_error("TiledCanvas: width and height must be positive.");
+    }
+    tiles.assign(static_cast<std::size_t>(columns) * rows, nullptr);
+}
+
+TiledCanvas::TiledCanvas(const int width, const int height, const std::string& file_path, const std::uint32_t background)
+    : TiledCanvas(width, height, background)
+{
+    mapping_size = tiles.size() * TILE_PIXELS * sizeof(std::uint32_t);
+    const int fd = open(file_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to open \"" + file_path + "\": " + std::strerror(errno));
+    }
+    // A freshly truncated file is all holes, so only written tiles
+    // take up disk space
+    if (ftruncate(fd, static_cast<off_t>(mapping_size)) != 0) {
+        const int error = errno;
+        close(fd);
+        throw std::runtime_error("Unable to resize \"" + file_path + "\": " + std::strerror(error));
+    }
+    void* const address = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int error = errno;
+    close(fd);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("Unable to map \"" + file_path + "\": " + std::strerror(error));
+    }
+    mapping = static_cast<std::uint32_t*>(address);
+}
+
+TiledCanvas::~TiledCanvas()
+{
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+        return;
+    }
+    for (std::uint32_t* tile : tiles) {
+        delete[] tile;
+    }
+}
+
+std::uint32_t* TiledCanvas::allocate_tile(std::uint32_t*& tile, const int tx, const int ty)
+{
+    if (mapping != nullptr) {
+        tile = mapping + (((static_cast<std::size_t>(ty) * columns) + tx) * TILE_PIXELS);
+    } else {
+        tile = new std::uint32_t[TILE_PIXELS];
+    }
+    get_kernels().fill_u32(tile, TILE_PIXELS, background);
+    num_allocated++;
+    return tile;
+}
+
+std::uint32_t TiledCanvas::get_pixel(const int x, const int y) const
+{
+    if (x < 0 || x >= width || y < 0 || y >= height) {
+        throw std::out_of_range("TiledCanvas: pixel outside of canvas");
+    }
+    const std::uint32_t* tile = find_tile(x >> TILE_SHIFT, y >> TILE_SHIFT);
+    if (tile == nullptr) {
+        return background;
+    }
+    return tile[((y & TILE_MASK) << TILE_SHIFT) + (x & TILE_MASK)];
+}
+
+void TiledCanvas::set_pixel(const int x, const int y, const std::uint32_t color)
+{
+    if (x < 0 || x >= width || y < 0 || y >= height) {
+        throw std::out_of_range("TiledCanvas: pixel outside of canvas");
+    }
+    get_tile(x >> TILE_SHIFT, y >> TILE_SHIFT)[((y & TILE_MASK) << TILE_SHIFT) + (x & TILE_MASK)] = color;
+}
+
+void TiledCanvas::read_window(std::vector<std::uint32_t>& pixels, const int x, const int y) const
+{
+    if (pixels.size() < static_cast<std::size_t>(NUM_PIXELS)) {
+        throw std::out_of_range("TiledCanvas: frame smaller than the screen");
+    }
+    const Kernels& kernels = get_kernels();
+    kernels.fill_u32(pixels.data(), NUM_PIXELS, background);
+    const int x_min = std::max(x, 0);
+    const int y_min = std::max(y, 0);
+    const int x_max = std::min(x + SCREEN_WIDTH, width) - 1;
+    const int y_max = std::min(y + SCREEN_HEIGHT, height) - 1;
+    for (int cy = y_min; cy <= y_max; cy++) {
+        std::uint32_t* row = pixels.data() + (static_cast<std::size_t>(cy - y) * SCREEN_WIDTH);
+        for (int cx = x_min; cx <= x_max; cx = (cx | TILE_MASK) + 1) {
+            const int run_end = std::min(cx | TILE_MASK, x_max);
+            const std::uint32_t* tile = find_tile(cx >> TILE_SHIFT, cy >> TILE_SHIFT);
+            if (tile != nullptr) {
+                const std::uint32_t* src = tile + ((cy & TILE_MASK) << TILE_SHIFT) + (cx & TILE_MASK);
+                std::copy(src, src + (run_end - cx + 1), row + (cx - x));
+            }
+        }
+    }
+}
+
+void TiledCanvas::read_rows(std::uint32_t* dst, const int y, const int num_rows) const
+{
+    if (y < 0 || num_rows < 0 || y + num_rows > height) {
+        throw std::out_of_range("TiledCanvas: rows outside of canvas");
+    }
+    const Kernels& kernels = get_kernels();
+    for (int cy = y; cy < y + num_rows; cy++) {
+        for (int tx = 0; tx < columns; tx++) {
+            const int x0 = tx << TILE_SHIFT;
+            const int n = std::min(TILE_SIZE, width - x0);
+            const std::uint32_t* tile = find_tile(tx, cy >> TILE_SHIFT);
+            if (tile != nullptr) {
+                const std::uint32_t* src = tile + ((cy & TILE_MASK) << TILE_SHIFT);
+                std::copy(src, src + n, dst + x0);
+            } else {
+                kernels.fill_u32(dst + x0, n, background);
+            }
+        }
+        dst += width;
+    }
+}
+
+void TiledCanvas::flush()
+{
+    if (mapping != nullptr && msync(mapping, mapping_size, MS_SYNC) != 0) {
+        throw std::runtime_error(std::string("Unable to flush canvas: ") + std::strerror(errno));
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef TILED_CANVAS_H
+#define TILED_CANVAS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "constants.h"
+
+// Canvas of any size, split into square tiles that are allocated the
+// first time a pixel in them is written. Untouched tiles read as the
+// background color and take no memory.
+//
+// A file-backed canvas keeps its tiles in a sparse file mapped into
+// memory, so the OS pages them in and out and untouched tiles take no
+// disk space either. Each tile is stored contiguously in the file, in
+// row-major tile order.
+class TiledCanvas {
+public:
+    static constexpr int TILE_SHIFT = 8;
+    static constexpr int TILE_SIZE = 1 << TILE_SHIFT;
+    static constexpr int TILE_MASK = TILE_SIZE - 1;
+    static constexpr std::size_t TILE_PIXELS = std::size_t{TILE_SIZE} * TILE_SIZE;
+
+    TiledCanvas(const int width, const int height, const std::uint32_t background = blank);
+    // Creates or truncates file_path to hold the canvas
+    TiledCanvas(const int width, const int height, const std::string& file_path, const std::uint32_t background = blank);
+    ~TiledCanvas();
+
+    TiledCanvas(const TiledCanvas&) = delete;
+    TiledCanvas& operator=(const TiledCanvas&) = delete;
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+    std::uint32_t get_background() const { return background; }
+    // Size of the canvas in tiles
+    int get_columns() const { return columns; }
+    int get_rows() const { return rows; }
+    bool is_file_backed() const { return mapping != nullptr; }
+
+    std::size_t get_num_allocated_tiles() const { return num_allocated; }
+    std::size_t get_allocated_bytes() const { return num_allocated * TILE_PIXELS * sizeof(std::uint32_t); }
+
+    // Pixels of tile (tx, ty), TILE_SIZE per row. The tile is allocated
+    // and filled with the background on first use.
+    std::uint32_t* get_tile(const int tx, const int ty)
+    {
+        std::uint32_t*& tile = tiles[(static_cast<std::size_t>(ty) * columns) + tx];
+        return tile != nullptr ? tile : allocate_tile(tile, tx, ty);
+    }
+
+    // nullptr for tiles that were never written
+    const std::uint32_t* find_tile(const int tx, const int ty) const
+    {
+        return tiles[(static_cast<std::size_t>(ty) * columns) + tx];
+    }
+
+    // Throw std::out_of_range for pixels outside the canvas
+    std::uint32_t get_pixel(const int x, const int y) const;
+    void set_pixel(const int x, const int y, const std::uint32_t color);
+
+    // Copies the screen-sized window whose top left corner is (x, y)
+    // into a frame. Parts of the window outside the canvas get the
+    // background.
+    void read_window(std::vector<std::uint32_t>& pixels, const int x, const int y) const;
+
+    // Copies num_rows whole rows starting at row y into dst, one row
+    // every get_width() pixels. Throws std::out_of_range for rows
+    // outside the canvas.
+    void read_rows(std::uint32_t* dst, const int y, const int num_rows) const;
+
+    // Writes dirty pages of a file-backed canvas back to the file
+    void flush();
+
+private:
+    int width;
+    int height;
+    int columns;
+    int rows;
+    std::uint32_t background;
+    std::vector<std::uint32_t*> tiles;
+    std::size_t num_allocated;
+    // Whole-file mapping of a file-backed canvas
+    std::uint32_t* mapping;
+    std::size_t mapping_size;
+
+    std::uint32_t* allocate_tile(std::uint32_t*& tile, const int tx, const int ty);
+};
+
+#endif
@@ -0,0 +1,1261 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "bezier.h"
+#include "circle.h"
+#include "display_list.h"
+#include "line.h"
+#include "stroke.h"
+#include "scene.h"
+#include "stroke_animation.h"
+#include "svg.h"
+#include "fill.h"
+#include "frame_stream.h"
+#include "glyph_bundle.h"
+#include "deflate.h"
+#include "image_export.h"
+#include "kernels.h"
+#include "pixel_sink.h"
+#include "render_job.h"
+#include "span_shape.h"
+#include "stamp_cache.h"
+#include "tiled_canvas.h"
+#include "constants.h"
+
+// Golden-image regression suite.
+// Every case draws in a single color onto a blank frame. The covered
+// pixels, cropped to their bounding box, must match the stored PBM image
+// in tests/golden exactly, and the best-of-N draw time must not exceed
+// the time recorded in the baseline file by more than the threshold.
+// Checks of values the images cannot show, such as blended colors or
+// encoded files, run before the cases.
+//
+// Usage: draw2d-golden [--update-golden] [--update-baseline]
+//                      [--threshold <fraction>] [--reps <n>]
+// Paths are relative to the repository root.
+// Timings depend on the machine, so no baseline is committed: record one
+// with --update-baseline before comparing. Without it, or for cases it
+// does not list, only the images are checked and a warning says so.
+
+static const std::string golden_dir = "tests/golden/";
+static const std::string baseline_path = "tests/baseline.txt";
+constexpr std::uint32_t case_color = black;
+
+struct GoldenCase {
+    std::string name;
+    std::function<void(std::vector<std::uint32_t>&)> draw;
+};
+
+// Covered pixels of a frame, cropped to their bounding box
+struct GoldenImage {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<bool> bits;
+
+    bool operator==(const GoldenImage& other) const
+    {
+        return x == other.x && y == other.y && width == other.width && height == other.height && bits == other.bits;
+    }
+};
+
+static GoldenImage crop_frame(const std::vector<std::uint32_t>& pixels)
+{
+    int x_min = SCREEN_WIDTH;
+    int y_min = SCREEN_HEIGHT;
+    int x_max = -1;
+    int y_max = -1;
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            const std::uint32_t p = pixels[(y * SCREEN_WIDTH) + x];
+            if (p != blank && p != case_color) {
+                throw std::runtime_error("unexpected pixel value at (" + std::to_string(x) + ", " + std::to_string(y) + ")");
+            }
+            if (p == case_color) {
+                x_min = std::min(x_min, x);
+                y_min = std::min(y_min, y);
+                x_max = std::max(x_max, x);
+                y_max = std::max(y_max, y);
+            }
+        }
+    }
+
+    GoldenImage image;
+    if (x_max < 0) {
+        return image;
+    }
+    image.x = x_min;
+    image.y = y_min;
+    image.width = x_max - x_min + 1;
+    image.height = y_max - y_min + 1;
+    image.bits.resize(image.width * image.height);
+    for (int y = 0; y < image.height; y++) {
+        for (int x = 0; x < image.width; x++) {
+            image.bits[(y * image.width) + x] = pixels[((y + y_min) * SCREEN_WIDTH) + x + x_min] == case_color;
+        }
+    }
+    return image;
+}
+
+// Binary PBM (P4); the crop origin is kept in a comment line
+static void write_pbm(const std::string& file_path, const GoldenImage& image)
+{
+    std::ofstream file(file_path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open \"" + file_path + "\".");
+    }
+    file << "P4\n# origin " << image.x << " " << image.y << "\n" << image.width << " " << image.height << "\n";
+    const int row_bytes = (image.width + 7) / 8;
+    std::vector<char> row(row_bytes);
+    for (int y = 0; y < image.height; y++) {
+        std::fill(row.begin(), row.end(), 0);
+        for (int x = 0; x < image.width; x++) {
+            if (image.bits[(y * image.width) + x]) {
+                row[x / 8] |= 0x80 >> (x % 8);
+            }
+        }
+        file.write(row.data(), row_bytes);
+    }
+}
+
+static bool read_pbm(const std::string& file_path, GoldenImage& image)
+{
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string magic;
+    std::string comment;
+    std::string origin;
+    file >> magic >> comment >> origin >> image.x >> image.y >> image.width >> image.height;
+    file.get();
+    if (magic != "P4" || comment != "#" || origin != "origin") {
+        throw std::runtime_error("\"" + file_path + "\" is not a golden image.");
+    }
+    const int row_bytes = (image.width + 7) / 8;
+    std::vector<char> row(row_bytes);
+    image.bits.assign(image.width * image.height, false);
+    for (int y = 0; y < image.height; y++) {
+        file.read(row.data(), row_bytes);
+        for (int x = 0; x < image.width; x++) {
+            image.bits[(y * image.width) + x] = (row[x / 8] & (0x80 >> (x % 8))) != 0;
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+static int count_diff_pixels(const GoldenImage& a, const GoldenImage& b)
+{
+    int count = 0;
+    const int x0 = std::min(a.x, b.x);
+    const int y0 = std::min(a.y, b.y);
+    const int x1 = std::max(a.x + a.width, b.x + b.width);
+    const int y1 = std::max(a.y + a.height, b.y + b.height);
+    const auto test = [](const GoldenImage& image, const int x, const int y) {
+        if (x < image.x || y < image.y || x >= image.x + image.width || y >= image.y + image.height) {
+            return false;
+        }
+        return static_cast<bool>(image.bits[((y - image.y) * image.width) + (x - image.x)]);
+    };
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            count += test(a, x, y) != test(b, x, y);
+        }
+    }
+    return count;
+}
+
+static std::map<std::string, double> read_baseline()
+{
+    std::map<std::string, double> baseline;
+    std::ifstream file(baseline_path);
+    std::string name;
+    double us;
+    while (file >> name >> us) {
+        baseline[name] = us;
+    }
+    return baseline;
+}
+
+// Short lines in every direction, each in its own 120 x 120 cell so that
+// none overlap: every octant, both diagonals, the axes and a single point.
+static void draw_line_grid(
+    std::vector<std::uint32_t>& pixels,
+    const std::function<void(std::vector<std::uint32_t>&, const std::uint32_t, const int, const int, const int, const int)>& func)
+{
+    static const std::array<std::array<int, 2>, 20> offsets = {{
+        {50, 0}, {50, 20}, {50, 50}, {20, 50}, {0, 50},
+        {-20, 50}, {-50, 50}, {-50, 20}, {-50, 0}, {-50, -20},
+        {-50, -50}, {-20, -50}, {0, -50}, {20, -50}, {50, -50},
+        {50, -20}, {50, 1}, {1, 50}, {50, 49}, {0, 0}
+    }};
+    for (std::size_t i = 0; i < offsets.size(); i++) {
+        const int cx = 100 + (static_cast<int>(i % 5) * 120);
+        const int cy = 100 + (static_cast<int>(i / 5) * 120);
+        func(pixels, case_color, cx, cy, cx + offsets[i][0], cy + offsets[i][1]);
+    }
+}
+
+static std::vector<GoldenCase> get_cases()
+{
+    std::vector<GoldenCase> cases = {
+        {"lines_dda", [](std::vector<std::uint32_t>& p) { draw_line_grid(p, &draw_line_dda); }},
+        {"lines_bresenham", [](std::vector<std::uint32_t>& p) { draw_line_grid(p, &draw_line_bresenham); }},
+        {"lines_zingl", [](std::vector<std::uint32_t>& p) { draw_line_grid(p, &draw_line_zingl); }},
+        {"lines_run_slice", [](std::vector<std::uint32_t>& p) { draw_line_grid(p, &draw_line_run_slice); }},
+        {"lines_long", [](std::vector<std::uint32_t>& p) {
+            draw_line_bresenham(p, case_color, 100, SCREEN_HEIGHT - 1, 150, 0);
+            draw_line_bresenham(p, case_color, 0, Y_MID_SCREEN, SCREEN_WIDTH - 1, Y_MID_SCREEN - 100);
+            draw_line_zingl(p, case_color, 0, Y_MID_SCREEN + 50, SCREEN_WIDTH - 1, Y_MID_SCREEN + 150);
+            draw_line_dda(p, case_color, 300, 0, 350, SCREEN_HEIGHT - 1);
+        }},
+        {"lines_subpixel", [](std::vector<std::uint32_t>& p) {
+            // Fans of lines between points off the pixel centers, then
+            // the flattened medians of an AnimCJK glyph
+            for (int i = 0; i < 16; i++) {
+                const double d = 100.25 + (i * 26.5);
+                draw_line_subpixel(p, case_color, 300.3, 300.7, d, 80.5);
+                draw_line_subpixel(p, case_color, 80.5, d, 300.3, 300.7);
+                draw_line_subpixel(p, case_color, 300.3, 300.7, d + 400, 520.5);
+            }
+            StrokeAnimation("19976.svg").draw_medians(p, case_color);
+        }},
+        {"circles", [](std::vector<std::uint32_t>& p) {
+            static const std::array<int, 7> radii = {0, 1, 2, 3, 10, 57, 200};
+            int cx = 50;
+            for (const int r : radii) {
+                cx += r + 10;
+                draw_circle_midpoint(p, case_color, cx, Y_MID_SCREEN, r);
+                cx += r;
+            }
+        }},
+        {"bezier_quads", [](std::vector<std::uint32_t>& p) {
+            draw_bezier_quad(p, case_color, 100, 100, 600, 900, 1200, 200);
+            draw_bezier_quad(p, case_color, 100, 1000, 900, 100, 1800, 1000);
+            draw_bezier_quad(p, case_color, 1500, 100, 1800, 500, 1300, 900);
+            draw_bezier_quad(p, case_color, 200, 500, 205, 505, 210, 500);
+        }},
+        {"bezier_cubics", [](std::vector<std::uint32_t>& p) {
+            draw_bezier_cubic(p, case_color, 100, 900, 400, 100, 900, 1000, 1500, 100);
+            draw_bezier_cubic(p, case_color, 200, 200, 600, 100, 1000, 900, 1400, 800);
+            draw_bezier_cubic(p, case_color, 1600, 100, 1900, 300, 1900, 700, 1600, 1000);
+        }},
+        {"anti_aliased", [](std::vector<std::uint32_t>& p) {
+            draw_line_grid(p, &draw_line_zingl_aa);
+            static const std::array<int, 5> radii = {0, 1, 3, 10, 57};
+            int cx = 700;
+            for (const int r : radii) {
+                cx += r + 10;
+                draw_circle_midpoint_aa(p, case_color, cx, 200, r);
+                cx += r;
+            }
+            draw_circle_midpoint_aa(p, case_color, 1500, 300, 200);
+            draw_bezier_quad_aa(p, case_color, 100, 700, 400, 1000, 900, 650);
+            draw_bezier_quad_aa(p, case_color, 1000, 1000, 1300, 600, 1000, 550);
+            draw_bezier_cubic_aa(p, case_color, 1100, 1000, 1300, 600, 1600, 1070, 1850, 600);
+            // The image is the footprint: every pixel given any coverage.
+            // The coverage itself is checked by check_aa_coverage.
+            std::replace_if(p.begin(), p.end(), [](const std::uint32_t v) { return v != blank; }, case_color);
+        }},
+        {"strokes", [](std::vector<std::uint32_t>& p) {
+            const std::vector<Point> polyline = {{100, 300}, {300, 100}, {500, 300}, {700, 120}, {720, 300}};
+            StrokeStyle style;
+            style.width = 30;
+            for (int i = 0; i < 3; i++) {
+                std::vector<Point> shifted = polyline;
+                for (Point& point : shifted) {
+                    point.y += i * 300;
+                    point.x += (i % 2) * 900;
+                }
+                style.join = static_cast<LineJoin>(i);
+                style.cap = static_cast<LineCap>(i);
+                draw_stroke_polyline(p, case_color, shifted, style);
+            }
+            style.width = 7;
+            draw_stroke_line(p, case_color, 1000, 700, 1800, 1000, style);
+        }},
+        {"anim_19976", [](std::vector<std::uint32_t>& p) {
+            // Midway through the second stroke, drawn at 60 fps
+            StrokeAnimation animation("19976.svg");
+            for (int frame = 0; frame <= 150; frame++) {
+                animation.render_frame(p, case_color, frame / 60.0);
+            }
+        }},
+        {"frame_stream", [](std::vector<std::uint32_t>& p) {
+            // anim_19976 written as a stream and read back out of order,
+            // so the final frame is rebuilt from a keyframe and deltas
+            const std::string file_path = (std::filesystem::temp_directory_path() / "draw2d-golden.d2fs").string();
+            {
+                StrokeAnimation animation("19976.svg");
+                std::vector<std::uint32_t> frame(NUM_PIXELS, blank);
+                FrameStreamWriter writer(file_path, SCREEN_WIDTH, SCREEN_HEIGHT, 60);
+                for (int i = 0; i <= 150; i++) {
+                    animation.render_frame(frame, case_color, i / 60.0);
+                    writer.write_frame(frame);
+                }
+                writer.finish();
+            }
+            FrameStreamReader reader(file_path);
+            reader.read_frame(100);
+            reader.read_frame(30);
+            p = reader.read_frame(150);
+            std::remove(file_path.c_str());
+        }},
+        {"render_job", [](std::vector<std::uint32_t>& p) {
+            // Drawn in slices small enough to stop inside paths
+            DisplayList list;
+            list.record_circle(case_color, 1400, 500, 200);
+            list.record_svg(case_color, "19976.svg");
+            list.record_line(LineAlgorithm::bresenham, case_color, 1100, 900, 1800, 200);
+            RenderJob job(list, p);
+            while (!job.advance({std::chrono::microseconds(0), 2000})) {
+            }
+        }},
+        {"scene_edits", [](std::vector<std::uint32_t>& p) {
+            // Overlapping objects edited between incremental renders, the
+            // last edits moving paths partly off the screen
+            Scene scene;
+            const SceneObjectId line = scene.add_line(LineAlgorithm::zingl, case_color, 100, 100, 700, 400);
+            const SceneObjectId circle = scene.add_circle(case_color, 400, 250, 120);
+            scene.add_bezier_quad(case_color, 100, 400, 400, 0, 700, 400);
+            const SceneObjectId cubic = scene.add_bezier_cubic(case_color, 100, 500, 300, 300, 500, 700, 700, 500);
+            const std::vector<SceneObjectId> glyph = scene.add_svg(case_color, "19976.svg");
+            scene.render(p);
+            scene.move(circle, 40, -30);
+            scene.move(line, 0, 25);
+            scene.render(p);
+            scene.remove(cubic);
+            scene.move(glyph.at(1), 600, 0);
+            scene.set_color(line, blank);
+            scene.render(p);
+            // Paths moved partly off the right and bottom edges
+            scene.move(glyph.at(0), 1500, 0);
+            scene.move(glyph.at(2), 0, 600);
+            scene.render(p);
+        }},
+        {"tiled_canvas", [](std::vector<std::uint32_t>& p) {
+            // Drawn far from the origin of a canvas much larger than the
+            // screen, across tile boundaries, then read back as a window
+            TiledCanvas canvas(65536, 65536);
+            const int ox = 40000;
+            const int oy = 30000;
+            draw_line(canvas, case_color, LineAlgorithm::zingl, ox + 100, oy + 100, ox + 1800, oy + 1000);
+            draw_line(canvas, case_color, LineAlgorithm::bresenham, ox + 100, oy + 1000, ox + 1800, oy + 100);
+            draw_circle_midpoint(canvas, case_color, ox + 1400, oy + 300, 200);
+            flood_fill_stack(canvas, case_color, ox + 1400, oy + 300);
+            draw_bezier_quad(canvas, case_color, ox + 100, oy + 600, ox + 900, oy + 1000, ox + 1800, oy + 600);
+            draw_bezier_cubic(canvas, case_color, ox + 100, oy + 800, ox + 600, oy + 400, ox + 1200, oy + 1100, ox + 1800, oy + 800);
+            draw_svg(canvas, case_color, "19976.svg", ox, oy);
+            canvas.read_window(p, ox, oy);
+        }},
+        {"svg_lod", [](std::vector<std::uint32_t>& p) {
+            // 19976.svg at text sizes, simplified to the default tolerance,
+            // the last copy cut by the bottom edge
+            float x = 100;
+            for (const int size : {16, 24, 32, 48, 96}) {
+                draw_svg(p, case_color, "19976.svg", {size / 1024.0f, x + 0.25f, 500.5f});
+                x += size + 20;
+            }
+            draw_svg(p, case_color, "19976.svg", {96 / 1024.0f, x, SCREEN_HEIGHT - 40.0f});
+        }},
+        {"span_shapes", [](std::vector<std::uint32_t>& p) {
+            // A disc joined with 19976.svg, a ring cut out of both, and a
+            // copy of their overlap moved partly off the left edge
+            const SpanShape disc = get_circle_shape(900, 500, 300);
+            const SpanShape glyph = get_svg_shape("19976.svg");
+            const SpanShape ring = get_circle_shape(700, 500, 260).get_difference(get_circle_shape(700, 500, 200));
+            draw_shape(p, case_color, disc.get_union(glyph).get_difference(ring));
+            SpanShape overlap = disc.get_intersection(glyph);
+            overlap.translate(-700, 300);
+            draw_shape(p, case_color, overlap);
+        }},
+        {"path_edges", [](std::vector<std::uint32_t>& p) {
+            // Paths crossing each screen edge, filled directly, as a shape
+            // and a step at a time; only the fill is clipped
+            const std::vector<PathSegment> left = {
+                {PathSegmentType::line, {-200, 300, 200, 300}},
+                {PathSegmentType::quad, {200, 300, 300, 450, 200, 600}},
+                {PathSegmentType::line, {200, 600, -200, 600}},
+                {PathSegmentType::line, {-200, 600, -200, 300}}
+            };
+            const std::vector<PathSegment> top = {
+                {PathSegmentType::line, {600, -100, 900, -100}},
+                {PathSegmentType::cubic, {900, -100, 1000, 100, 800, 200, 600, 100}},
+                {PathSegmentType::line, {600, 100, 600, -100}}
+            };
+            const std::vector<PathSegment> corner = {
+                {PathSegmentType::line, {1800, 1000, 2000, 1000}},
+                {PathSegmentType::line, {2000, 1000, 2000, 1200}},
+                {PathSegmentType::line, {2000, 1200, 1800, 1200}},
+                {PathSegmentType::line, {1800, 1200, 1800, 1000}}
+            };
+            fill_path_segments_clipped(p, case_color, left);
+            draw_shape(p, case_color, get_path_shape(top));
+            PathFill fill(corner);
+            while (!fill.is_done()) {
+                fill.step(p, case_color);
+            }
+        }},
+        {"glyph_bundle", [](std::vector<std::uint32_t>& p) {
+            // Same as svg_19976, plus a copy running off the right edge
+            const std::filesystem::path dir = std::filesystem::temp_directory_path() / "draw2d-golden-glyphs";
+            std::filesystem::create_directories(dir);
+            std::filesystem::copy_file("19976.svg", dir / "19976.svg", std::filesystem::copy_options::overwrite_existing);
+            compile_glyph_bundle(dir.string(), (dir / "bundle.bin").string());
+            const GlyphBundle bundle((dir / "bundle.bin").string());
+            bundle.draw_glyph(p, case_color, 19976);
+            bundle.draw_glyph(p, case_color, 19976, 1500, 40);
+            std::filesystem::remove_all(dir);
+        }},
+        {"stamps", [](std::vector<std::uint32_t>& p) {
+            // Plot markers repeated through a stamp cache small enough to
+            // evict, including some cut by the screen edges
+            StampCache cache(200);
+            for (int y = -10; y < SCREEN_HEIGHT + 10; y += 90) {
+                for (int x = -10; x < SCREEN_WIDTH + 10; x += 120) {
+                    cache.draw_circle(p, case_color, x, y, 4 + ((x + y) / 30) % 12);
+                    cache.draw_bezier_quad(p, case_color, x + 20, y, x + 35, y - 30, x + 50, y);
+                    cache.draw_bezier_cubic(p, case_color, x + 20, y + 20, x + 30, y + 50, x + 45, y - 10, x + 55, y + 20);
+                }
+            }
+        }},
+    };
+
+    static const std::array<std::string, 4> corpus = {
+        "19976.svg",
+        "tests/corpus/box.svg",
+        "tests/corpus/edges.svg",
+        "tests/corpus/strokes.svg"
+    };
+    for (const std::string& file_path : corpus) {
+        const std::size_t slash = file_path.find_last_of('/');
+        const std::string stem = file_path.substr(slash == std::string::npos ? 0 : slash + 1);
+        cases.push_back({"svg_" + stem.substr(0, stem.find('.')), [file_path](std::vector<std::uint32_t>& p) {
+            draw_svg(p, case_color, file_path);
+        }});
+    }
+    return cases;
+}
+
+// Checks of exact values that a covered-pixel image cannot show. Each
+// returns an empty string when it passes and the failure otherwise.
+struct GoldenCheck {
+    std::string name;
+    std::function<std::string()> run;
+};
+
+static std::string check_opaque_blend()
+{
+    const std::uint32_t color = 0xFF3C7AE1;
+    // Lengths covering the vector bodies and the scalar tails
+    const std::vector<std::size_t> lengths = {1, 3, 4, 7, 8, 15, 16, 17, 33, 100};
+    const int max_level = static_cast<int>(get_supported_isa_level());
+    for (int level = 0; level <= max_level; level++) {
+        const Kernels& kernels = get_kernels(static_cast<IsaLevel>(level));
+        for (const std::size_t n : lengths) {
+            std::vector<std::uint32_t> dst(n, blank);
+            kernels.blend_u32(dst.data(), n, color);
+            if (std::count(dst.begin(), dst.end(), color) != static_cast<std::ptrdiff_t>(n)) {
+                return "blend_u32 (" + get_isa_level_name(static_cast<IsaLevel>(level)) + ", n = " + std::to_string(n) + ") changed the color";
+            }
+        }
+    }
+    std::vector<std::uint32_t> pixels(NUM_PIXELS, blank);
+    BlendSink sink(pixels, color);
+    sink.plot(10, 10);
+    sink.span(20, 60, 10);
+    if (pixels[(10 * SCREEN_WIDTH) + 10] != color || std::count(pixels.begin(), pixels.end(), color) != 42) {
+        return "BlendSink changed the color";
+    }
+    return "";
+}
+
+// Coverage of each pixel an anti-aliased curve drew in black on white,
+// from 0 to 1
+static double get_coverage(const std::vector<std::uint32_t>& pixels, const int x, const int y)
+{
+    return (255 - (pixels[(y * SCREEN_WIDTH) + x] & 0xFF)) / 255.0;
+}
+
+static double get_coverage_sum(const std::vector<std::uint32_t>& pixels)
+{
+    double sum = 0;
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            sum += get_coverage(pixels, x, y);
+        }
+    }
+    return sum;
+}
+
+// Length of the curve through point(t) for t in [0, 1]
+static double get_curve_length(const std::function<std::array<double, 2>(double)>& point)
+{
+    constexpr int num_steps = 4096;
+    double length = 0;
+    std::array<double, 2> prev = point(0);
+    for (int i = 1; i <= num_steps; i++) {
+        const std::array<double, 2> next = point(static_cast<double>(i) / num_steps);
+        length += std::hypot(next[0] - prev[0], next[1] - prev[1]);
+        prev = next;
+    }
+    return length;
+}
+
+// The anti-aliased image only shows the footprint, so the coverage is
+// checked here: each column of a gradual line adds up to about one
+// pixel, as does the total over the length of curves, and pixels on the
+// line are written exactly.
+static std::string check_aa_coverage()
+{
+    const std::uint32_t white = 0xFFFFFFFF;
+    std::vector<std::uint32_t> pixels(NUM_PIXELS, white);
+    draw_line_zingl_aa(pixels, black, 100, 100, 900, 400);
+    if (pixels[(100 * SCREEN_WIDTH) + 100] != black || pixels[(400 * SCREEN_WIDTH) + 900] != black) {
+        return "line endpoints not written exactly";
+    }
+    for (int x = 101; x < 900; x++) {
+        double sum = 0;
+        for (int y = 90; y <= 410; y++) {
+            sum += get_coverage(pixels, x, y);
+        }
+        if (sum < 1.0 || sum > 1.2) {
+            return "line column " + std::to_string(x) + " covers " + std::to_string(sum) + " pixels";
+        }
+    }
+
+    struct Curve {
+        std::string name;
+        std::function<void(std::vector<std::uint32_t>&)> draw;
+        std::function<std::array<double, 2>(double)> point;
+    };
+    const auto quad = [](const double x0, const double y0, const double x1, const double y1, const double x2, const double y2) {
+        return [=](const double t) {
+            const double u = 1 - t;
+            return std::array<double, 2>{(u * u * x0) + (2 * u * t * x1) + (t * t * x2), (u * u * y0) + (2 * u * t * y1) + (t * t * y2)};
+        };
+    };
+    const std::vector<Curve> curves = {
+        {"quad", [](std::vector<std::uint32_t>& p) { draw_bezier_quad_aa(p, black, 100, 700, 400, 1000, 900, 650); },
+            quad(100, 700, 400, 1000, 900, 650)},
+        {"tight quad", [](std::vector<std::uint32_t>& p) { draw_bezier_quad_aa(p, black, 1000, 1000, 1300, 600, 1000, 550); },
+            quad(1000, 1000, 1300, 600, 1000, 550)},
+        {"cubic", [](std::vector<std::uint32_t>& p) { draw_bezier_cubic_aa(p, black, 1100, 1000, 1300, 600, 1600, 1070, 1850, 600); },
+            [](const double t) {
+                const double u = 1 - t;
+                const double a = u * u * u;
+                const double b = 3 * u * u * t;
+                const double c = 3 * u * t * t;
+                const double d = t * t * t;
+                return std::array<double, 2>{(a * 1100) + (b * 1300) + (c * 1600) + (d * 1850), (a * 1000) + (b * 600) + (c * 1070) + (d * 600)};
+            }},
+        {"circle", [](std::vector<std::uint32_t>& p) { draw_circle_midpoint_aa(p, black, 900, 500, 200); },
+            [](const double t) { return std::array<double, 2>{900 + (200 * std::cos(2 * M_PI * t)), 500 + (200 * std::sin(2 * M_PI * t))}; }}
+    };
+    for (const Curve& curve : curves) {
+        std::fill(pixels.begin(), pixels.end(), white);
+        curve.draw(pixels);
+        const double ratio = get_coverage_sum(pixels) / get_curve_length(curve.point);
+        if (ratio < 0.95 || ratio > 1.05) {
+            return curve.name + " covers " + std::to_string(ratio) + " pixels per pixel of length";
+        }
+    }
+    return "";
+}
+
+// Reads deflate streams bit by bit, least significant bit first
+struct BitReader {
+    const std::uint8_t* data;
+    std::size_t size;
+    std::size_t pos = 0;
+    int bit = 0;
+    bool overrun = false;
+
+    std::uint32_t get(const int num_bits)
+    {
+        std::uint32_t value = 0;
+        for (int i = 0; i < num_bits; i++) {
+            if (pos >= size) {
+                overrun = true;
+                return 0;
+            }
+            value |= ((data[pos] >> bit) & 1u) << i;
+            if (++bit == 8) {
+                bit = 0;
+                pos++;
+            }
+        }
+        return value;
+    }
+
+    void align()
+    {
+        if (bit != 0) {
+            bit = 0;
+            pos++;
+        }
+    }
+};
+
+// Canonical Huffman code: the number of codes of each length and the
+// symbols in code order
+struct HuffmanCode {
+    std::array<int, 16> counts{};
+    std::vector<int> symbols;
+
+    explicit HuffmanCode(const std::vector<int>& lengths)
+    {
+        for (const int length : lengths) {
+            counts[length]++;
+        }
+        counts[0] = 0;
+        std::array<int, 16> offsets{};
+        for (int i = 1; i < 15; i++) {
+            offsets[i + 1] = offsets[i] + counts[i];
+        }
+        symbols.resize(lengths.size());
+        for (std::size_t symbol = 0; symbol < lengths.size(); symbol++) {
+            if (lengths[symbol] != 0) {
+                symbols[offsets[lengths[symbol]]++] = static_cast<int>(symbol);
+            }
+        }
+    }
+
+    // The next symbol, or -1 for an invalid code
+    int decode(BitReader& reader) const
+    {
+        int code = 0;
+        int first = 0;
+        int index = 0;
+        for (int length = 1; length < 16; length++) {
+            code |= static_cast<int>(reader.get(1));
+            if (code - counts[length] < first) {
+                return symbols[index + (code - first)];
+            }
+            index += counts[length];
+            first = (first + counts[length]) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+};
+
+// Inflate (RFC 1951) to check the compressor against, after Mark Adler's
+// puff. Returns false for malformed data.
+static bool inflate(BitReader& reader, std::vector<std::uint8_t>& out)
+{
+    static const std::array<int, 29> length_base = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const std::array<int, 29> length_extra = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const std::array<int, 30> dist_base = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+        1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static const std::array<int, 30> dist_extra = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    static const std::array<int, 19> length_order = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+    bool is_last = false;
+    while (!is_last && !reader.overrun) {
+        is_last = reader.get(1) != 0;
+        const std::uint32_t type = reader.get(2);
+        if (type == 0) {
+            reader.align();
+            if (reader.pos + 4 > reader.size) {
+                return false;
+            }
+            const std::uint8_t* header = reader.data + reader.pos;
+            const std::size_t length = header[0] | (header[1] << 8);
+            if ((length ^ (header[2] | (header[3] << 8))) != 0xFFFF || reader.pos + 4 + length > reader.size) {
+                return false;
+            }
+            out.insert(out.end(), header + 4, header + 4 + length);
+            reader.pos += 4 + length;
+            continue;
+        }
+        if (type == 3) {
+            return false;
+        }
+
+        std::vector<int> lengths(288 + 30);
+        int num_lengths = 288;
+        int num_dists = 30;
+        if (type == 1) {
+            std::fill(lengths.begin(), lengths.begin() + 144, 8);
+            std::fill(lengths.begin() + 144, lengths.begin() + 256, 9);
+            std::fill(lengths.begin() + 256, lengths.begin() + 280, 7);
+            std::fill(lengths.begin() + 280, lengths.begin() + 288, 8);
+            std::fill(lengths.begin() + 288, lengths.end(), 5);
+        } else {
+            num_lengths = static_cast<int>(reader.get(5)) + 257;
+            num_dists = static_cast<int>(reader.get(5)) + 1;
+            const int num_code_lengths = static_cast<int>(reader.get(4)) + 4;
+            std::vector<int> code_lengths(19);
+            for (int i = 0; i < num_code_lengths; i++) {
+                code_lengths[length_order[i]] = static_cast<int>(reader.get(3));
+            }
+            const HuffmanCode code_length_code(code_lengths);
+            lengths.assign(num_lengths + num_dists, 0);
+            for (int i = 0; i < num_lengths + num_dists;) {
+                const int symbol = code_length_code.decode(reader);
+                if (symbol < 0) {
+                    return false;
+                }
+                if (symbol < 16) {
+                    lengths[i++] = symbol;
+                    continue;
+                }
+                int repeat = 0;
+                int value = 0;
+                if (symbol == 16) {
+                    if (i == 0) {
+                        return false;
+                    }
+                    value = lengths[i - 1];
+                    repeat = 3 + static_cast<int>(reader.get(2));
+                } else {
+                    repeat = symbol == 17 ? 3 + static_cast<int>(reader.get(3)) : 11 + static_cast<int>(reader.get(7));
+                }
+                if (i + repeat > num_lengths + num_dists) {
+                    return false;
+                }
+                std::fill(lengths.begin() + i, lengths.begin() + i + repeat, value);
+                i += repeat;
+            }
+        }
+        const HuffmanCode length_code(std::vector<int>(lengths.begin(), lengths.begin() + num_lengths));
+        const HuffmanCode dist_code(std::vector<int>(lengths.begin() + num_lengths, lengths.begin() + num_lengths + num_dists));
+        while (true) {
+            const int symbol = length_code.decode(reader);
+            if (symbol < 0 || symbol > 285 || reader.overrun) {
+                return false;
+            }
+            if (symbol < 256) {
+                out.push_back(static_cast<std::uint8_t>(symbol));
+                continue;
+            }
+            if (symbol == 256) {
+                break;
+            }
+            const int length = length_base[symbol - 257] + static_cast<int>(reader.get(length_extra[symbol - 257]));
+            const int dist_symbol = dist_code.decode(reader);
+            if (dist_symbol < 0 || dist_symbol > 29) {
+                return false;
+            }
+            const std::size_t dist = dist_base[dist_symbol] + reader.get(dist_extra[dist_symbol]);
+            if (dist > out.size()) {
+                return false;
+            }
+            for (int i = 0; i < length; i++) {
+                out.push_back(out[out.size() - dist]);
+            }
+        }
+    }
+    return !reader.overrun;
+}
+
+static std::uint32_t get_u32_be(const std::uint8_t* p)
+{
+    return (static_cast<std::uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static std::vector<std::uint8_t> read_file(const std::string& file_path)
+{
+    std::ifstream file(file_path, std::ios::binary);
+    return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static std::string check_checksums()
+{
+    const std::string digits = "123456789";
+    const std::string text = "Wikipedia";
+    const auto bytes = [](const std::string& str) { return reinterpret_cast<const std::uint8_t*>(str.data()); };
+    if (crc32(bytes(digits), digits.size()) != 0xCBF43926) {
+        return "wrong CRC-32 of \"" + digits + "\"";
+    }
+    if (crc32(bytes(digits) + 4, 5, crc32(bytes(digits), 4)) != 0xCBF43926) {
+        return "CRC-32 changes when computed in pieces";
+    }
+    if (adler32(bytes(text), text.size()) != 0x11E60398) {
+        return "wrong Adler-32 of \"" + text + "\"";
+    }
+    // Long enough that the sums are reduced more than once
+    std::vector<std::uint8_t> data(100000);
+    std::uint32_t seed = 1;
+    for (std::uint8_t& byte : data) {
+        seed = (seed * 1103515245) + 12345;
+        byte = static_cast<std::uint8_t>(seed >> 24);
+    }
+    const std::uint32_t whole = adler32(data.data(), data.size());
+    if (adler32(data.data() + 30000, 70000, adler32(data.data(), 30000)) != whole) {
+        return "Adler-32 changes when computed in pieces";
+    }
+    if (adler32_combine(adler32(data.data(), 30000), adler32(data.data() + 30000, 70000), 70000) != whole) {
+        return "adler32_combine differs from Adler-32 of the whole";
+    }
+    return "";
+}
+
+static std::string check_deflate()
+{
+    std::vector<std::uint8_t> empty;
+    deflate_append(empty, nullptr, 0);
+    if (empty != std::vector<std::uint8_t>{0x00, 0x00, 0x00, 0xFF, 0xFF}) {
+        return "empty input is not a single empty stored block";
+    }
+
+    // Text, runs of one byte across several blocks, noise that is stored
+    // rather than compressed, and the three joined from separate streams
+    std::vector<std::vector<std::uint8_t>> inputs(3);
+    const std::string text = "The quick brown fox jumps over the lazy dog. ";
+    for (int i = 0; i < 200; i++) {
+        inputs[0].insert(inputs[0].end(), text.begin(), text.end() - (i % 7));
+    }
+    inputs[1].assign(100000, 0x5A);
+    inputs[2].resize(70000);
+    std::uint32_t seed = 7;
+    for (std::uint8_t& byte : inputs[2]) {
+        seed = (seed * 1103515245) + 12345;
+        byte = static_cast<std::uint8_t>(seed >> 24);
+    }
+    std::vector<std::uint8_t> joined;
+    std::vector<std::uint8_t> joined_stream;
+    for (const std::vector<std::uint8_t>& input : inputs) {
+        std::vector<std::uint8_t> stream;
+        deflate_append(stream, input.data(), input.size());
+        joined_stream.insert(joined_stream.end(), stream.begin(), stream.end());
+        joined.insert(joined.end(), input.begin(), input.end());
+        stream.insert(stream.end(), DEFLATE_FINAL_BLOCK.begin(), DEFLATE_FINAL_BLOCK.end());
+        BitReader reader{stream.data(), stream.size()};
+        std::vector<std::uint8_t> output;
+        if (!inflate(reader, output) || output != input) {
+            return "round trip of " + std::to_string(input.size()) + " bytes failed";
+        }
+    }
+    joined_stream.insert(joined_stream.end(), DEFLATE_FINAL_BLOCK.begin(), DEFLATE_FINAL_BLOCK.end());
+    BitReader reader{joined_stream.data(), joined_stream.size()};
+    std::vector<std::uint8_t> output;
+    if (!inflate(reader, output) || output != joined) {
+        return "round trip of separately compressed pieces failed";
+    }
+    return "";
+}
+
+// Pixels of an 8-bit RGB PNG as opaque ARGB, checking every chunk's CRC
+// and the zlib checksum; empty if the file is not such a PNG
+static std::vector<std::uint32_t> read_png(const std::string& file_path, int& width, int& height)
+{
+    const std::vector<std::uint8_t> file = read_file(file_path);
+    static const std::array<std::uint8_t, 8> signature = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (file.size() < 8 || !std::equal(signature.begin(), signature.end(), file.begin())) {
+        return {};
+    }
+    std::vector<std::uint8_t> zlib;
+    std::size_t pos = 8;
+    while (pos + 12 <= file.size()) {
+        const std::uint32_t length = get_u32_be(&file[pos]);
+        if (pos + 12 + length > file.size() || crc32(&file[pos + 4], length + 4) != get_u32_be(&file[pos + 8 + length])) {
+            return {};
+        }
+        const std::string type(file.begin() + pos + 4, file.begin() + pos + 8);
+        const std::uint8_t* data = &file[pos + 8];
+        if (type == "IHDR") {
+            width = static_cast<int>(get_u32_be(data));
+            height = static_cast<int>(get_u32_be(data + 4));
+            if (data[8] != 8 || data[9] != 2) {
+                return {};
+            }
+        } else if (type == "IDAT") {
+            zlib.insert(zlib.end(), data, data + length);
+        }
+        pos += 12 + length;
+    }
+
+    BitReader reader{zlib.data(), zlib.size(), 2};
+    std::vector<std::uint8_t> raw;
+    const std::size_t row_bytes = 1 + (static_cast<std::size_t>(width) * 3);
+    if (zlib.size() < 6 || !inflate(reader, raw) || raw.size() != row_bytes * height) {
+        return {};
+    }
+    reader.align();
+    if (reader.pos + 4 > zlib.size() || get_u32_be(&zlib[reader.pos]) != adler32(raw.data(), raw.size())) {
+        return {};
+    }
+
+    // Undo the filters in place, then pack the channels
+    std::vector<std::uint32_t> pixels(static_cast<std::size_t>(width) * height);
+    for (int y = 0; y < height; y++) {
+        std::uint8_t* row = &raw[(y * row_bytes) + 1];
+        const std::uint8_t* above = y > 0 ? row - row_bytes : nullptr;
+        for (std::size_t i = 0; i < row_bytes - 1; i++) {
+            const int a = i >= 3 ? row[i - 3] : 0;
+            const int b = above ? above[i] : 0;
+            const int c = above && i >= 3 ? above[i - 3] : 0;
+            const int p = a + b - c;
+            const int paeth = std::abs(p - a) <= std::abs(p - b) && std::abs(p - a) <= std::abs(p - c) ? a
+                : std::abs(p - b) <= std::abs(p - c) ? b : c;
+            const std::array<int, 5> predictions = {0, a, b, (a + b) / 2, paeth};
+            row[i] = static_cast<std::uint8_t>(row[i] + predictions.at(row[-1]));
+        }
+        for (int x = 0; x < width; x++) {
+            pixels[(y * width) + x] = 0xFF000000 | (row[3 * x] << 16) | (row[(3 * x) + 1] << 8) | row[(3 * x) + 2];
+        }
+    }
+    return pixels;
+}
+
+// Pixels of a QOI file as ARGB; empty if the file is not a QOI image
+static std::vector<std::uint32_t> read_qoi(const std::string& file_path, int& width, int& height)
+{
+    const std::vector<std::uint8_t> file = read_file(file_path);
+    if (file.size() < 22 || !std::equal(file.begin(), file.begin() + 4, "qoif")) {
+        return {};
+    }
+    width = static_cast<int>(get_u32_be(&file[4]));
+    height = static_cast<int>(get_u32_be(&file[8]));
+    std::vector<std::uint32_t> pixels;
+    std::array<std::uint32_t, 64> index{};
+    std::uint32_t r = 0;
+    std::uint32_t g = 0;
+    std::uint32_t b = 0;
+    std::uint32_t a = 255;
+    std::size_t pos = 14;
+    const std::size_t num_pixels = static_cast<std::size_t>(width) * height;
+    while (pixels.size() < num_pixels && pos < file.size() - 8) {
+        const std::uint8_t op = file[pos++];
+        int run = 1;
+        if (op == 0xFE || op == 0xFF) {
+            r = file[pos];
+            g = file[pos + 1];
+            b = file[pos + 2];
+            pos += 3;
+            if (op == 0xFF) {
+                a = file[pos++];
+            }
+        } else if ((op >> 6) == 0) {
+            const std::uint32_t v = index[op];
+            a = v >> 24;
+            r = (v >> 16) & 0xFF;
+            g = (v >> 8) & 0xFF;
+            b = v & 0xFF;
+        } else if ((op >> 6) == 1) {
+            r = (r + ((op >> 4) & 3) - 2) & 0xFF;
+            g = (g + ((op >> 2) & 3) - 2) & 0xFF;
+            b = (b + (op & 3) - 2) & 0xFF;
+        } else if ((op >> 6) == 2) {
+            const int dg = (op & 0x3F) - 32;
+            const std::uint8_t next = file[pos++];
+            r = (r + dg + (next >> 4) - 8) & 0xFF;
+            g = (g + dg) & 0xFF;
+            b = (b + dg + (next & 0xF) - 8) & 0xFF;
+        } else {
+            run = (op & 0x3F) + 1;
+        }
+        const std::uint32_t v = (a << 24) | (r << 16) | (g << 8) | b;
+        index[((r * 3) + (g * 5) + (b * 7) + (a * 11)) % 64] = v;
+        pixels.insert(pixels.end(), run, v);
+    }
+    static const std::array<std::uint8_t, 8> end_marker = {0, 0, 0, 0, 0, 0, 0, 1};
+    if (pixels.size() != num_pixels || pos + 8 != file.size() || !std::equal(end_marker.begin(), end_marker.end(), file.end() - 8)) {
+        return {};
+    }
+    return pixels;
+}
+
+// A frame with colors, gradients and flat areas written as PNG and QOI,
+// whole and by PngWriter in uneven pieces, and read back
+static std::string check_image_round_trip()
+{
+    std::vector<std::uint32_t> pixels(NUM_PIXELS, blank);
+    for (int y = 0; y < 256; y++) {
+        for (int x = 0; x < 768; x++) {
+            pixels[(y * SCREEN_WIDTH) + x] = 0xFF000000 | (x << 16) | (y << 8) | ((x * y) & 0xFF);
+        }
+    }
+    draw_circle_midpoint_aa(pixels, 0xFF3C7AE1, 1200, 500, 300);
+    draw_svg(pixels, 0xFFE1503C, "19976.svg");
+    std::vector<std::uint32_t> expected(pixels);
+    for (std::uint32_t& p : expected) {
+        p |= 0xFF000000;
+    }
+
+    const std::string png_path = (std::filesystem::temp_directory_path() / "draw2d-golden.png").string();
+    const std::string qoi_path = (std::filesystem::temp_directory_path() / "draw2d-golden.qoi").string();
+    int width = 0;
+    int height = 0;
+    write_png(png_path, pixels);
+    if (read_png(png_path, width, height) != expected || width != SCREEN_WIDTH || height != SCREEN_HEIGHT) {
+        return "PNG round trip failed";
+    }
+    write_qoi(qoi_path, pixels);
+    if (read_qoi(qoi_path, width, height) != expected || width != SCREEN_WIDTH || height != SCREEN_HEIGHT) {
+        return "QOI round trip failed";
+    }
+
+    // A 97 x 61 window in rows of 1 to 7, on two threads
+    {
+        PngWriter writer(png_path, 97, 61, 2);
+        for (int y = 0; y < 61; y += 1 + (y % 7)) {
+            writer.write_rows(pixels.data() + ((y + 200) * SCREEN_WIDTH) + 700, std::min(1 + (y % 7), 61 - y), SCREEN_WIDTH);
+        }
+        writer.finish();
+    }
+    const std::vector<std::uint32_t> window = read_png(png_path, width, height);
+    std::filesystem::remove(png_path);
+    std::filesystem::remove(qoi_path);
+    if (width != 97 || height != 61 || window.size() != 97 * 61) {
+        return "PNG window round trip failed";
+    }
+    for (int y = 0; y < 61; y++) {
+        for (int x = 0; x < 97; x++) {
+            if (window[(y * 97) + x] != expected[((y + 200) * SCREEN_WIDTH) + x + 700]) {
+                return "PNG window round trip failed";
+            }
+        }
+    }
+    return "";
+}
+
+// Paths crossing the screen edges are clipped, not wrapped, whichever
+// way the file is drawn
+static std::string check_svg_replay()
+{
+    const std::string file_path = "tests/corpus/edges.svg";
+    std::vector<std::uint32_t> expected(NUM_PIXELS, blank);
+    draw_svg(expected, case_color, file_path);
+
+    DisplayList list;
+    list.record_svg(case_color, file_path);
+    std::vector<std::uint32_t> pixels(NUM_PIXELS, blank);
+    list.replay(pixels);
+    if (pixels != expected) {
+        return "replay of " + file_path + " differs from draw_svg";
+    }
+    return "";
+}
+
+// A job split into tiny steps, down to one row or segment at a time,
+// ends on the same frame as replaying the list at once
+static std::string check_render_job()
+{
+    DisplayList list;
+    list.record_svg(case_color, "tests/corpus/edges.svg");
+    std::vector<std::uint32_t> expected(NUM_PIXELS, blank);
+    list.replay(expected);
+
+    for (const std::size_t budget : {1, 7, 1000}) {
+        std::vector<std::uint32_t> pixels(NUM_PIXELS, blank);
+        RenderJob job(list, pixels);
+        while (!job.advance({std::chrono::microseconds(0), budget})) {
+        }
+        if (pixels != expected) {
+            return "job with a budget of " + std::to_string(budget) + " pixels differs from replay";
+        }
+    }
+    return "";
+}
+
+// A glyph moved by whole pixels, some of them across the screen edges,
+// draws the same pixels moved, whether the fill simplifies it anew or
+// reuses the simplified paths and masks it keeps
+static std::string check_path_lod_cache()
+{
+    std::vector<std::vector<PathSegment>> glyph;
+    for (const std::string& path : get_paths_from_svg("19976.svg")) {
+        glyph.push_back(parse_path(path));
+    }
+    constexpr int origin = 300;
+    std::vector<std::uint32_t> expected(NUM_PIXELS, blank);
+    std::vector<std::uint32_t> pixels(NUM_PIXELS, blank);
+    TransformedPathFill cached;
+    for (int pass = 0; pass < 2; pass++) {
+        for (const int size : {16, 24, 200}) {
+            for (int k = 0; k < 12; k++) {
+                const float phase_x = (k % 5) * 0.13f;
+                const float phase_y = (k % 7) * 0.19f;
+                const int move_x = ((k % 4) * 620) - origin - (size / 2);
+                const int move_y = ((k / 4) * 500) - origin - (size / 2);
+                std::fill(expected.begin(), expected.end(), blank);
+                std::fill(pixels.begin(), pixels.end(), blank);
+                for (const std::vector<PathSegment>& path : glyph) {
+                    TransformedPathFill fresh;
+                    fresh.fill(expected, case_color, path, {size / 1024.0f, origin + phase_x, origin + phase_y});
+                    cached.fill(pixels, case_color, path, {size / 1024.0f, origin + move_x + phase_x, origin + move_y + phase_y});
+                }
+                for (int y = origin - 2; y <= origin + size + 2; y++) {
+                    for (int x = origin - 2; x <= origin + size + 2; x++) {
+                        const int moved_x = x + move_x;
+                        const int moved_y = y + move_y;
+                        if (moved_x >= 0 && moved_x < SCREEN_WIDTH && moved_y >= 0 && moved_y < SCREEN_HEIGHT
+                            && pixels[(moved_y * SCREEN_WIDTH) + moved_x] != expected[(y * SCREEN_WIDTH) + x]) {
+                            return "glyph at " + std::to_string(size) + " px differs when moved by (" + std::to_string(move_x)
+                                + ", " + std::to_string(move_y) + ")";
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return "";
+}
+
+// Float keys that compare equal share a stamp, and a cubic that cannot
+// be drawn leaves nothing in the cache for eviction to trip over
+static std::string check_stamp_keys()
+{
+    std::vector<std::uint32_t> pixels(NUM_PIXELS, blank);
+    StampCache cache(64);
+    cache.draw_bezier_cubic(pixels, case_color, 100, 100, 100.0f, 110.0f, 120.0f, 90.0f, 130, 100);
+    cache.draw_bezier_cubic(pixels, case_color, 0, 100, -0.0f, 110.0f, 20.0f, 90.0f, 30, 100);
+    if (cache.get_num_stamps() != 1) {
+        return "-0.0 and 0.0 control points made " + std::to_string(cache.get_num_stamps()) + " stamps";
+    }
+    cache.draw_bezier_cubic(pixels, case_color, 200, 100, std::nanf(""), 110.0f, 220.0f, 90.0f, 230, 100);
+    if (cache.get_num_stamps() != 1) {
+        return "a cubic with a NaN control point was cached";
+    }
+    // Evicts everything more than once over
+    for (int r = 1; r < 40; r++) {
+        cache.draw_circle(pixels, case_color, 500, 500, r);
+    }
+    if (cache.get_num_spans() > 64 || cache.get_num_stamps() > cache.get_num_spans()) {
+        return "eviction left " + std::to_string(cache.get_num_stamps()) + " stamps";
+    }
+    return "";
+}
+
+static std::vector<GoldenCheck> get_checks()
+{
+    return {
+        {"opaque_blend", check_opaque_blend},
+        {"aa_coverage", check_aa_coverage},
+        {"checksums", check_checksums},
+        {"deflate", check_deflate},
+        {"image_round_trip", check_image_round_trip},
+        {"svg_replay", check_svg_replay},
+        {"render_job_replay", check_render_job},
+        {"path_lod_cache", check_path_lod_cache},
+        {"stamp_keys", check_stamp_keys}
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    bool update_golden = false;
+    bool update_baseline = false;
+    double threshold = 0.5;
+    int reps = 5;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--update-golden") {
+            update_golden = true;
+        } else if (arg == "--update-baseline") {
+            update_baseline = true;
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            threshold = std::atof(argv[++i]);
+        } else if (arg == "--reps" && i + 1 < argc) {
+            reps = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    const std::map<std::string, double> baseline = read_baseline();
+    if (baseline.empty() && !update_baseline) {
+        std::cerr << "WARNING: no timings in " << baseline_path << ", draw times are not compared;"
+            << " run draw2d-golden --update-baseline to record them\n\n";
+    }
+    std::ostringstream new_baseline;
+    std::vector<std::uint32_t> pixels(NUM_PIXELS);
+    int num_failures = 0;
+    int num_unbaselined = 0;
+
+    std::cout << std::left << std::setw(24) << "check" << "result\n";
+    for (const GoldenCheck& check : get_checks()) {
+        const std::string error = check.run();
+        if (!error.empty()) {
+            num_failures++;
+        }
+        std::cout << std::left << std::setw(24) << check.name << (error.empty() ? "ok" : "FAIL: " + error) << "\n";
+    }
+    std::cout << "\n";
+
+    std::cout << std::left << std::setw(24) << "case" << std::right
+        << std::setw(10) << "pixels" << std::setw(12) << "us" << std::setw(12) << "baseline" << "  result\n";
+    for (const GoldenCase& test_case : get_cases()) {
+        double best_us = 0;
+        for (int rep = 0; rep < reps; rep++) {
+            std::fill(pixels.begin(), pixels.end(), blank);
+            const auto time_start = std::chrono::steady_clock::now();
+            test_case.draw(pixels);
+            const auto time_end = std::chrono::steady_clock::now();
+            const std::chrono::duration<double, std::micro> us = time_end - time_start;
+            best_us = rep == 0 ? us.count() : std::min(best_us, us.count());
+        }
+        new_baseline << test_case.name << " " << std::fixed << std::setprecision(2) << best_us << "\n";
+
+        std::string result = "ok";
+        const std::string golden_path = golden_dir + test_case.name + ".pbm";
+        const GoldenImage image = crop_frame(pixels);
+        GoldenImage golden;
+        if (update_golden) {
+            write_pbm(golden_path, image);
+            result = "updated";
+        } else if (!read_pbm(golden_path, golden)) {
+            result = "FAIL: missing " + golden_path;
+        } else if (!(image == golden)) {
+            result = "FAIL: " + std::to_string(count_diff_pixels(image, golden)) + " pixels differ";
+        }
+
+        const auto base = baseline.find(test_case.name);
+        std::string base_str = "-";
+        if (base == baseline.end()) {
+            num_unbaselined++;
+        }
+        if (base != baseline.end()) {
+            std::ostringstream ss;
+            ss << std::fixed << std::setprecision(2) << base->second;
+            base_str = ss.str();
+            if (!update_baseline && best_us > base->second * (1.0 + threshold) && result == "ok") {
+                result = "FAIL: slower than baseline";
+            }
+        }
+        if (result.rfind("FAIL", 0) == 0) {
+            num_failures++;
+        }
+
+        std::cout << std::left << std::setw(24) << test_case.name << std::right
+            << std::setw(10) << std::count(image.bits.begin(), image.bits.end(), true)
+            << std::setw(12) << std::fixed << std::setprecision(2) << best_us
+            << std::setw(12) << base_str << "  " << result << "\n";
+    }
+
+    if (update_baseline) {
+        std::ofstream file(baseline_path);
+        file << new_baseline.str();
+        std::cout << "\nWrote " << baseline_path << "\n";
+    } else if (num_unbaselined > 0) {
+        std::cerr << "\nWARNING: " << num_unbaselined << " case(s) have no baseline time and were not timed against it;"
+            << " run draw2d-golden --update-baseline\n";
+    }
+    if (num_failures > 0) {
+        std::cout << "\n" << num_failures << " case(s) failed\n";
+        return 1;
+    }
+    std::cout << "\nAll cases passed\n";
+    return 0;
+}
@@ -0,0 +1,25 @@
+#include <exception>
+#include <iostream>
+#include <string>
+#include "glyph_bundle.h"
+
+// Offline glyph bundle compiler (see src/glyph_bundle.h)
+//
+// Usage: draw2d-bundle <svg-dir> <bundle-file>
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <svg-dir> <bundle-file>" << std::endl;
+        return 2;
+    }
+    try {
+        const std::size_t num_glyphs = compile_glyph_bundle(argv[1], argv[2]);
+        const GlyphBundle bundle(argv[2]);
+        std::cout << num_glyphs << " glyphs, " << bundle.get_size() << " bytes\n";
+    } catch (std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}